@@ -12513,6 +12513,215 @@ static void test_stretch_rect(void)
     DestroyWindow(window);
 }
 
+static void mutate_shader_swizzles(DWORD *code, unsigned int size, unsigned int seed)
+{
+    unsigned int i, j, length;
+    DWORD opcode;
+
+    /* Only SM2+ instructions encode their length in the opcode token. Source
+     * swizzles never change the instruction layout, so the result always
+     * parses. */
+    for (i = 1; i < size && code[i] != 0x0000ffff; i += length + 1)
+    {
+        opcode = code[i] & 0xffff;
+        length = (code[i] >> 24) & 0xf;
+        if (opcode == D3DSIO_DCL || opcode == D3DSIO_DEF || opcode == D3DSIO_DEFI || opcode == D3DSIO_DEFB)
+            continue;
+        for (j = 2; j <= length && i + j < size; ++j)
+        {
+            if (code[i + j] & D3DSHADER_ADDRESSMODE_MASK)
+            {
+                ++j;
+                continue;
+            }
+            seed = seed * 1103515245 + 12345;
+            code[i + j] = (code[i + j] & ~D3DVS_SWIZZLE_MASK) | (((seed >> 16) & 0xff) << D3DVS_SWIZZLE_SHIFT);
+        }
+    }
+}
+
+/* Rough timings of the shader frontends and backend, which depend on the
+ * machine and can't be checked. Only run in interactive mode. */
+static void test_shader_translation_throughput(void)
+{
+    IDirect3DVertexShader9 *vs;
+    IDirect3DPixelShader9 *ps;
+    unsigned int i, j, count;
+    IDirect3DDevice9 *device;
+    DWORD start, elapsed;
+    DWORD mutated[64];
+    IDirect3D9 *d3d;
+    ULONG refcount;
+    D3DCAPS9 caps;
+    HWND window;
+    HRESULT hr;
+
+    static const DWORD vs_2_0[] =
+    {
+        0xfffe0200,                                                             /* vs_2_0                       */
+        0x0200001f, 0x80000000, 0x900f0000,                                     /* dcl_position v0              */
+        0x0200001f, 0x8000000a, 0x900f0001,                                     /* dcl_color v1                 */
+        0x05000051, 0xa00f0004, 0x3f000000, 0x3f800000, 0x00000000, 0x00000000, /* def c4, 0.5, 1.0, 0.0, 0.0   */
+        0x03000009, 0xc0010000, 0x90e40000, 0xa0e40000,                         /* dp4 oPos.x, v0, c0           */
+        0x03000009, 0xc0020000, 0x90e40000, 0xa0e40001,                         /* dp4 oPos.y, v0, c1           */
+        0x03000009, 0xc0040000, 0x90e40000, 0xa0e40002,                         /* dp4 oPos.z, v0, c2           */
+        0x03000009, 0xc0080000, 0x90e40000, 0xa0e40003,                         /* dp4 oPos.w, v0, c3           */
+        0x04000004, 0xd00f0000, 0x90e40001, 0xa0000004, 0xa0550004,             /* mad oD0, v1, c4.x, c4.y      */
+        0x0000ffff,                                                             /* end                          */
+    };
+    static const DWORD ps_2_0[] =
+    {
+        0xffff0200,                                                             /* ps_2_0                       */
+        0x0200001f, 0x80000000, 0x900f0000,                                     /* dcl v0                       */
+        0x05000051, 0xa00f0000, 0x3f000000, 0x3f000000, 0x3f000000, 0x3f800000, /* def c0, 0.5, 0.5, 0.5, 1.0   */
+        0x03000005, 0x800f0000, 0x90e40000, 0xa0e40000,                         /* mul r0, v0, c0               */
+        0x02000001, 0x800f0800, 0x80e40000,                                     /* mov oC0, r0                  */
+        0x0000ffff,                                                             /* end                          */
+    };
+    static const DWORD vs_3_0[] =
+    {
+        0xfffe0300,                                                             /* vs_3_0                       */
+        0x0200001f, 0x80000000, 0x900f0000,                                     /* dcl_position v0              */
+        0x0200001f, 0x80000000, 0xe00f0000,                                     /* dcl_position o0              */
+        0x0200001f, 0x8000000a, 0xe00f0001,                                     /* dcl_color o1                 */
+        0x02000001, 0xe00f0000, 0x90e40000,                                     /* mov o0, v0                   */
+        0x02000001, 0xe00f0001, 0x90e40000,                                     /* mov o1, v0                   */
+        0x0000ffff,                                                             /* end                          */
+    };
+    static const DWORD ps_3_0[] =
+    {
+        0xffff0300,                                                             /* ps_3_0                       */
+        0x0200001f, 0x8000000a, 0x900f0000,                                     /* dcl_color v0                 */
+        0x05000051, 0xa00f0000, 0x00000000, 0x00000000, 0x00000000, 0x3f800000, /* def c0, 0, 0, 0, 1           */
+        0x05000051, 0xa00f0001, 0x3d000000, 0x00000000, 0x00000000, 0x00000000, /* def c1, 1/32, 0, 0, 0        */
+        0x05000030, 0xf00f0000, 0x00000004, 0x00000000, 0x00000002, 0x00000000, /* defi i0, 4, 0, 2, 0          */
+        0x02000001, 0x800f0000, 0xa0e40000,                                     /* mov r0, c0                   */
+        0x0200001b, 0xf0e40800, 0xf0e40000,                                     /* loop aL, i0                  */
+        0x03000002, 0x800f0000, 0x80e40000, 0xa0e40001,                         /* add r0, r0, c1               */
+        0x0000001d,                                                             /* endloop                      */
+        0x03000002, 0x800f0800, 0x80e40000, 0x90e40000,                         /* add oC0, r0, v0              */
+        0x0000ffff,                                                             /* end                          */
+    };
+    static const struct
+    {
+        const DWORD *vs, *ps;
+        unsigned int vs_size, ps_size;
+        DWORD version;
+    }
+    tests[] =
+    {
+        {simple_vs, simple_ps, ARRAY_SIZE(simple_vs), ARRAY_SIZE(simple_ps), 0x0101},
+        {vs_2_0,    ps_2_0,    ARRAY_SIZE(vs_2_0),    ARRAY_SIZE(ps_2_0),    0x0200},
+        {vs_3_0,    ps_3_0,    ARRAY_SIZE(vs_3_0),    ARRAY_SIZE(ps_3_0),    0x0300},
+    };
+    static const float quad[] =
+    {
+        -1.0f, -1.0f, 0.1f,
+        -1.0f,  1.0f, 0.1f,
+         1.0f, -1.0f, 0.1f,
+         1.0f,  1.0f, 0.1f,
+    };
+
+    window = CreateWindowA("d3d9_test_wc", "d3d9_test", WS_OVERLAPPEDWINDOW,
+            0, 0, 640, 480, 0, 0, 0, 0);
+    d3d = Direct3DCreate9(D3D_SDK_VERSION);
+    ok(!!d3d, "Failed to create a D3D object.\n");
+
+    if (!(device = create_device(d3d, window, NULL)))
+    {
+        skip("Failed to create a D3D device.\n");
+        IDirect3D9_Release(d3d);
+        DestroyWindow(window);
+        return;
+    }
+
+    hr = IDirect3DDevice9_GetDeviceCaps(device, &caps);
+    ok(SUCCEEDED(hr), "Failed to get caps, hr %#x.\n", hr);
+    hr = IDirect3DDevice9_SetFVF(device, D3DFVF_XYZ);
+    ok(SUCCEEDED(hr), "Failed to set FVF, hr %#x.\n", hr);
+
+    for (i = 0; i < ARRAY_SIZE(tests); ++i)
+    {
+        if (caps.VertexShaderVersion < D3DVS_VERSION(tests[i].version >> 8, tests[i].version & 0xff)
+                || caps.PixelShaderVersion < D3DPS_VERSION(tests[i].version >> 8, tests[i].version & 0xff))
+        {
+            skip("Shader model %u.%u not supported.\n", tests[i].version >> 8, tests[i].version & 0xff);
+            continue;
+        }
+
+        /* Shader creation only runs the bytecode frontend. */
+        start = GetTickCount();
+        for (count = 0; (elapsed = GetTickCount() - start) < 250 || count < 16; ++count)
+        {
+            hr = IDirect3DDevice9_CreateVertexShader(device, tests[i].vs, &vs);
+            ok(SUCCEEDED(hr), "Test %u: Failed to create vertex shader, hr %#x.\n", i, hr);
+            IDirect3DVertexShader9_Release(vs);
+            hr = IDirect3DDevice9_CreatePixelShader(device, tests[i].ps, &ps);
+            ok(SUCCEEDED(hr), "Test %u: Failed to create pixel shader, hr %#x.\n", i, hr);
+            IDirect3DPixelShader9_Release(ps);
+        }
+        trace("Shader model %u.%u: created %u shaders in %u ms.\n",
+                tests[i].version >> 8, tests[i].version & 0xff, 2 * count, elapsed);
+
+        /* Drawing with new shader objects also goes through the backend
+         * translation and linking. Mutated source swizzles make each pair
+         * distinct without changing the instruction layout. */
+        start = GetTickCount();
+        for (count = 0; count < 16; ++count)
+        {
+            hr = IDirect3DDevice9_CreateVertexShader(device, tests[i].vs, &vs);
+            ok(SUCCEEDED(hr), "Test %u: Failed to create vertex shader, hr %#x.\n", i, hr);
+
+            if (tests[i].version >= 0x0200 && count)
+            {
+                ok(tests[i].ps_size <= ARRAY_SIZE(mutated), "Test %u: Shader too large.\n", i);
+                memcpy(mutated, tests[i].ps, tests[i].ps_size * sizeof(*mutated));
+                mutate_shader_swizzles(mutated, tests[i].ps_size, count);
+                hr = IDirect3DDevice9_CreatePixelShader(device, mutated, &ps);
+                ok(hr == D3D_OK || hr == D3DERR_INVALIDCALL,
+                        "Test %u, %u: Got unexpected hr %#x.\n", i, count, hr);
+            }
+            else
+            {
+                hr = IDirect3DDevice9_CreatePixelShader(device, tests[i].ps, &ps);
+                ok(SUCCEEDED(hr), "Test %u: Failed to create pixel shader, hr %#x.\n", i, hr);
+            }
+            if (FAILED(hr))
+            {
+                IDirect3DVertexShader9_Release(vs);
+                continue;
+            }
+
+            hr = IDirect3DDevice9_SetVertexShader(device, vs);
+            ok(SUCCEEDED(hr), "Test %u: Failed to set vertex shader, hr %#x.\n", i, hr);
+            hr = IDirect3DDevice9_SetPixelShader(device, ps);
+            ok(SUCCEEDED(hr), "Test %u: Failed to set pixel shader, hr %#x.\n", i, hr);
+            hr = IDirect3DDevice9_BeginScene(device);
+            ok(SUCCEEDED(hr), "Test %u: Failed to begin scene, hr %#x.\n", i, hr);
+            hr = IDirect3DDevice9_DrawPrimitiveUP(device, D3DPT_TRIANGLESTRIP, 2, quad, 3 * sizeof(*quad));
+            ok(SUCCEEDED(hr), "Test %u: Failed to draw, hr %#x.\n", i, hr);
+            hr = IDirect3DDevice9_EndScene(device);
+            ok(SUCCEEDED(hr), "Test %u: Failed to end scene, hr %#x.\n", i, hr);
+
+            hr = IDirect3DDevice9_SetVertexShader(device, NULL);
+            ok(SUCCEEDED(hr), "Test %u: Failed to set vertex shader, hr %#x.\n", i, hr);
+            hr = IDirect3DDevice9_SetPixelShader(device, NULL);
+            ok(SUCCEEDED(hr), "Test %u: Failed to set pixel shader, hr %#x.\n", i, hr);
+            IDirect3DVertexShader9_Release(vs);
+            IDirect3DPixelShader9_Release(ps);
+        }
+        hr = IDirect3DDevice9_Present(device, NULL, NULL, NULL, NULL);
+        ok(SUCCEEDED(hr), "Test %u: Failed to present, hr %#x.\n", i, hr);
+        trace("Shader model %u.%u: drew with %u shader pairs in %u ms.\n",
+                tests[i].version >> 8, tests[i].version & 0xff, count, GetTickCount() - start);
+    }
+
+    refcount = IDirect3DDevice9_Release(device);
+    ok(!refcount, "Device has %u references left.\n", refcount);
+    IDirect3D9_Release(d3d);
+    DestroyWindow(window);
+}
+
 static void test_device_caps(void)
 {
     IDirect3DDevice9 *device;
@@ -12775,6 +12984,8 @@ START_TEST(device)
     test_swapchain_multisample_reset();
     test_stretch_rect();
     test_device_caps();
+    if (winetest_interactive)
+        test_shader_translation_throughput();
 
     UnregisterClassA("d3d9_test_wc", GetModuleHandleA(NULL));
 }
@@ -21,6 +21,7 @@
 #include <assert.h>
 
 #include "gdi_private.h"
+#include "winreg.h"
 #include "dibdrv.h"
 
 #include "wine/debug.h"
@@ -466,6 +467,164 @@ static int get_overlap( const dib_info *dst, const RECT *dst_rect,
     return ret;
 }
 
+/* operations large enough to be worth splitting in horizontal bands processed in parallel */
+#define PARALLEL_MIN_PIXELS (256 * 256)
+#define PARALLEL_MIN_BAND_HEIGHT 16
+#define PARALLEL_MAX_THREADS 16
+
+enum band_op_type
+{
+    BAND_COPY,
+    BAND_MASK,
+    BAND_BLEND
+};
+
+struct band_op
+{
+    enum band_op_type   type;
+    const dib_info     *dst;
+    const dib_info     *src;
+    RECT                rect;
+    POINT               origin;
+    int                 rop2;
+    BLENDFUNCTION       blend;
+    int                 bands;
+    int                 band_height;
+    LONG                next;        /* next band to claim */
+    LONG                completed;   /* number of bands done */
+    LONG                refs;
+    HANDLE              done;        /* signaled once all the bands are done */
+};
+
+static int get_dib_threads(void)
+{
+    static int threads;
+    int ret = threads;
+
+    if (!ret)
+    {
+        SYSTEM_INFO info;
+        HKEY hkey;
+        char buffer[16];
+        DWORD type, size = sizeof(buffer);
+
+        GetSystemInfo( &info );
+        ret = min( info.dwNumberOfProcessors, PARALLEL_MAX_THREADS );
+
+        /* @@ Wine registry key: HKCU\Software\Wine\GDI */
+        if (!RegOpenKeyA( HKEY_CURRENT_USER, "Software\\Wine\\GDI", &hkey ))
+        {
+            if (!RegQueryValueExA( hkey, "DibThreads", NULL, &type, (BYTE *)buffer, &size ) &&
+                type == REG_SZ)
+                ret = min( max( atoi( buffer ), 1 ), PARALLEL_MAX_THREADS );
+            RegCloseKey( hkey );
+        }
+        threads = ret = max( ret, 1 );
+        TRACE( "using %d threads\n", ret );
+    }
+    return ret;
+}
+
+static void run_band( struct band_op *op, int band )
+{
+    RECT rc = op->rect;
+    POINT origin = op->origin;
+    int offset = band * op->band_height;
+
+    rc.top += offset;
+    rc.bottom = min( rc.top + op->band_height, op->rect.bottom );
+    origin.y += offset;
+
+    switch (op->type)
+    {
+    case BAND_COPY:
+        op->dst->funcs->copy_rect( op->dst, &rc, op->src, &origin, op->rop2, 0 );
+        break;
+    case BAND_MASK:
+        op->dst->funcs->mask_rect( op->dst, &rc, op->src, &origin, op->rop2 );
+        break;
+    case BAND_BLEND:
+        op->dst->funcs->blend_rect( op->dst, &rc, op->src, &origin, op->blend );
+        break;
+    }
+}
+
+/* run bands until they have all been claimed, by this thread or another one */
+static void process_bands( struct band_op *op )
+{
+    int band;
+
+    while ((band = InterlockedIncrement( &op->next ) - 1) < op->bands)
+    {
+        run_band( op, band );
+        if (InterlockedIncrement( &op->completed ) == op->bands) SetEvent( op->done );
+    }
+}
+
+static void release_band_op( struct band_op *op )
+{
+    if (InterlockedDecrement( &op->refs )) return;
+    CloseHandle( op->done );
+    HeapFree( GetProcessHeap(), 0, op );
+}
+
+static void CALLBACK band_callback( TP_CALLBACK_INSTANCE *instance, void *context )
+{
+    struct band_op *op = context;
+
+    /* this may run long after the caller returned, in which case there's nothing left to claim */
+    process_bands( op );
+    release_band_op( op );
+}
+
+/* split the operation in bands of scanlines and run them on the thread pool;
+ * returns FALSE if the operation should simply be done on the calling thread */
+static BOOL run_in_bands( const struct band_op *params )
+{
+    struct band_op *op;
+    int i, threads, width = params->rect.right - params->rect.left, height = params->rect.bottom - params->rect.top;
+
+    if ((LONGLONG)width * height < PARALLEL_MIN_PIXELS) return FALSE;
+    if ((threads = get_dib_threads()) < 2) return FALSE;
+
+    threads = min( threads, height / PARALLEL_MIN_BAND_HEIGHT );
+    if (threads < 2) return FALSE;
+
+    /* the callbacks hold references, since they may not start before the caller is done */
+    if (!(op = HeapAlloc( GetProcessHeap(), 0, sizeof(*op) ))) return FALSE;
+    *op = *params;
+
+    /* a few more bands than threads to even out the load */
+    op->bands = min( threads * 4, height / PARALLEL_MIN_BAND_HEIGHT );
+    op->band_height = (height + op->bands - 1) / op->bands;
+    op->bands = (height + op->band_height - 1) / op->band_height;
+    op->next = 0;
+    op->completed = 0;
+    op->refs = 1;
+    if (!(op->done = CreateEventW( NULL, TRUE, FALSE, NULL )))
+    {
+        HeapFree( GetProcessHeap(), 0, op );
+        return FALSE;
+    }
+
+    for (i = 1; i < threads; i++)
+    {
+        InterlockedIncrement( &op->refs );
+        if (!TrySubmitThreadpoolCallback( band_callback, op, NULL ))
+        {
+            InterlockedDecrement( &op->refs );
+            break;
+        }
+    }
+
+    /* callbacks that didn't start yet don't hold us back, we run their bands ourselves
+     * and only wait for the bands that other threads are still processing */
+    process_bands( op );
+    WaitForSingleObject( op->done, INFINITE );
+    release_band_op( op );
+    return TRUE;
+}
+
 static void copy_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src, const RECT *src_rect,
                         const struct clipped_rects *clipped_rects, INT rop2 )
 {
@@ -547,6 +706,18 @@ static void copy_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src,
         {
             origin.x = src_rect->left + rects[i].left - dst_rect->left;
             origin.y = src_rect->top  + rects[i].top  - dst_rect->top;
+            if (!overlap)  /* bands can only be processed in any order if the bits don't overlap */
+            {
+                struct band_op op;
+
+                op.type   = BAND_COPY;
+                op.dst    = dst;
+                op.src    = src;
+                op.rect   = rects[i];
+                op.origin = origin;
+                op.rop2   = rop2;
+                if (run_in_bands( &op )) continue;
+            }
             dst->funcs->copy_rect( dst, &rects[i], src, &origin, rop2, overlap );
         }
     }
@@ -555,6 +726,7 @@ static void copy_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src,
 static void mask_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src, const RECT *src_rect,
                        const struct clipped_rects *clipped_rects, INT rop2 )
 {
+    struct band_op op;
     POINT origin;
     const RECT *rects;
     int i, count;
@@ -577,6 +749,13 @@ static void mask_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src,
     {
         origin.x = src_rect->left + rects[i].left - dst_rect->left;
         origin.y = src_rect->top  + rects[i].top  - dst_rect->top;
+        op.type   = BAND_MASK;
+        op.dst    = dst;
+        op.src    = src;
+        op.rect   = rects[i];
+        op.origin = origin;
+        op.rop2   = rop2;
+        if (run_in_bands( &op )) continue;
         dst->funcs->mask_rect( dst, &rects[i], src, &origin, rop2 );
     }
 }
@@ -584,6 +763,7 @@ static void mask_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src,
 static DWORD blend_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src, const RECT *src_rect,
                          HRGN clip, BLENDFUNCTION blend )
 {
+    struct band_op op;
     POINT origin;
     struct clipped_rects clipped_rects;
     int i;
@@ -593,6 +773,13 @@ static DWORD blend_rect( dib_info *dst, const RECT *dst_rect, const dib_info *sr
     {
         origin.x = src_rect->left + clipped_rects.rects[i].left - dst_rect->left;
         origin.y = src_rect->top  + clipped_rects.rects[i].top  - dst_rect->top;
+        op.type   = BAND_BLEND;
+        op.dst    = dst;
+        op.src    = src;
+        op.rect   = clipped_rects.rects[i];
+        op.origin = origin;
+        op.blend  = blend;
+        if (run_in_bands( &op )) continue;
         dst->funcs->blend_rect( dst, &clipped_rects.rects[i], src, &origin, blend );
     }
     free_clipped_rects( &clipped_rects );
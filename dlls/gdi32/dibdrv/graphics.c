@@ -30,6 +30,7 @@ WINE_DEFAULT_DEBUG_CHANNEL(dib);
 struct cached_glyph
 {
     GLYPHMETRICS metrics;
+    LONG         last_used;
     BYTE         bits[1];
 };
 
@@ -42,6 +43,7 @@ enum glyph_type
 
 #define GLYPH_CACHE_PAGE_SIZE  0x100
 #define GLYPH_CACHE_PAGES      (0x10000 / GLYPH_CACHE_PAGE_SIZE)
+#define GLYPH_CACHE_MAX_SIZE   (2 * 1024 * 1024)  /* bytes of glyph bitmaps per font */
 
 struct cached_font
 {
@@ -51,6 +53,9 @@ struct cached_font
     LOGFONTW              lf;
     XFORM                 xform;
     UINT                  aa_flags;
+    SRWLOCK               lock;      /* held shared while using glyphs, exclusive to evict them */
+    LONG                  size;      /* total size of the cached glyphs */
+    LONG                  last_used; /* incremented for each rendered string */
     struct cached_glyph **glyphs[GLYPH_NBTYPES][GLYPH_CACHE_PAGES];
 };
 
@@ -554,10 +559,26 @@ static int font_cache_cmp( const struct cached_font *p1, const struct cached_fon
     return ret;
 }
 
+static void free_cached_glyphs( struct cached_font *font )
+{
+    UINT i, j, k;
+
+    for (i = 0; i < GLYPH_NBTYPES; i++)
+    {
+        for (j = 0; j < GLYPH_CACHE_PAGES; j++)
+        {
+            if (!font->glyphs[i][j]) continue;
+            for (k = 0; k < GLYPH_CACHE_PAGE_SIZE; k++)
+                HeapFree( GetProcessHeap(), 0, font->glyphs[i][j][k] );
+            HeapFree( GetProcessHeap(), 0, font->glyphs[i][j] );
+        }
+    }
+}
+
 static struct cached_font *add_cached_font( DC *dc, HFONT hfont, UINT aa_flags )
 {
     struct cached_font font, *ptr, *last_unused = NULL;
-    UINT i = 0, j, k;
+    UINT i = 0;
 
     GetObjectW( hfont, sizeof(font.lf), &font.lf );
     font.xform = dc->xformWorld2Vport;
@@ -591,16 +612,7 @@ static struct cached_font *add_cached_font( DC *dc, HFONT hfont, UINT aa_flags )
     if (i > 5)  /* keep at least 5 of the most-recently used fonts around */
     {
         ptr = last_unused;
-        for (i = 0; i < GLYPH_NBTYPES; i++)
-        {
-            for (j = 0; j < GLYPH_CACHE_PAGES; j++)
-            {
-                if (!ptr->glyphs[i][j]) continue;
-                for (k = 0; k < GLYPH_CACHE_PAGE_SIZE; k++)
-                    HeapFree( GetProcessHeap(), 0, ptr->glyphs[i][j][k] );
-                HeapFree( GetProcessHeap(), 0, ptr->glyphs[i][j] );
-            }
-        }
+        free_cached_glyphs( ptr );
         list_remove( &ptr->entry );
     }
     else if (!(ptr = HeapAlloc( GetProcessHeap(), 0, sizeof(*ptr) )))
@@ -611,6 +623,9 @@ static struct cached_font *add_cached_font( DC *dc, HFONT hfont, UINT aa_flags )
 
     *ptr = font;
     ptr->ref = 1;
+    ptr->size = 0;
+    ptr->last_used = 0;
+    InitializeSRWLock( &ptr->lock );
     memset( ptr->glyphs, 0, sizeof(ptr->glyphs) );
 done:
     list_add_head( &font_cache, &ptr->entry );
@@ -624,6 +639,14 @@ void release_cached_font( struct cached_font *font )
     if (font) InterlockedDecrement( &font->ref );
 }
 
+static int get_glyph_depth( UINT aa_flags );
+
+static LONG get_cached_glyph_size( const struct cached_font *font, const struct cached_glyph *glyph )
+{
+    return FIELD_OFFSET( struct cached_glyph, bits[ glyph->metrics.gmBlackBoxY *
+                         get_dib_stride( glyph->metrics.gmBlackBoxX, get_glyph_depth( font->aa_flags )) ] );
+}
+
 static struct cached_glyph *add_cached_glyph( struct cached_font *font, UINT index, UINT flags,
                                               struct cached_glyph *glyph )
 {
@@ -646,11 +669,68 @@ static struct cached_glyph *add_cached_glyph( struct cached_font *font, UINT ind
             HeapFree( GetProcessHeap(), 0, ptr );
     }
     ret = InterlockedCompareExchangePointer( (void **)&font->glyphs[type][page][entry], glyph, NULL );
-    if (!ret) ret = glyph;
+    if (!ret)
+    {
+        InterlockedExchangeAdd( &font->size, get_cached_glyph_size( font, glyph ));
+        ret = glyph;
+    }
     else HeapFree( GetProcessHeap(), 0, glyph );
     return ret;
 }
 
+static int glyph_age_cmp( const void *p1, const void *p2 )
+{
+    const struct cached_glyph *g1 = **(struct cached_glyph * const * const *)p1;
+    const struct cached_glyph *g2 = **(struct cached_glyph * const * const *)p2;
+
+    if (g1->last_used == g2->last_used) return 0;
+    return g1->last_used - g2->last_used < 0 ? -1 : 1;
+}
+
+/***********************************************************************
+ *         trim_glyph_cache
+ *
+ * Evict the least recently used glyphs once the font caches too many bitmaps,
+ * this happens with large sizes or with fonts covering a lot of characters.
+ */
+static void trim_glyph_cache( struct cached_font *font )
+{
+    struct cached_glyph ***entries;
+    UINT i, j, k, count = 0;
+
+    if (font->size <= GLYPH_CACHE_MAX_SIZE) return;
+
+    AcquireSRWLockExclusive( &font->lock );
+    if (font->size <= GLYPH_CACHE_MAX_SIZE) goto done;
+
+    for (i = 0; i < GLYPH_NBTYPES; i++)
+        for (j = 0; j < GLYPH_CACHE_PAGES; j++)
+            if (font->glyphs[i][j])
+                for (k = 0; k < GLYPH_CACHE_PAGE_SIZE; k++) if (font->glyphs[i][j][k]) count++;
+
+    if (!(entries = HeapAlloc( GetProcessHeap(), 0, count * sizeof(*entries) ))) goto done;
+
+    for (i = count = 0; i < GLYPH_NBTYPES; i++)
+        for (j = 0; j < GLYPH_CACHE_PAGES; j++)
+            if (font->glyphs[i][j])
+                for (k = 0; k < GLYPH_CACHE_PAGE_SIZE; k++)
+                    if (font->glyphs[i][j][k]) entries[count++] = &font->glyphs[i][j][k];
+
+    qsort( entries, count, sizeof(*entries), glyph_age_cmp );
+
+    /* free down to half the limit, so that the next trim doesn't happen too soon */
+    for (i = 0; i < count && font->size > GLYPH_CACHE_MAX_SIZE / 2; i++)
+    {
+        font->size -= get_cached_glyph_size( font, *entries[i] );
+        HeapFree( GetProcessHeap(), 0, *entries[i] );
+        *entries[i] = NULL;
+    }
+    TRACE( "%p: evicted %u/%u glyphs, %d bytes left\n", font, i, count, font->size );
+    HeapFree( GetProcessHeap(), 0, entries );
+done:
+    ReleaseSRWLockExclusive( &font->lock );
+}
+
 static struct cached_glyph *get_cached_glyph( struct cached_font *font, UINT index, UINT flags )
 {
     enum glyph_type type = (flags & ETO_GLYPH_INDEX) ? GLYPH_INDEX : GLYPH_WCHAR;
@@ -817,6 +897,7 @@ static void render_string( DC *dc, dib_info *dib, struct cached_font *font, INT
     dib_info glyph_dib;
     DWORD text_color;
     struct intensity_range ranges[17];
+    LONG stamp;
 
     glyph_dib.bit_count    = get_glyph_depth( font->aa_flags );
     glyph_dib.rect.left    = 0;
@@ -829,11 +910,17 @@ static void render_string( DC *dc, dib_info *dib, struct cached_font *font, INT
     if (glyph_dib.bit_count == 8)
         get_aa_ranges( dib->funcs->pixel_to_colorref( dib, text_color ), ranges );
 
+    trim_glyph_cache( font );
+    AcquireSRWLockShared( &font->lock );
+    stamp = InterlockedIncrement( &font->last_used );
+
     for (i = 0; i < count; i++)
     {
         if (!(glyph = get_cached_glyph( font, str[i], flags )) &&
             !(glyph = cache_glyph_bitmap( dc, font, str[i], flags ))) continue;
 
+        glyph->last_used = stamp;
+
         glyph_dib.width       = glyph->metrics.gmBlackBoxX;
         glyph_dib.height      = glyph->metrics.gmBlackBoxY;
         glyph_dib.rect.right  = glyph->metrics.gmBlackBoxX;
@@ -859,6 +946,8 @@ static void render_string( DC *dc, dib_info *dib, struct cached_font *font, INT
             y += glyph->metrics.gmCellIncY;
         }
     }
+
+    ReleaseSRWLockShared( &font->lock );
 }
 
 BOOL render_aa_text_bitmapinfo( DC *dc, BITMAPINFO *info, struct gdi_image_bits *bits,
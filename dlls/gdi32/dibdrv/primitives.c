@@ -23,6 +23,28 @@
 #include "gdi_private.h"
 #include "dibdrv.h"
 
+#if defined(__x86_64__) || (defined(__i386__) && defined(__GNUC__) && !defined(__clang__) && \
+                            (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+#include <emmintrin.h>
+#define USE_SSE2
+#ifdef __i386__
+#define SSE2_FUNC __attribute__((__target__("sse2")))
+#else
+#define SSE2_FUNC
+#endif
+
+static BOOL have_sse2(void)
+{
+#ifdef __i386__
+    static int enabled = -1;
+    if (enabled == -1) enabled = IsProcessorFeaturePresent( PF_XMMI64_INSTRUCTIONS_AVAILABLE );
+    return enabled;
+#else
+    return TRUE;
+#endif
+}
+#endif
+
 #include "wine/debug.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(dib);
@@ -2097,6 +2119,182 @@ static DWORD rgbquad_to_pixel_masks(const dib_info *dib, RGBQUAD rgb)
     return rgb_to_pixel_masks(dib, rgb.rgbRed, rgb.rgbGreen, rgb.rgbBlue);
 }
 
+static inline BOOL is_standard_565(const dib_info *dib)
+{
+    return (dib->red_shift == 11 && dib->red_len == 5 &&
+            dib->green_shift == 5 && dib->green_len == 6 &&
+            dib->blue_shift == 0 && dib->blue_len == 5);
+}
+
+static inline DWORD pixel_555_to_8888(DWORD val)
+{
+    return (((val << 9) & 0xf80000) | ((val << 4) & 0x070000) |
+            ((val << 6) & 0x00f800) | ((val << 1) & 0x000700) |
+            ((val << 3) & 0x0000f8) | ((val >> 2) & 0x000007));
+}
+
+static inline DWORD pixel_565_to_8888(DWORD val)
+{
+    return (((val << 8) & 0xf80000) | ((val << 3) & 0x070000) |
+            ((val << 5) & 0x00fc00) | ((val >> 1) & 0x000300) |
+            ((val << 3) & 0x0000f8) | ((val >> 2) & 0x000007));
+}
+
+static inline WORD pixel_8888_to_555(DWORD val)
+{
+    return ((val >> 9) & 0x7c00) | ((val >> 6) & 0x03e0) | ((val >> 3) & 0x001f);
+}
+
+static inline WORD pixel_8888_to_565(DWORD val)
+{
+    return ((val >> 8) & 0xf800) | ((val >> 5) & 0x07e0) | ((val >> 3) & 0x001f);
+}
+
+/* The 24-bpp rows are converted four pixels (three dwords) at a time once the
+ * 24-bpp pointer is aligned, the 16-bpp ones eight pixels at a time with SSE2. */
+
+static void convert_row_24_to_8888(DWORD *dst, const BYTE *src, int len)
+{
+    for ( ; len && ((ULONG_PTR)src & 3); len--, src += 3) *dst++ = src[0] | src[1] << 8 | src[2] << 16;
+    for ( ; len >= 4; len -= 4, src += 12, dst += 4)
+    {
+        const DWORD *ptr = (const DWORD *)src;
+        dst[0] = ptr[0] & 0xffffff;
+        dst[1] = (ptr[0] >> 24) | (ptr[1] & 0xffff) << 8;
+        dst[2] = (ptr[1] >> 16) | (ptr[2] & 0xff) << 16;
+        dst[3] = ptr[2] >> 8;
+    }
+    for ( ; len; len--, src += 3) *dst++ = src[0] | src[1] << 8 | src[2] << 16;
+}
+
+static void convert_row_8888_to_24(BYTE *dst, const DWORD *src, int len)
+{
+    for ( ; len && ((ULONG_PTR)dst & 3); len--, src++, dst += 3)
+    {
+        dst[0] = *src;
+        dst[1] = *src >> 8;
+        dst[2] = *src >> 16;
+    }
+    for ( ; len >= 4; len -= 4, src += 4, dst += 12)
+    {
+        DWORD *ptr = (DWORD *)dst;
+        ptr[0] = (src[0] & 0xffffff) | src[1] << 24;
+        ptr[1] = ((src[1] >> 8) & 0xffff) | src[2] << 16;
+        ptr[2] = ((src[2] >> 16) & 0xff) | src[3] << 8;
+    }
+    for ( ; len; len--, src++, dst += 3)
+    {
+        dst[0] = *src;
+        dst[1] = *src >> 8;
+        dst[2] = *src >> 16;
+    }
+}
+
+#ifdef USE_SSE2
+
+/* pack the 16-bit values held in the 32-bit lanes of lo and hi */
+static inline SSE2_FUNC __m128i pack_epi32_to_epi16( __m128i lo, __m128i hi )
+{
+    lo = _mm_srai_epi32( _mm_slli_epi32( lo, 16 ), 16 );
+    hi = _mm_srai_epi32( _mm_slli_epi32( hi, 16 ), 16 );
+    return _mm_packs_epi32( lo, hi );
+}
+
+static inline SSE2_FUNC __m128i and_shl( __m128i val, int shift, DWORD mask )
+{
+    return _mm_and_si128( shift >= 0 ? _mm_slli_epi32( val, shift ) : _mm_srli_epi32( val, -shift ),
+                          _mm_set1_epi32( mask ));
+}
+
+static SSE2_FUNC int convert_row_16_to_8888_sse2(DWORD *dst, const WORD *src, int len, BOOL is_565)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int x;
+
+    for (x = 0; x + 8 <= len; x += 8)
+    {
+        __m128i val = _mm_loadu_si128( (const __m128i *)(src + x) ), res[2];
+        int i;
+
+        res[0] = _mm_unpacklo_epi16( val, zero );
+        res[1] = _mm_unpackhi_epi16( val, zero );
+        for (i = 0; i < 2; i++)
+        {
+            val = res[i];
+            if (is_565)
+                res[i] = _mm_or_si128( _mm_or_si128( _mm_or_si128( and_shl( val, 8, 0xf80000 ),
+                                                                   and_shl( val, 3, 0x070000 )),
+                                                     _mm_or_si128( and_shl( val, 5, 0x00fc00 ),
+                                                                   and_shl( val, -1, 0x000300 ))),
+                                       _mm_or_si128( and_shl( val, 3, 0x0000f8 ),
+                                                     and_shl( val, -2, 0x000007 )));
+            else
+                res[i] = _mm_or_si128( _mm_or_si128( _mm_or_si128( and_shl( val, 9, 0xf80000 ),
+                                                                   and_shl( val, 4, 0x070000 )),
+                                                     _mm_or_si128( and_shl( val, 6, 0x00f800 ),
+                                                                   and_shl( val, 1, 0x000700 ))),
+                                       _mm_or_si128( and_shl( val, 3, 0x0000f8 ),
+                                                     and_shl( val, -2, 0x000007 )));
+        }
+        _mm_storeu_si128( (__m128i *)(dst + x), res[0] );
+        _mm_storeu_si128( (__m128i *)(dst + x + 4), res[1] );
+    }
+    return x;
+}
+
+static SSE2_FUNC int convert_row_8888_to_16_sse2(WORD *dst, const DWORD *src, int len, BOOL is_565)
+{
+    int x;
+
+    for (x = 0; x + 8 <= len; x += 8)
+    {
+        __m128i val[2];
+        int i;
+
+        val[0] = _mm_loadu_si128( (const __m128i *)(src + x) );
+        val[1] = _mm_loadu_si128( (const __m128i *)(src + x + 4) );
+        for (i = 0; i < 2; i++)
+        {
+            if (is_565)
+                val[i] = _mm_or_si128( _mm_or_si128( and_shl( val[i], -8, 0xf800 ), and_shl( val[i], -5, 0x07e0 )),
+                                       and_shl( val[i], -3, 0x001f ));
+            else
+                val[i] = _mm_or_si128( _mm_or_si128( and_shl( val[i], -9, 0x7c00 ), and_shl( val[i], -6, 0x03e0 )),
+                                       and_shl( val[i], -3, 0x001f ));
+        }
+        _mm_storeu_si128( (__m128i *)(dst + x), pack_epi32_to_epi16( val[0], val[1] ));
+    }
+    return x;
+}
+
+#endif  /* USE_SSE2 */
+
+static void convert_row_16_to_8888(DWORD *dst, const WORD *src, int len, BOOL is_565)
+{
+    int x = 0;
+
+#ifdef USE_SSE2
+    if (have_sse2()) x = convert_row_16_to_8888_sse2( dst, src, len, is_565 );
+#endif
+    if (is_565)
+        for ( ; x < len; x++) dst[x] = pixel_565_to_8888( src[x] );
+    else
+        for ( ; x < len; x++) dst[x] = pixel_555_to_8888( src[x] );
+}
+
+static void convert_row_8888_to_16(WORD *dst, const DWORD *src, int len, BOOL is_565)
+{
+    int x = 0;
+
+#ifdef USE_SSE2
+    if (have_sse2()) x = convert_row_8888_to_16_sse2( dst, src, len, is_565 );
+#endif
+    if (is_565)
+        for ( ; x < len; x++) dst[x] = pixel_8888_to_565( src[x] );
+    else
+        for ( ; x < len; x++) dst[x] = pixel_8888_to_555( src[x] );
+}
+
 static DWORD colorref_to_pixel_masks(const dib_info *dib, COLORREF colour)
 {
     return rgb_to_pixel_masks(dib, GetRValue(colour), GetGValue(colour), GetBValue(colour));
@@ -2281,22 +2479,12 @@ static void convert_to_8888(dib_info *dst, const dib_info *src, const RECT *src_
 
     case 24:
     {
-        BYTE *src_start = get_pixel_ptr_24(src, src_rect->left, src_rect->top), *src_pixel;
+        BYTE *src_start = get_pixel_ptr_24(src, src_rect->left, src_rect->top);
 
         for(y = src_rect->top; y < src_rect->bottom; y++)
         {
-            dst_pixel = dst_start;
-            src_pixel = src_start;
-            for(x = src_rect->left; x < src_rect->right; x++)
-            {
-                RGBQUAD rgb;
-                rgb.rgbBlue  = *src_pixel++;
-                rgb.rgbGreen = *src_pixel++;
-                rgb.rgbRed   = *src_pixel++;
-
-                *dst_pixel++ = ((rgb.rgbRed << 16) & 0xff0000) | ((rgb.rgbGreen << 8) & 0x00ff00) | (rgb.rgbBlue & 0x0000ff);
-            }
-            if(pad_size) memset(dst_pixel, 0, pad_size);
+            convert_row_24_to_8888(dst_start, src_start, src_rect->right - src_rect->left);
+            if(pad_size) memset(dst_start + (src_rect->right - src_rect->left), 0, pad_size);
             dst_start += dst->stride / 4;
             src_start += src->stride;
         }
@@ -2306,20 +2494,13 @@ static void convert_to_8888(dib_info *dst, const dib_info *src, const RECT *src_
     case 16:
     {
         WORD *src_start = get_pixel_ptr_16(src, src_rect->left, src_rect->top), *src_pixel;
-        if(src->funcs == &funcs_555)
+        if(src->funcs == &funcs_555 || is_standard_565(src))
         {
             for(y = src_rect->top; y < src_rect->bottom; y++)
             {
-                dst_pixel = dst_start;
-                src_pixel = src_start;
-                for(x = src_rect->left; x < src_rect->right; x++)
-                {
-                    src_val = *src_pixel++;
-                    *dst_pixel++ = ((src_val << 9) & 0xf80000) | ((src_val << 4) & 0x070000) |
-                                   ((src_val << 6) & 0x00f800) | ((src_val << 1) & 0x000700) |
-                                   ((src_val << 3) & 0x0000f8) | ((src_val >> 2) & 0x000007);
-                }
-                if(pad_size) memset(dst_pixel, 0, pad_size);
+                convert_row_16_to_8888(dst_start, src_start, src_rect->right - src_rect->left,
+                                       src->funcs != &funcs_555);
+                if(pad_size) memset(dst_start + (src_rect->right - src_rect->left), 0, pad_size);
                 dst_start += dst->stride / 4;
                 src_start += src->stride / 2;
             }
@@ -2745,16 +2926,8 @@ static void convert_to_24(dib_info *dst, const dib_info *src, const RECT *src_re
         {
             for(y = src_rect->top; y < src_rect->bottom; y++)
             {
-                dst_pixel = dst_start;
-                src_pixel = src_start;
-                for(x = src_rect->left; x < src_rect->right; x++)
-                {
-                    src_val = *src_pixel++;
-                    *dst_pixel++ =  src_val        & 0xff;
-                    *dst_pixel++ = (src_val >>  8) & 0xff;
-                    *dst_pixel++ = (src_val >> 16) & 0xff;
-                }
-                if(pad_size) memset(dst_pixel, 0, pad_size);
+                convert_row_8888_to_24(dst_start, src_start, src_rect->right - src_rect->left);
+                if(pad_size) memset(dst_start + (src_rect->right - src_rect->left) * 3, 0, pad_size);
                 dst_start += dst->stride;
                 src_start += src->stride / 4;
             }
@@ -2990,16 +3163,8 @@ static void convert_to_555(dib_info *dst, const dib_info *src, const RECT *src_r
         {
             for(y = src_rect->top; y < src_rect->bottom; y++)
             {
-                dst_pixel = dst_start;
-                src_pixel = src_start;
-                for(x = src_rect->left; x < src_rect->right; x++)
-                {
-                    src_val = *src_pixel++;
-                    *dst_pixel++ = ((src_val >> 9) & 0x7c00) |
-                                   ((src_val >> 6) & 0x03e0) |
-                                   ((src_val >> 3) & 0x001f);
-                }
-                if(pad_size) memset(dst_pixel, 0, pad_size);
+                convert_row_8888_to_16(dst_start, src_start, src_rect->right - src_rect->left, FALSE);
+                if(pad_size) memset(dst_start + (src_rect->right - src_rect->left), 0, pad_size);
                 dst_start += dst->stride / 2;
                 src_start += src->stride / 4;
             }
@@ -3241,7 +3406,17 @@ static void convert_to_16(dib_info *dst, const dib_info *src, const RECT *src_re
     {
         DWORD *src_start = get_pixel_ptr_32(src, src_rect->left, src_rect->top), *src_pixel;
 
-        if(src->funcs == &funcs_8888)
+        if(src->funcs == &funcs_8888 && is_standard_565(dst))
+        {
+            for(y = src_rect->top; y < src_rect->bottom; y++)
+            {
+                convert_row_8888_to_16(dst_start, src_start, src_rect->right - src_rect->left, TRUE);
+                if(pad_size) memset(dst_start + (src_rect->right - src_rect->left), 0, pad_size);
+                dst_start += dst->stride / 2;
+                src_start += src->stride / 4;
+            }
+        }
+        else if(src->funcs == &funcs_8888)
         {
             for(y = src_rect->top; y < src_rect->bottom; y++)
             {
@@ -4651,6 +4826,142 @@ static inline DWORD blend_rgb( BYTE dst_r, BYTE dst_g, BYTE dst_b, DWORD src, BL
             blend_color( dst_r, src >> 16, blend.SourceConstantAlpha ) << 16);
 }
 
+enum blend_op
+{
+    BLEND_ARGB,             /* per-pixel alpha */
+    BLEND_ARGB_ALPHA,       /* per-pixel alpha combined with constant alpha */
+    BLEND_CONSTANT_ALPHA,   /* constant alpha */
+    BLEND_NO_SRC_ALPHA      /* constant alpha, source alpha treated as 255 */
+};
+
+static inline enum blend_op get_blend_op( const dib_info *src, BLENDFUNCTION blend )
+{
+    if (blend.AlphaFormat & AC_SRC_ALPHA)
+        return blend.SourceConstantAlpha == 255 ? BLEND_ARGB : BLEND_ARGB_ALPHA;
+    return src->compression == BI_RGB ? BLEND_CONSTANT_ALPHA : BLEND_NO_SRC_ALPHA;
+}
+
+static inline DWORD blend_pixel( DWORD dst, DWORD src, DWORD alpha, enum blend_op op )
+{
+    switch (op)
+    {
+    case BLEND_ARGB:           return blend_argb( dst, src );
+    case BLEND_ARGB_ALPHA:     return blend_argb_alpha( dst, src, alpha );
+    case BLEND_CONSTANT_ALPHA: return blend_argb_constant_alpha( dst, src, alpha );
+    default:                   return blend_argb_no_src_alpha( dst, src, alpha );
+    }
+}
+
+#ifdef USE_SSE2
+
+/* exact (val + 127) / 255 rounding for val <= 255 * 255, 16-bit lanes */
+static inline SSE2_FUNC __m128i div255_sse2( __m128i val )
+{
+    val = _mm_add_epi16( val, _mm_set1_epi16( 127 ));
+    val = _mm_add_epi16( _mm_add_epi16( val, _mm_srli_epi16( val, 8 )), _mm_set1_epi16( 1 ));
+    return _mm_srli_epi16( val, 8 );
+}
+
+/* replicate the alpha channel of two unpacked pixels to all their channels */
+static inline SSE2_FUNC __m128i expand_alpha_sse2( __m128i val )
+{
+    return _mm_shufflehi_epi16( _mm_shufflelo_epi16( val, 0xff ), 0xff );
+}
+
+/* blend two pixels unpacked to 16-bit channels; the result can exceed 255 for BLEND_ARGB* */
+static inline SSE2_FUNC __m128i blend_pixels_sse2( __m128i dst, __m128i src, __m128i alpha, enum blend_op op )
+{
+    const __m128i max = _mm_set1_epi16( 255 );
+
+    switch (op)
+    {
+    case BLEND_ARGB_ALPHA:
+        src = div255_sse2( _mm_mullo_epi16( src, alpha ));
+        /* fall through */
+    case BLEND_ARGB:
+        alpha = _mm_sub_epi16( max, expand_alpha_sse2( src ));
+        return _mm_add_epi16( src, div255_sse2( _mm_mullo_epi16( dst, alpha )));
+    default:
+        return div255_sse2( _mm_add_epi16( _mm_mullo_epi16( src, alpha ),
+                                           _mm_mullo_epi16( dst, _mm_sub_epi16( max, alpha ))));
+    }
+}
+
+/* blend a single pixel the same way as the C implementation of the destination format */
+static inline DWORD blend_pixel_c( DWORD dst, DWORD src, BLENDFUNCTION blend, enum blend_op op, BOOL swap_rb )
+{
+    DWORD val;
+
+    if (!swap_rb) return blend_pixel( dst, src, blend.SourceConstantAlpha, op );
+    val = blend_rgb( dst, dst >> 8, dst >> 16, src, blend );
+    return ((val & 0xff) << 16) | (val & 0xff00) | ((val >> 16) & 0xff);
+}
+
+/* blend a row of 32-bit pixels, four at a time; swap_rb means an 8-8-8 destination
+ * with red in the low byte and no alpha */
+static SSE2_FUNC void blend_row_sse2( DWORD *dst, const DWORD *src, int len, BLENDFUNCTION blend,
+                                      enum blend_op op, BOOL swap_rb )
+{
+    const __m128i zero = _mm_setzero_si128(), max = _mm_set1_epi16( 255 );
+    const __m128i const_alpha = _mm_set1_epi16( blend.SourceConstantAlpha );
+    const __m128i src_alpha = _mm_set1_epi32( op == BLEND_NO_SRC_ALPHA ? 0xff000000 : 0 );
+    const __m128i dst_mask = _mm_set1_epi32( swap_rb ? 0x00ffffff : ~0u );
+    const __m128i byte_mask = _mm_set1_epi32( 0xff ), ga_mask = _mm_set1_epi32( 0xff00ff00 );
+    int x = 0, i;
+
+    for (x = 0; x + 4 <= len; x += 4)
+    {
+        __m128i s = _mm_or_si128( _mm_loadu_si128( (const __m128i *)(src + x) ), src_alpha );
+        __m128i d = _mm_loadu_si128( (const __m128i *)(dst + x) );
+        __m128i lo, hi;
+
+        /* channels are blended independently, so match the source layout to the destination */
+        if (swap_rb)
+            s = _mm_or_si128( _mm_and_si128( s, ga_mask ),
+                              _mm_or_si128( _mm_and_si128( _mm_srli_epi32( s, 16 ), byte_mask ),
+                                            _mm_slli_epi32( _mm_and_si128( s, byte_mask ), 16 )));
+        lo = blend_pixels_sse2( _mm_unpacklo_epi8( d, zero ), _mm_unpacklo_epi8( s, zero ),
+                                const_alpha, op );
+        hi = blend_pixels_sse2( _mm_unpackhi_epi8( d, zero ), _mm_unpackhi_epi8( s, zero ),
+                                const_alpha, op );
+
+        /* channels can overflow with non-premultiplied sources, and the C implementations
+         * don't saturate them, leave these pixels to them to get identical results */
+        if (_mm_movemask_epi8( _mm_or_si128( _mm_cmpgt_epi16( lo, max ), _mm_cmpgt_epi16( hi, max ))))
+        {
+            for (i = x; i < x + 4; i++) dst[i] = blend_pixel_c( dst[i], src[i], blend, op, swap_rb );
+            continue;
+        }
+        _mm_storeu_si128( (__m128i *)(dst + x), _mm_and_si128( _mm_packus_epi16( lo, hi ), dst_mask ));
+    }
+    for ( ; x < len; x++) dst[x] = blend_pixel_c( dst[x], src[x], blend, op, swap_rb );
+}
+
+static BOOL blend_rect_sse2( const dib_info *dst, const RECT *rc, const dib_info *src,
+                             const POINT *origin, BLENDFUNCTION blend, BOOL swap_rb )
+{
+    DWORD *src_ptr = get_pixel_ptr_32( src, origin->x, origin->y );
+    DWORD *dst_ptr = get_pixel_ptr_32( dst, rc->left, rc->top );
+    enum blend_op op = get_blend_op( src, blend );
+    int y;
+
+    if (!have_sse2()) return FALSE;
+
+    for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
+        blend_row_sse2( dst_ptr, src_ptr, rc->right - rc->left, blend, op, swap_rb );
+    return TRUE;
+}
+
+#else  /* USE_SSE2 */
+
+static inline BOOL blend_rect_sse2( const dib_info *dst, const RECT *rc, const dib_info *src,
+                                    const POINT *origin, BLENDFUNCTION blend, BOOL swap_rb )
+{
+    return FALSE;
+}
+
+#endif  /* USE_SSE2 */
+
 static void blend_rect_8888(const dib_info *dst, const RECT *rc,
                             const dib_info *src, const POINT *origin, BLENDFUNCTION blend)
 {
@@ -4658,6 +4969,8 @@ static void blend_rect_8888(const dib_info *dst, const RECT *rc,
     DWORD *dst_ptr = get_pixel_ptr_32( dst, rc->left, rc->top );
     int x, y;
 
+    if (blend_rect_sse2( dst, rc, src, origin, blend, FALSE )) return;
+
     if (blend.AlphaFormat & AC_SRC_ALPHA)
     {
 	if (blend.SourceConstantAlpha == 255)
@@ -4686,6 +4999,11 @@ static void blend_rect_32(const dib_info *dst, const RECT *rc,
     DWORD *dst_ptr = get_pixel_ptr_32( dst, rc->left, rc->top );
     int x, y;
 
+    if (dst->red_shift == 0 && dst->green_shift == 8 && dst->blue_shift == 16 &&
+        dst->red_len == 8 && dst->green_len == 8 && dst->blue_len == 8 &&
+        blend_rect_sse2( dst, rc, src, origin, blend, TRUE ))
+        return;
+
     if (dst->red_len == 8 && dst->green_len == 8 && dst->blue_len == 8)
     {
         for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
@@ -6817,16 +7135,20 @@ static void stretch_row_32(const dib_info *dst_dib, const POINT *dst_start,
 
     if (mode == STRETCH_DELETESCANS || !keep_dst)
     {
+        /* keep the parameters in registers, the stores through dst_ptr could alias them */
+        const int dst_inc = params->dst_inc, src_inc = params->src_inc;
+        const int err_add_1 = params->err_add_1, err_add_2 = params->err_add_2;
+
         for (width = params->length; width; width--)
         {
             *dst_ptr = *src_ptr;
-            dst_ptr += params->dst_inc;
+            dst_ptr += dst_inc;
             if (err > 0)
             {
-                src_ptr += params->src_inc;
-                err += params->err_add_1;
+                src_ptr += src_inc;
+                err += err_add_1;
             }
-            else err += params->err_add_2;
+            else err += err_add_2;
         }
     }
     else
@@ -7072,16 +7394,19 @@ static void shrink_row_32(const dib_info *dst_dib, const POINT *dst_start,
 
     if (mode == STRETCH_DELETESCANS)
     {
+        const int dst_inc = params->dst_inc, src_inc = params->src_inc;
+        const int err_add_1 = params->err_add_1, err_add_2 = params->err_add_2;
+
         for (width = params->length; width; width--)
         {
             *dst_ptr = *src_ptr;
-            src_ptr += params->src_inc;
+            src_ptr += src_inc;
             if (err > 0)
             {
-                dst_ptr += params->dst_inc;
-                err += params->err_add_1;
+                dst_ptr += dst_inc;
+                err += err_add_1;
             }
-            else err += params->err_add_2;
+            else err += err_add_2;
         }
     }
     else
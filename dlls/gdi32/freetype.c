@@ -566,20 +566,65 @@ typedef struct tagFontSubst {
 static const WCHAR wine_fonts_key[] = {'S','o','f','t','w','a','r','e','\\','W','i','n','e','\\',
                                        'F','o','n','t','s',0};
 static const WCHAR wine_fonts_cache_key[] = {'C','a','c','h','e',0};
-static const WCHAR english_name_value[] = {'E','n','g','l','i','s','h',' ','N','a','m','e',0};
-static const WCHAR face_index_value[] = {'I','n','d','e','x',0};
-static const WCHAR face_ntmflags_value[] = {'N','t','m','f','l','a','g','s',0};
-static const WCHAR face_version_value[] = {'V','e','r','s','i','o','n',0};
-static const WCHAR face_height_value[] = {'H','e','i','g','h','t',0};
-static const WCHAR face_width_value[] = {'W','i','d','t','h',0};
-static const WCHAR face_size_value[] = {'S','i','z','e',0};
-static const WCHAR face_x_ppem_value[] = {'X','p','p','e','m',0};
-static const WCHAR face_y_ppem_value[] = {'Y','p','p','e','m',0};
-static const WCHAR face_flags_value[] = {'F','l','a','g','s',0};
-static const WCHAR face_internal_leading_value[] = {'I','n','t','e','r','n','a','l',' ','L','e','a','d','i','n','g',0};
-static const WCHAR face_font_sig_value[] = {'F','o','n','t',' ','S','i','g','n','a','t','u','r','e',0};
-static const WCHAR face_file_name_value[] = {'F','i','l','e',' ','N','a','m','e','\0'};
-static const WCHAR face_full_name_value[] = {'F','u','l','l',' ','N','a','m','e','\0'};
+static const WCHAR font_catalog_value[] = {'C','a','t','a','l','o','g',0};
+
+/* The font catalog is a file in the config dir holding the system font list.  It is
+ * mapped by all the processes of the session; the volatile registry cache key stores
+ * its stamp to tell it apart from stale copies.  The first process of a session reuses
+ * the catalog of the previous one if the font files it was built from didn't change,
+ * and only scans the font directories otherwise. */
+
+#define FONT_CATALOG_MAGIC   0x544e4f46  /* "FONT" */
+#define FONT_CATALOG_VERSION 2
+
+struct font_catalog_header
+{
+    DWORD magic;
+    DWORD version;
+    DWORD size;      /* size of the whole file */
+    DWORD count;     /* number of faces */
+    DWORD key[2];    /* hash of the font files it was built from, 0 if it can't be reused */
+    DWORD stamp[2];  /* must match the value stored in the registry cache key */
+};
+
+enum catalog_name
+{
+    CATALOG_FAMILY,
+    CATALOG_ENGLISH,
+    CATALOG_STYLE,
+    CATALOG_FULL,
+    CATALOG_FILE,
+    CATALOG_NAMES
+};
+
+struct font_catalog_face
+{
+    DWORD         size;               /* size of the entry including the names */
+    DWORD         face_index;
+    DWORD         ntm_flags;
+    DWORD         font_version;
+    DWORD         flags;
+    FONTSIGNATURE fs;
+    DWORD         scalable;
+    SHORT         height;             /* bitmap size, for non-scalable faces */
+    SHORT         width;
+    LONG          font_size;
+    LONG          x_ppem;
+    LONG          y_ppem;
+    SHORT         internal_leading;
+    WORD          names[CATALOG_NAMES]; /* length of each name including the null, 0 if missing */
+    /* followed by the names */
+};
+
+static inline const WCHAR *get_catalog_name( const struct font_catalog_face *entry, enum catalog_name name )
+{
+    const WCHAR *ptr = (const WCHAR *)(entry + 1);
+    int i;
+
+    if (!entry->names[name]) return NULL;
+    for (i = 0; i < name; i++) ptr += entry->names[i];
+    return ptr;
+}
 
 
 struct font_mapping
@@ -596,6 +641,8 @@ static struct list mappings_list = LIST_INIT( mappings_list );
 
 static UINT default_aa_flags;
 static HKEY hkey_font_cache;
+static HANDLE font_mutex;
+static BOOL font_catalog_busy;  /* loading or building the whole list */
 static BOOL antialias_fakes = TRUE;
 
 static CRITICAL_SECTION freetype_cs;
@@ -1604,102 +1651,202 @@ static LONG reg_load_dword(HKEY hkey, const WCHAR *value, DWORD *data)
     return ERROR_SUCCESS;
 }
 
-static inline LONG reg_load_ftlong(HKEY hkey, const WCHAR *value, FT_Long *data)
+static inline DWORD get_catalog_name_len( const WCHAR *name )
 {
-    DWORD dw;
-    LONG ret = reg_load_dword(hkey, value, &dw);
-    *data = dw;
-    return ret;
+    return name ? strlenW( name ) + 1 : 0;
 }
 
-static inline LONG reg_load_ftshort(HKEY hkey, const WCHAR *value, FT_Short *data)
+static int catalog_face_cmp( const struct font_catalog_face *f1, const struct font_catalog_face *f2 )
 {
-    DWORD dw;
-    LONG ret = reg_load_dword(hkey, value, &dw);
-    *data = dw;
+    int ret = strcmpiW( get_catalog_name( f1, CATALOG_FAMILY ), get_catalog_name( f2, CATALOG_FAMILY ));
+
+    if (!ret) ret = strcmpiW( get_catalog_name( f1, CATALOG_STYLE ), get_catalog_name( f2, CATALOG_STYLE ));
+    if (!ret) ret = f2->scalable - f1->scalable;
+    if (!ret && !f1->scalable) ret = f1->y_ppem - f2->y_ppem;
     return ret;
 }
 
-static inline LONG reg_save_dword(HKEY hkey, const WCHAR *value, DWORD data)
+static int catalog_face_ptr_cmp( const void *p1, const void *p2 )
 {
-    return RegSetValueExW(hkey, value, 0, REG_DWORD, (BYTE*)&data, sizeof(DWORD));
+    return catalog_face_cmp( *(const struct font_catalog_face * const *)p1,
+                             *(const struct font_catalog_face * const *)p2 );
 }
 
-static void load_face(HKEY hkey_face, WCHAR *face_name, Family *family, void *buffer, DWORD buffer_size)
+static struct font_catalog_face *create_catalog_face( const Face *face )
 {
-    DWORD needed, strike_index = 0;
-    HKEY hkey_strike;
+    const WCHAR *names[CATALOG_NAMES];
+    struct font_catalog_face *entry;
+    DWORD i, size = sizeof(*entry);
+    WCHAR *ptr;
+
+    names[CATALOG_FAMILY]  = face->family->FamilyName;
+    names[CATALOG_ENGLISH] = face->family->EnglishName;
+    names[CATALOG_STYLE]   = face->StyleName;
+    names[CATALOG_FULL]    = face->FullName;
+    names[CATALOG_FILE]    = face->file;
+    for (i = 0; i < CATALOG_NAMES; i++) size += get_catalog_name_len( names[i] ) * sizeof(WCHAR);
+    size = (size + 3) & ~3;
 
-    /* If we have a File Name key then this is a real font, not just the parent
-       key of a bunch of non-scalable strikes */
-    needed = buffer_size;
-    if (RegQueryValueExW(hkey_face, face_file_name_value, NULL, NULL, buffer, &needed) == ERROR_SUCCESS)
+    if (!(entry = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY, size ))) return NULL;
+    entry->size         = size;
+    entry->face_index   = face->face_index;
+    entry->ntm_flags    = face->ntmFlags;
+    entry->font_version = face->font_version;
+    entry->flags        = face->flags;
+    entry->fs           = face->fs;
+    entry->scalable     = face->scalable;
+    if (!face->scalable)
+    {
+        entry->height           = face->size.height;
+        entry->width            = face->size.width;
+        entry->font_size        = face->size.size;
+        entry->x_ppem           = face->size.x_ppem;
+        entry->y_ppem           = face->size.y_ppem;
+        entry->internal_leading = face->size.internal_leading;
+    }
+    for (i = 0, ptr = (WCHAR *)(entry + 1); i < CATALOG_NAMES; i++)
     {
-        Face *face;
-        face = HeapAlloc(GetProcessHeap(), 0, sizeof(*face));
-        face->cached_enum_data = NULL;
-        face->family = NULL;
+        if (!(entry->names[i] = get_catalog_name_len( names[i] ))) continue;
+        memcpy( ptr, names[i], entry->names[i] * sizeof(WCHAR) );
+        ptr += entry->names[i];
+    }
+    return entry;
+}
 
-        face->refcount = 1;
-        face->file = strdupW( buffer );
-        face->StyleName = strdupW(face_name);
+static char *get_font_catalog_path( const char *suffix )
+{
+    static const char nameA[] = "/fontcache";
+    const char *dir = wine_get_config_dir();
+    char *path;
 
-        needed = buffer_size;
-        if(RegQueryValueExW(hkey_face, face_full_name_value, NULL, NULL, buffer, &needed) == ERROR_SUCCESS)
-            face->FullName = strdupW( buffer );
-        else
-            face->FullName = NULL;
+    if (!dir) return NULL;
+    if ((path = HeapAlloc( GetProcessHeap(), 0, strlen(dir) + sizeof(nameA) + strlen(suffix) )))
+    {
+        strcpy( path, dir );
+        strcat( path, nameA );
+        strcat( path, suffix );
+    }
+    return path;
+}
 
-        reg_load_ftlong(hkey_face, face_index_value, &face->face_index);
-        reg_load_dword(hkey_face, face_ntmflags_value, &face->ntmFlags);
-        reg_load_ftlong(hkey_face, face_version_value, &face->font_version);
-        reg_load_dword(hkey_face, face_flags_value, &face->flags);
+static BOOL get_font_catalog_stamp( DWORD stamp[2] )
+{
+    DWORD type, size = 2 * sizeof(DWORD);
 
-        needed = sizeof(face->fs);
-        RegQueryValueExW(hkey_face, face_font_sig_value, NULL, NULL, (BYTE*)&face->fs, &needed);
+    return !RegQueryValueExW( hkey_font_cache, font_catalog_value, NULL, &type, (BYTE *)stamp, &size ) &&
+           type == REG_BINARY && size == 2 * sizeof(DWORD);
+}
 
-        if(reg_load_ftshort(hkey_face, face_height_value, &face->size.height) != ERROR_SUCCESS)
-        {
-            face->scalable = TRUE;
-            memset(&face->size, 0, sizeof(face->size));
-        }
-        else
-        {
-            face->scalable = FALSE;
-            reg_load_ftshort(hkey_face, face_width_value, &face->size.width);
-            reg_load_ftlong(hkey_face, face_size_value, &face->size.size);
-            reg_load_ftlong(hkey_face, face_x_ppem_value, &face->size.x_ppem);
-            reg_load_ftlong(hkey_face, face_y_ppem_value, &face->size.y_ppem);
-            reg_load_ftshort(hkey_face, face_internal_leading_value, &face->size.internal_leading);
-
-            TRACE("Adding bitmap size h %d w %d size %ld x_ppem %ld y_ppem %ld\n",
-                  face->size.height, face->size.width, face->size.size >> 6,
-                  face->size.x_ppem >> 6, face->size.y_ppem >> 6);
-        }
+/* check that a catalog entry fits in the file and that its names are properly terminated */
+static BOOL validate_catalog_face( const struct font_catalog_face *entry, DWORD size )
+{
+    const WCHAR *ptr = (const WCHAR *)(entry + 1);
+    DWORD i, len = sizeof(*entry);
+
+    if (size < sizeof(*entry) || entry->size < sizeof(*entry) || entry->size > size || (entry->size & 3))
+        return FALSE;
+    if (!entry->names[CATALOG_FAMILY] || !entry->names[CATALOG_STYLE] || !entry->names[CATALOG_FILE])
+        return FALSE;
+    for (i = 0; i < CATALOG_NAMES; i++)
+    {
+        if (!entry->names[i]) continue;
+        len += entry->names[i] * sizeof(WCHAR);
+        if (len > entry->size || ptr[entry->names[i] - 1]) return FALSE;
+        ptr += entry->names[i];
+    }
+    return TRUE;
+}
 
-        TRACE("fsCsb = %08x %08x/%08x %08x %08x %08x\n",
-              face->fs.fsCsb[0], face->fs.fsCsb[1],
-              face->fs.fsUsb[0], face->fs.fsUsb[1],
-              face->fs.fsUsb[2], face->fs.fsUsb[3]);
+/* map the font catalog, checking that it is consistent; it must be the catalog of
+ * the current session, or one built from the same font files if key is not NULL */
+static struct font_catalog_header *map_font_catalog( const DWORD key[2] )
+{
+    struct font_catalog_header *header;
+    const struct font_catalog_face *entry;
+    DWORD i, pos, stamp[2];
+    struct stat st;
+    char *path;
+    int fd;
 
-        if (insert_face_in_family_list(face, family))
-            TRACE("Added font %s %s\n", debugstr_w(family->FamilyName), debugstr_w(face->StyleName));
+    if (!key && !get_font_catalog_stamp( stamp )) return NULL;
+    if (!(path = get_font_catalog_path( "" ))) return NULL;
+    fd = open( path, O_RDONLY );
+    HeapFree( GetProcessHeap(), 0, path );
+    if (fd == -1) return NULL;
+
+    header = MAP_FAILED;
+    if (!fstat( fd, &st ) && st.st_size >= sizeof(*header) && st.st_size <= 0x7fffffff)
+        header = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd );
+    if (header == MAP_FAILED) return NULL;
 
-        release_face( face );
+    if (header->magic != FONT_CATALOG_MAGIC || header->version != FONT_CATALOG_VERSION ||
+        header->size != st.st_size)
+        goto invalid;
+    if (key)
+    {
+        if (header->key[0] != key[0] || header->key[1] != key[1]) goto stale;
     }
+    else if (header->stamp[0] != stamp[0] || header->stamp[1] != stamp[1]) goto invalid;
 
-    /* load bitmap strikes */
+    for (i = 0, pos = sizeof(*header); i < header->count; i++, pos += entry->size)
+    {
+        entry = (const struct font_catalog_face *)((const char *)header + pos);
+        if (!validate_catalog_face( entry, header->size - pos )) goto invalid;
+    }
+    if (pos == header->size) return header;
 
-    needed = buffer_size;
-    while (!RegEnumKeyExW(hkey_face, strike_index++, buffer, &needed, NULL, NULL, NULL, NULL))
+invalid:
+    WARN( "ignoring invalid font catalog\n" );
+stale:
+    munmap( header, st.st_size );
+    return NULL;
+}
+
+static inline const struct font_catalog_face *get_catalog_face( const struct font_catalog_header *header,
+                                                                const struct font_catalog_face *entry )
+{
+    if (!entry) return (const struct font_catalog_face *)(header + 1);
+    return (const struct font_catalog_face *)((const char *)entry + entry->size);
+}
+
+static void load_catalog_face( const struct font_catalog_face *entry, Family *family )
+{
+    Face *face = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*face) );
+
+    face->refcount     = 1;
+    face->file         = strdupW( get_catalog_name( entry, CATALOG_FILE ));
+    face->StyleName    = strdupW( get_catalog_name( entry, CATALOG_STYLE ));
+    if (entry->names[CATALOG_FULL]) face->FullName = strdupW( get_catalog_name( entry, CATALOG_FULL ));
+    face->face_index   = entry->face_index;
+    face->ntmFlags     = entry->ntm_flags;
+    face->font_version = entry->font_version;
+    face->flags        = entry->flags;
+    face->fs           = entry->fs;
+    face->scalable     = entry->scalable;
+    if (!face->scalable)
     {
-        if (!RegOpenKeyExW(hkey_face, buffer, 0, KEY_ALL_ACCESS, &hkey_strike))
-        {
-            load_face(hkey_strike, face_name, family, buffer, buffer_size);
-            RegCloseKey(hkey_strike);
-        }
-        needed = buffer_size;
+        face->size.height           = entry->height;
+        face->size.width            = entry->width;
+        face->size.size             = entry->font_size;
+        face->size.x_ppem           = entry->x_ppem;
+        face->size.y_ppem           = entry->y_ppem;
+        face->size.internal_leading = entry->internal_leading;
+
+        TRACE("Adding bitmap size h %d w %d size %ld x_ppem %ld y_ppem %ld\n",
+              face->size.height, face->size.width, face->size.size >> 6,
+              face->size.x_ppem >> 6, face->size.y_ppem >> 6);
     }
+
+    TRACE("fsCsb = %08x %08x/%08x %08x %08x %08x\n",
+          face->fs.fsCsb[0], face->fs.fsCsb[1],
+          face->fs.fsUsb[0], face->fs.fsUsb[1],
+          face->fs.fsUsb[2], face->fs.fsUsb[3]);
+
+    if (insert_face_in_family_list(face, family))
+        TRACE("Added font %s %s\n", debugstr_w(family->FamilyName), debugstr_w(face->StyleName));
+
+    release_face( face );
 }
 
 /* move vertical fonts after their horizontal counterpart */
@@ -1734,58 +1881,50 @@ static void reorder_vertical_fonts(void)
     list_move_tail( &font_list, &vertical_families );
 }
 
-static void load_font_list_from_cache(HKEY hkey_font_cache)
+static BOOL load_font_catalog( const DWORD key[2] )
 {
-    DWORD size, family_index = 0;
-    Family *family;
-    HKEY hkey_family;
-    WCHAR buffer[4096];
+    struct font_catalog_header *header;
+    const struct font_catalog_face *entry = NULL;
+    Family *family = NULL;
+    DWORD i;
 
-    size = sizeof(buffer);
-    while (!RegEnumKeyExW(hkey_font_cache, family_index++, buffer, &size, NULL, NULL, NULL, NULL))
-    {
-        WCHAR *english_family = NULL;
-        WCHAR *family_name = strdupW( buffer );
-        DWORD face_index = 0;
+    if (!(header = map_font_catalog( key ))) return FALSE;
 
-        RegOpenKeyExW(hkey_font_cache, family_name, 0, KEY_ALL_ACCESS, &hkey_family);
-        TRACE("opened family key %s\n", debugstr_w(family_name));
-        size = sizeof(buffer);
-        if (!RegQueryValueExW(hkey_family, english_name_value, NULL, NULL, (BYTE *)buffer, &size))
-            english_family = strdupW( buffer );
-
-        family = create_family(family_name, english_family);
+    TRACE( "loading %u faces from the font catalog\n", header->count );
+    font_catalog_busy = TRUE;
+    for (i = 0; i < header->count; i++)
+    {
+        const WCHAR *family_name, *english_name;
 
-        if(english_family)
-        {
-            FontSubst *subst = HeapAlloc(GetProcessHeap(), 0, sizeof(*subst));
-            subst->from.name = strdupW(english_family);
-            subst->from.charset = -1;
-            subst->to.name = strdupW(family_name);
-            subst->to.charset = -1;
-            add_font_subst(&font_subst_list, subst, 0);
-        }
+        entry = get_catalog_face( header, entry );
+        family_name = get_catalog_name( entry, CATALOG_FAMILY );
+        english_name = get_catalog_name( entry, CATALOG_ENGLISH );
 
-        size = sizeof(buffer);
-        while (!RegEnumKeyExW(hkey_family, face_index++, buffer, &size, NULL, NULL, NULL, NULL))
+        /* entries are sorted, so all the faces of a family follow each other */
+        if (!family || strcmpiW( family->FamilyName, family_name ))
         {
-            WCHAR *face_name = strdupW( buffer );
-            HKEY hkey_face;
+            if (family) release_family( family );
+            family = create_family( strdupW( family_name ), english_name ? strdupW( english_name ) : NULL );
+            TRACE("loading family %s\n", debugstr_w(family_name));
 
-            if (!RegOpenKeyExW(hkey_family, face_name, 0, KEY_ALL_ACCESS, &hkey_face))
+            if (english_name)
             {
-                load_face(hkey_face, face_name, family, buffer, sizeof(buffer));
-                RegCloseKey(hkey_face);
+                FontSubst *subst = HeapAlloc(GetProcessHeap(), 0, sizeof(*subst));
+                subst->from.name = strdupW(english_name);
+                subst->from.charset = -1;
+                subst->to.name = strdupW(family_name);
+                subst->to.charset = -1;
+                add_font_subst(&font_subst_list, subst, 0);
             }
-            HeapFree( GetProcessHeap(), 0, face_name );
-            size = sizeof(buffer);
         }
-        RegCloseKey(hkey_family);
-        release_family( family );
-        size = sizeof(buffer);
+        load_catalog_face( entry, family );
     }
+    if (family) release_family( family );
+    font_catalog_busy = FALSE;
 
+    munmap( header, header->size );
     reorder_vertical_fonts();
+    return TRUE;
 }
 
 static LONG create_font_cache_key(HKEY *hkey, DWORD *disposition)
@@ -1808,75 +1947,134 @@ static LONG create_font_cache_key(HKEY *hkey, DWORD *disposition)
     return ret;
 }
 
-static void add_face_to_cache(Face *face)
+/* write the catalog to a temporary file and rename it over the current one,
+ * so that processes mapping the previous one are not affected */
+static BOOL write_font_catalog( struct font_catalog_face **entries, DWORD count,
+                                const DWORD key[2], const DWORD stamp[2] )
 {
-    HKEY hkey_family, hkey_face;
-    WCHAR *face_key_name;
-
-    RegCreateKeyExW(hkey_font_cache, face->family->FamilyName, 0,
-                    NULL, REG_OPTION_VOLATILE, KEY_ALL_ACCESS, NULL, &hkey_family, NULL);
-    if(face->family->EnglishName)
-        RegSetValueExW(hkey_family, english_name_value, 0, REG_SZ, (BYTE*)face->family->EnglishName,
-                       (strlenW(face->family->EnglishName) + 1) * sizeof(WCHAR));
+    struct font_catalog_header header;
+    char suffix[16], *path, *tmp_path;
+    BOOL ret = FALSE;
+    DWORD i;
+    int fd;
 
-    if(face->scalable)
-        face_key_name = face->StyleName;
-    else
-    {
-        static const WCHAR fmtW[] = {'%','s','\\','%','d',0};
-        face_key_name = HeapAlloc(GetProcessHeap(), 0, (strlenW(face->StyleName) + 10) * sizeof(WCHAR));
-        sprintfW(face_key_name, fmtW, face->StyleName, face->size.y_ppem);
+    qsort( entries, count, sizeof(*entries), catalog_face_ptr_cmp );
+
+    header.magic    = FONT_CATALOG_MAGIC;
+    header.version  = FONT_CATALOG_VERSION;
+    header.size     = sizeof(header);
+    header.count    = count;
+    header.key[0]   = key ? key[0] : 0;
+    header.key[1]   = key ? key[1] : 0;
+    header.stamp[0] = stamp[0];
+    header.stamp[1] = stamp[1];
+    for (i = 0; i < count; i++) header.size += entries[i]->size;
+
+    sprintf( suffix, ".%04x", GetCurrentProcessId() );
+    path = get_font_catalog_path( "" );
+    tmp_path = get_font_catalog_path( suffix );
+    if (path && tmp_path && (fd = open( tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0666 )) != -1)
+    {
+        ret = write( fd, &header, sizeof(header) ) == sizeof(header);
+        for (i = 0; ret && i < count; i++)
+            ret = write( fd, entries[i], entries[i]->size ) == entries[i]->size;
+        close( fd );
+        if (ret) ret = !rename( tmp_path, path );
+        if (!ret)
+        {
+            WARN( "failed to write the font catalog %s\n", debugstr_a(path) );
+            unlink( tmp_path );
+        }
     }
-    RegCreateKeyExW(hkey_family, face_key_name, 0, NULL, REG_OPTION_VOLATILE, KEY_ALL_ACCESS, NULL,
-                    &hkey_face, NULL);
-    if(!face->scalable)
-        HeapFree(GetProcessHeap(), 0, face_key_name);
+    HeapFree( GetProcessHeap(), 0, tmp_path );
+    HeapFree( GetProcessHeap(), 0, path );
+    return ret;
+}
 
-    RegSetValueExW(hkey_face, face_file_name_value, 0, REG_SZ, (BYTE *)face->file,
-                   (strlenW(face->file) + 1) * sizeof(WCHAR));
-    if (face->FullName)
-        RegSetValueExW(hkey_face, face_full_name_value, 0, REG_SZ, (BYTE*)face->FullName,
-                       (strlenW(face->FullName) + 1) * sizeof(WCHAR));
+/* save the font list of a new session, the registry cache key only remembers the catalog stamp */
+static void save_font_catalog( const DWORD key[2] )
+{
+    struct font_catalog_face **entries;
+    Family *family;
+    Face *face;
+    FILETIME time;
+    DWORD i, count = 0, stamp[2];
+
+    LIST_FOR_EACH_ENTRY( family, &font_list, Family, entry )
+        LIST_FOR_EACH_ENTRY( face, &family->faces, Face, entry )
+            if (face->flags & ADDFONT_ADD_TO_CACHE) count++;
 
-    reg_save_dword(hkey_face, face_index_value, face->face_index);
-    reg_save_dword(hkey_face, face_ntmflags_value, face->ntmFlags);
-    reg_save_dword(hkey_face, face_version_value, face->font_version);
-    if (face->flags) reg_save_dword(hkey_face, face_flags_value, face->flags);
+    if (!(entries = HeapAlloc( GetProcessHeap(), 0, count * sizeof(*entries) ))) return;
+
+    i = 0;
+    LIST_FOR_EACH_ENTRY( family, &font_list, Family, entry )
+        LIST_FOR_EACH_ENTRY( face, &family->faces, Face, entry )
+            if ((face->flags & ADDFONT_ADD_TO_CACHE) && (entries[i] = create_catalog_face( face ))) i++;
+    count = i;
 
-    RegSetValueExW(hkey_face, face_font_sig_value, 0, REG_BINARY, (BYTE*)&face->fs, sizeof(face->fs));
+    GetSystemTimeAsFileTime( &time );
+    stamp[0] = time.dwLowDateTime;
+    stamp[1] = time.dwHighDateTime ^ GetCurrentProcessId();
 
-    if(!face->scalable)
+    if (write_font_catalog( entries, count, key, stamp ))
     {
-        reg_save_dword(hkey_face, face_height_value, face->size.height);
-        reg_save_dword(hkey_face, face_width_value, face->size.width);
-        reg_save_dword(hkey_face, face_size_value, face->size.size);
-        reg_save_dword(hkey_face, face_x_ppem_value, face->size.x_ppem);
-        reg_save_dword(hkey_face, face_y_ppem_value, face->size.y_ppem);
-        reg_save_dword(hkey_face, face_internal_leading_value, face->size.internal_leading);
+        TRACE( "saved %u faces in the font catalog\n", count );
+        RegSetValueExW( hkey_font_cache, font_catalog_value, 0, REG_BINARY, (BYTE *)stamp, sizeof(stamp) );
     }
-    RegCloseKey(hkey_face);
-    RegCloseKey(hkey_family);
+    else RegDeleteValueW( hkey_font_cache, font_catalog_value );
+
+    for (i = 0; i < count; i++) HeapFree( GetProcessHeap(), 0, entries[i] );
+    HeapFree( GetProcessHeap(), 0, entries );
 }
 
-static void remove_face_from_cache( Face *face )
+/* add and/or remove a face from the shared catalog, e.g. for AddFontResource */
+static void update_font_catalog( const Face *add, const Face *remove )
 {
-    HKEY hkey_family;
+    struct font_catalog_header *header;
+    const struct font_catalog_face *entry = NULL;
+    struct font_catalog_face *new_entry = NULL, **entries;
+    DWORD i, count = 0;
 
-    RegOpenKeyExW( hkey_font_cache, face->family->FamilyName, 0, KEY_ALL_ACCESS, &hkey_family );
+    if (font_catalog_busy) return;
 
-    if (face->scalable)
-    {
-        RegDeleteKeyW( hkey_family, face->StyleName );
-    }
-    else
+    WaitForSingleObject( font_mutex, INFINITE );
+
+    if (!(header = map_font_catalog( NULL ))) goto done;
+    if (add && !(new_entry = create_catalog_face( add ))) goto done;
+
+    if ((entries = HeapAlloc( GetProcessHeap(), 0, (header->count + 1) * sizeof(*entries) )))
     {
-        static const WCHAR fmtW[] = {'%','s','\\','%','d',0};
-        WCHAR *face_key_name = HeapAlloc(GetProcessHeap(), 0, (strlenW(face->StyleName) + 10) * sizeof(WCHAR));
-        sprintfW(face_key_name, fmtW, face->StyleName, face->size.y_ppem);
-        RegDeleteKeyW( hkey_family, face_key_name );
-        HeapFree(GetProcessHeap(), 0, face_key_name);
+        struct font_catalog_face *removed = remove ? create_catalog_face( remove ) : NULL;
+
+        for (i = 0; i < header->count; i++)
+        {
+            entry = get_catalog_face( header, entry );
+            if (new_entry && !catalog_face_cmp( entry, new_entry )) continue;
+            if (removed && !catalog_face_cmp( entry, removed )) continue;
+            entries[count++] = (struct font_catalog_face *)entry;
+        }
+        if (new_entry) entries[count++] = new_entry;
+
+        /* the next session can't reuse fonts added or removed in this one */
+        write_font_catalog( entries, count, NULL, header->stamp );
+        HeapFree( GetProcessHeap(), 0, removed );
+        HeapFree( GetProcessHeap(), 0, entries );
     }
-    RegCloseKey(hkey_family);
+
+done:
+    if (header) munmap( header, header->size );
+    HeapFree( GetProcessHeap(), 0, new_entry );
+    ReleaseMutex( font_mutex );
+}
+
+static void add_face_to_cache( Face *face )
+{
+    update_font_catalog( face, NULL );
+}
+
+static void remove_face_from_cache( Face *face )
+{
+    update_font_catalog( NULL, face );
 }
 
 static WCHAR *prepend_at(WCHAR *family)
@@ -2709,6 +2907,53 @@ skip_internal:
     return ret;
 }
 
+/* 64-bit FNV-1a hash, used for the font catalog key */
+static void hash_font_data( ULONGLONG *hash, const void *data, SIZE_T size )
+{
+    const BYTE *ptr = data;
+
+    while (size--) *hash = (*hash ^ *ptr++) * (((ULONGLONG)0x100 << 32) | 0x1b3);
+}
+
+static void hash_font_file( ULONGLONG *hash, const char *path, const struct stat *st )
+{
+    ULONGLONG info[5];
+
+    info[0] = st->st_dev;
+    info[1] = st->st_ino;
+    info[2] = st->st_size;
+    info[3] = st->st_mtime;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    info[4] = st->st_mtim.tv_nsec;
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC)
+    info[4] = st->st_mtimespec.tv_nsec;
+#else
+    info[4] = 0;
+#endif
+    hash_font_data( hash, path, strlen( path ) + 1 );
+    hash_font_data( hash, info, sizeof(info) );
+}
+
+/* hash the files that ReadFontDir would load */
+static void hash_font_dir( ULONGLONG *hash, const char *dirname )
+{
+    DIR *dir;
+    struct dirent *dent;
+    struct stat st;
+    char path[MAX_PATH];
+
+    if (!(dir = opendir( dirname ))) return;
+    while ((dent = readdir( dir )))
+    {
+        if (!strcmp( dent->d_name, "." ) || !strcmp( dent->d_name, ".." )) continue;
+        sprintf( path, "%s/%s", dirname, dent->d_name );
+        if (stat( path, &st ) == -1) continue;
+        if (S_ISDIR( st.st_mode )) hash_font_dir( hash, path );
+        else hash_font_file( hash, path, &st );
+    }
+    closedir( dir );
+}
+
 static BOOL ReadFontDir(const char *dirname, BOOL external_fonts)
 {
     DIR *dir;
@@ -2750,6 +2995,59 @@ static BOOL ReadFontDir(const char *dirname, BOOL external_fonts)
     return TRUE;
 }
 
+/* load the fonts of the directories specified in the config file,
+ * or only hash their files for the font catalog key if hash is not NULL */
+static void read_font_path_dirs( ULONGLONG *hash )
+{
+    static const WCHAR pathW[] = {'P','a','t','h',0};
+    HKEY hkey;
+    char *unixname;
+
+    /* @@ Wine registry key: HKCU\Software\Wine\Fonts */
+    if(RegOpenKeyA(HKEY_CURRENT_USER, "Software\\Wine\\Fonts", &hkey) == ERROR_SUCCESS)
+    {
+        DWORD len;
+        LPWSTR valueW;
+        LPSTR valueA, ptr;
+
+        if (RegQueryValueExW( hkey, pathW, NULL, NULL, NULL, &len ) == ERROR_SUCCESS)
+        {
+            len += sizeof(WCHAR);
+            valueW = HeapAlloc( GetProcessHeap(), 0, len );
+            if (RegQueryValueExW( hkey, pathW, NULL, NULL, (LPBYTE)valueW, &len ) == ERROR_SUCCESS)
+            {
+                len = WideCharToMultiByte( CP_UNIXCP, 0, valueW, -1, NULL, 0, NULL, NULL );
+                valueA = HeapAlloc( GetProcessHeap(), 0, len );
+                WideCharToMultiByte( CP_UNIXCP, 0, valueW, -1, valueA, len, NULL, NULL );
+                TRACE( "got font path %s\n", debugstr_a(valueA) );
+                if (hash) hash_font_data( hash, valueA, len );
+                ptr = valueA;
+                while (ptr)
+                {
+                    const char* home;
+                    LPSTR next = strchr( ptr, ':' );
+                    if (next) *next++ = 0;
+                    if (ptr[0] == '~' && ptr[1] == '/' && (home = getenv( "HOME" )) &&
+                        (unixname = HeapAlloc( GetProcessHeap(), 0, strlen(ptr) + strlen(home) )))
+                    {
+                        strcpy( unixname, home );
+                        strcat( unixname, ptr + 1 );
+                        if (hash) hash_font_dir( hash, unixname );
+                        else ReadFontDir( unixname, TRUE );
+                        HeapFree( GetProcessHeap(), 0, unixname );
+                    }
+                    else if (hash) hash_font_dir( hash, ptr );
+                    else ReadFontDir( ptr, TRUE );
+                    ptr = next;
+                }
+                HeapFree( GetProcessHeap(), 0, valueA );
+            }
+            HeapFree( GetProcessHeap(), 0, valueW );
+        }
+        RegCloseKey(hkey);
+    }
+}
+
 #ifdef SONAME_LIBFONTCONFIG
 
 static BOOL fontconfig_enabled;
@@ -2866,6 +3164,43 @@ static void load_fontconfig_fonts(void)
     pFcPatternDestroy(pat);
 }
 
+/* hash the files that load_fontconfig_fonts would load, along with their antialiasing flags */
+static void hash_fontconfig_fonts( ULONGLONG *hash )
+{
+    FcPattern *pat;
+    FcObjectSet *os;
+    FcFontSet *fontset;
+    struct stat st;
+    char *file;
+    UINT aa_flags;
+    int i;
+
+    if (!fontconfig_enabled) return;
+
+    pat = pFcPatternCreate();
+    os = pFcObjectSetCreate();
+    pFcObjectSetAdd( os, FC_FILE );
+    pFcObjectSetAdd( os, FC_SCALABLE );
+    pFcObjectSetAdd( os, FC_ANTIALIAS );
+    pFcObjectSetAdd( os, FC_RGBA );
+    if ((fontset = pFcFontList( NULL, pat, os )))
+    {
+        for (i = 0; i < fontset->nfont; i++)
+        {
+            if (pFcPatternGetString( fontset->fonts[i], FC_FILE, 0, (FcChar8 **)&file ) != FcResultMatch)
+                continue;
+            if (stat( file, &st ) == -1) continue;
+            pFcConfigSubstitute( NULL, fontset->fonts[i], FcMatchFont );
+            aa_flags = parse_aa_pattern( fontset->fonts[i] );
+            hash_font_file( hash, file, &st );
+            hash_font_data( hash, &aa_flags, sizeof(aa_flags) );
+        }
+        pFcFontSetDestroy( fontset );
+    }
+    pFcObjectSetDestroy( os );
+    pFcPatternDestroy( pat );
+}
+
 #elif defined(HAVE_CARBON_CARBON_H)
 
 static void load_mac_font_callback(const void *value, void *context)
@@ -4174,7 +4509,6 @@ sym_not_found:
 static void init_font_list(void)
 {
     static const WCHAR dot_fonW[] = {'.','f','o','n','\0'};
-    static const WCHAR pathW[] = {'P','a','t','h',0};
     HKEY hkey;
     DWORD valuelen, datalen, i = 0, type, dlen, vlen;
     WCHAR windowsdir[MAX_PATH];
@@ -4265,47 +4599,7 @@ static void init_font_list(void)
 #endif
 
     /* then look in any directories that we've specified in the config file */
-    /* @@ Wine registry key: HKCU\Software\Wine\Fonts */
-    if(RegOpenKeyA(HKEY_CURRENT_USER, "Software\\Wine\\Fonts", &hkey) == ERROR_SUCCESS)
-    {
-        DWORD len;
-        LPWSTR valueW;
-        LPSTR valueA, ptr;
-
-        if (RegQueryValueExW( hkey, pathW, NULL, NULL, NULL, &len ) == ERROR_SUCCESS)
-        {
-            len += sizeof(WCHAR);
-            valueW = HeapAlloc( GetProcessHeap(), 0, len );
-            if (RegQueryValueExW( hkey, pathW, NULL, NULL, (LPBYTE)valueW, &len ) == ERROR_SUCCESS)
-            {
-                len = WideCharToMultiByte( CP_UNIXCP, 0, valueW, -1, NULL, 0, NULL, NULL );
-                valueA = HeapAlloc( GetProcessHeap(), 0, len );
-                WideCharToMultiByte( CP_UNIXCP, 0, valueW, -1, valueA, len, NULL, NULL );
-                TRACE( "got font path %s\n", debugstr_a(valueA) );
-                ptr = valueA;
-                while (ptr)
-                {
-                    const char* home;
-                    LPSTR next = strchr( ptr, ':' );
-                    if (next) *next++ = 0;
-                    if (ptr[0] == '~' && ptr[1] == '/' && (home = getenv( "HOME" )) &&
-                        (unixname = HeapAlloc( GetProcessHeap(), 0, strlen(ptr) + strlen(home) )))
-                    {
-                        strcpy( unixname, home );
-                        strcat( unixname, ptr + 1 );
-                        ReadFontDir( unixname, TRUE );
-                        HeapFree( GetProcessHeap(), 0, unixname );
-                    }
-                    else
-                        ReadFontDir( ptr, TRUE );
-                    ptr = next;
-                }
-                HeapFree( GetProcessHeap(), 0, valueA );
-            }
-            HeapFree( GetProcessHeap(), 0, valueW );
-        }
-        RegCloseKey(hkey);
-    }
+    read_font_path_dirs( NULL );
 }
 
 static BOOL move_to_front(const WCHAR *name)
@@ -4341,6 +4635,66 @@ static void reorder_font_list(void)
     set_default( default_sans_list );
 }
 
+#if !defined(SONAME_LIBFONTCONFIG) && defined(HAVE_CARBON_CARBON_H)
+
+static BOOL get_font_catalog_key( DWORD key[2] )
+{
+    return FALSE;  /* the fonts found by CoreText can't be listed without loading them */
+}
+
+#else
+
+static void hash_font_reg_key( ULONGLONG *hash, HKEY root, const WCHAR *name )
+{
+    FILETIME time;
+    HKEY hkey;
+
+    if (RegOpenKeyW( root, name, &hkey )) return;
+    if (!RegQueryInfoKeyW( hkey, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, &time ))
+        hash_font_data( hash, &time, sizeof(time) );
+    RegCloseKey( hkey );
+}
+
+/* compute a hash of the font files and settings that init_font_list depends on,
+ * so that a font catalog built from the same files can be reused */
+static BOOL get_font_catalog_key( DWORD key[2] )
+{
+    ULONGLONG hash = ((ULONGLONG)0xcbf29ce4 << 32) | 0x84222325;
+    LCID lcid = GetSystemDefaultLCID();
+    WCHAR windowsdir[MAX_PATH];
+    char *unixname;
+
+    hash_font_data( &hash, &FT_SimpleVersion, sizeof(FT_SimpleVersion) );
+    hash_font_data( &hash, &lcid, sizeof(lcid) );
+    hash_font_reg_key( &hash, HKEY_CURRENT_CONFIG, system_fonts_reg_key );
+    hash_font_reg_key( &hash, HKEY_LOCAL_MACHINE, is_win9x() ? win9x_font_reg_key : winnt_font_reg_key );
+
+    GetWindowsDirectoryW( windowsdir, sizeof(windowsdir) / sizeof(WCHAR) );
+    strcatW( windowsdir, fontsW );
+    if ((unixname = wine_get_unix_file_name( windowsdir )))
+    {
+        hash_font_dir( &hash, unixname );
+        HeapFree( GetProcessHeap(), 0, unixname );
+    }
+    if ((unixname = get_font_dir()))
+    {
+        hash_font_dir( &hash, unixname );
+        HeapFree( GetProcessHeap(), 0, unixname );
+    }
+#ifdef SONAME_LIBFONTCONFIG
+    hash_fontconfig_fonts( &hash );
+#elif defined(__ANDROID__)
+    hash_font_dir( &hash, "/system/fonts" );
+#endif
+    read_font_path_dirs( &hash );
+
+    key[0] = (DWORD)hash;
+    key[1] = (DWORD)(hash >> 32);
+    return key[0] || key[1];
+}
+
+#endif
+
 /*************************************************************
  *    WineEngInit
  *
@@ -4349,8 +4703,7 @@ static void reorder_font_list(void)
 BOOL WineEngInit(void)
 {
     HKEY hkey;
-    DWORD disposition;
-    HANDLE font_mutex;
+    DWORD disposition, key[2];
 
     /* update locale dependent font info in registry */
     update_font_info();
@@ -4387,10 +4740,19 @@ BOOL WineEngInit(void)
 
     create_font_cache_key(&hkey_font_cache, &disposition);
 
-    if(disposition == REG_CREATED_NEW_KEY)
-        init_font_list();
-    else
-        load_font_list_from_cache(hkey_font_cache);
+    if (disposition == REG_CREATED_NEW_KEY || !load_font_catalog( NULL ))
+    {
+        BOOL have_key = get_font_catalog_key( key );
+
+        /* a new session reuses the catalog of the previous one if no font file changed */
+        if (!have_key || disposition != REG_CREATED_NEW_KEY || !load_font_catalog( key ))
+        {
+            font_catalog_busy = TRUE;
+            init_font_list();
+            font_catalog_busy = FALSE;
+        }
+        save_font_catalog( have_key ? key : NULL );
+    }
 
     reorder_font_list();
 
@@ -3821,6 +3821,324 @@ static void test_GdiAlphaBlend(void)
     HeapFree(GetProcessHeap(), 0, bmi);
 }
 
+static DWORD blend_pixel_ref( DWORD dst, DWORD src, BLENDFUNCTION blend )
+{
+    DWORD alpha = blend.SourceConstantAlpha, ret = 0;
+    int i;
+
+    if (blend.AlphaFormat & AC_SRC_ALPHA)
+    {
+        for (i = 0; i < 32; i += 8)
+            src = (src & ~(0xff << i)) | ((((src >> i) & 0xff) * alpha + 127) / 255) << i;
+        alpha = src >> 24;
+        for (i = 0; i < 32; i += 8)
+            ret |= (((src >> i) & 0xff) + (((dst >> i) & 0xff) * (255 - alpha) + 127) / 255) << i;
+        return ret;
+    }
+    for (i = 0; i < 32; i += 8)
+        ret |= ((((src >> i) & 0xff) * alpha + ((dst >> i) & 0xff) * (255 - alpha) + 127) / 255) << i;
+    return ret;
+}
+
+static DWORD swap_red_blue( DWORD pixel )
+{
+    return (pixel & 0xff00ff00) | ((pixel >> 16) & 0xff) | ((pixel & 0xff) << 16);
+}
+
+static void test_GdiAlphaBlend_pixels(void)
+{
+    static const BLENDFUNCTION blends[] =
+    {
+        { AC_SRC_OVER, 0, 255, AC_SRC_ALPHA },
+        { AC_SRC_OVER, 0, 100, AC_SRC_ALPHA },
+        { AC_SRC_OVER, 0, 100, 0 },
+    };
+    const int width = 67, height = 3;
+    BITMAPINFO *bmi;
+    HDC hdc_dst, hdc_src;
+    HBITMAP bmp_dst, bmp_src;
+    DWORD *dst_bits, *src_bits, *expect;
+    unsigned int i, j, alpha, bitfields, premultiplied;
+
+    if (!pGdiAlphaBlend)
+    {
+        win_skip("GdiAlphaBlend() is not implemented\n");
+        return;
+    }
+
+    bmi = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY, FIELD_OFFSET( BITMAPINFO, bmiColors[3] ));
+    bmi->bmiHeader.biSize = sizeof(bmi->bmiHeader);
+    bmi->bmiHeader.biWidth = width;
+    bmi->bmiHeader.biHeight = -height;
+    bmi->bmiHeader.biBitCount = 32;
+    bmi->bmiHeader.biPlanes = 1;
+    bmi->bmiHeader.biCompression = BI_RGB;
+
+    hdc_dst = CreateCompatibleDC( 0 );
+    hdc_src = CreateCompatibleDC( 0 );
+    bmp_src = CreateDIBSection( hdc_src, bmi, DIB_RGB_COLORS, (void **)&src_bits, NULL, 0 );
+    SelectObject( hdc_src, bmp_src );
+    expect = HeapAlloc( GetProcessHeap(), 0, width * height * sizeof(DWORD) );
+
+    /* odd width to exercise both the vectorized and the remaining pixels */
+    srand( 1234 );
+    for (bitfields = 0; bitfields < 2; bitfields++)
+    {
+        /* the bitfields destination has red in the low byte and doesn't store alpha */
+        bmi->bmiHeader.biCompression = bitfields ? BI_BITFIELDS : BI_RGB;
+        ((DWORD *)bmi->bmiColors)[0] = 0x0000ff;
+        ((DWORD *)bmi->bmiColors)[1] = 0x00ff00;
+        ((DWORD *)bmi->bmiColors)[2] = 0xff0000;
+        bmp_dst = CreateDIBSection( hdc_dst, bmi, DIB_RGB_COLORS, (void **)&dst_bits, NULL, 0 );
+        SelectObject( hdc_dst, bmp_dst );
+
+        for (premultiplied = 0; premultiplied < 2; premultiplied++)
+        {
+            for (i = 0; i < sizeof(blends) / sizeof(blends[0]); i++)
+            {
+                for (j = 0; j < width * height; j++)
+                {
+                    alpha = rand() & 0xff;
+                    if (!(j % 7)) alpha = 0;
+                    if (!(j % 11)) alpha = 0xff;
+                    if (premultiplied)
+                        src_bits[j] = (alpha << 24) | (alpha ? (rand() % (alpha + 1)) << 16 |
+                                                                (rand() % (alpha + 1)) << 8 |
+                                                                (rand() % (alpha + 1)) : 0);
+                    else
+                        src_bits[j] = (alpha << 24) | (rand() & 0xff) << 16 | (rand() & 0xffff);
+                    dst_bits[j] = (rand() & 0xffff) << 16 | (rand() & 0xffff);
+                    if (bitfields)
+                        expect[j] = swap_red_blue( blend_pixel_ref( swap_red_blue( dst_bits[j] ), src_bits[j],
+                                                                    blends[i] )) & 0x00ffffff;
+                    else
+                        expect[j] = blend_pixel_ref( dst_bits[j], src_bits[j], blends[i] );
+                }
+                pGdiAlphaBlend( hdc_dst, 0, 0, width, height, hdc_src, 0, 0, width, height, blends[i] );
+                for (j = 0; j < width * height; j++)
+                    if (dst_bits[j] != expect[j]) break;
+                /* channels overflow with non-premultiplied sources, the results are not specified */
+                ok( j == width * height || broken(!premultiplied && (blends[i].AlphaFormat & AC_SRC_ALPHA)),
+                    "%u/%u/%u: pixel %u got %08x expected %08x\n", bitfields, premultiplied, i, j,
+                    j < width * height ? dst_bits[j] : 0, j < width * height ? expect[j] : 0 );
+            }
+        }
+        DeleteObject( bmp_dst );
+    }
+
+    DeleteDC( hdc_dst );
+    DeleteDC( hdc_src );
+    DeleteObject( bmp_src );
+    HeapFree( GetProcessHeap(), 0, expect );
+    HeapFree( GetProcessHeap(), 0, bmi );
+}
+
+static void test_large_blits(void)
+{
+    static const BLENDFUNCTION blend = { AC_SRC_OVER, 0, 128, AC_SRC_ALPHA };
+    const int width = 509, height = 515;  /* big enough to be split in bands, odd to leave a partial one */
+    BITMAPINFO bmi;
+    HDC hdc_dst, hdc_src;
+    HBITMAP bmp_dst, bmp_src;
+    DWORD *dst_bits, *src_bits, *expect;
+    int x, y;
+
+    memset( &bmi, 0, sizeof(bmi) );
+    bmi.bmiHeader.biSize = sizeof(bmi.bmiHeader);
+    bmi.bmiHeader.biWidth = width;
+    bmi.bmiHeader.biHeight = -height;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    hdc_dst = CreateCompatibleDC( 0 );
+    hdc_src = CreateCompatibleDC( 0 );
+    bmp_dst = CreateDIBSection( hdc_dst, &bmi, DIB_RGB_COLORS, (void **)&dst_bits, NULL, 0 );
+    bmp_src = CreateDIBSection( hdc_src, &bmi, DIB_RGB_COLORS, (void **)&src_bits, NULL, 0 );
+    SelectObject( hdc_dst, bmp_dst );
+    SelectObject( hdc_src, bmp_src );
+    expect = HeapAlloc( GetProcessHeap(), 0, width * height * sizeof(DWORD) );
+
+    for (y = 0; y < height; y++)
+        for (x = 0; x < width; x++)
+            src_bits[y * width + x] = (x & 0xff) * 0x01000000 + y * width + x;
+
+    /* copy with an offset, every pixel must come from the matching source line */
+    memset( dst_bits, 0xcc, width * height * sizeof(DWORD) );
+    BitBlt( hdc_dst, 0, 0, width - 3, height - 7, hdc_src, 3, 7, SRCCOPY );
+    for (y = 0; y < height; y++)
+    {
+        for (x = 0; x < width; x++)
+        {
+            DWORD expected = (x < width - 3 && y < height - 7) ? src_bits[(y + 7) * width + x + 3] : 0xcccccccc;
+            if (dst_bits[y * width + x] != expected) break;
+        }
+        if (x < width) break;
+    }
+    ok( y == height, "copy: pixel %d,%d got %08x\n", x, y, y < height ? dst_bits[y * width + x] : 0 );
+
+    /* overlapping scroll down by one line must not be split */
+    memcpy( expect, src_bits, width * height * sizeof(DWORD) );
+    memcpy( dst_bits, src_bits, width * height * sizeof(DWORD) );
+    BitBlt( hdc_dst, 0, 1, width, height - 1, hdc_dst, 0, 0, SRCCOPY );
+    ok( !memcmp( dst_bits + width, expect, (height - 1) * width * sizeof(DWORD) ), "scroll: wrong bits\n" );
+
+    if (pGdiAlphaBlend)
+    {
+        for (y = 0; y < width * height; y++)
+        {
+            x = y & 0xff;
+            src_bits[y] = x << 24 | (y % (x + 1)) << 16 | (x / 2) << 8 | (x / 3);
+            dst_bits[y] = 0xff000000 | (y * 2654435761u) >> 8;
+            expect[y] = blend_pixel_ref( dst_bits[y], src_bits[y], blend );
+        }
+        pGdiAlphaBlend( hdc_dst, 0, 0, width, height, hdc_src, 0, 0, width, height, blend );
+        for (y = 0; y < width * height; y++) if (dst_bits[y] != expect[y]) break;
+        ok( y == width * height, "blend: pixel %d got %08x expected %08x\n", y,
+            y < width * height ? dst_bits[y] : 0, y < width * height ? expect[y] : 0 );
+    }
+
+    DeleteDC( hdc_dst );
+    DeleteDC( hdc_src );
+    DeleteObject( bmp_dst );
+    DeleteObject( bmp_src );
+    HeapFree( GetProcessHeap(), 0, expect );
+}
+
+static void test_dib_conversions(void)
+{
+    const int width = 131;
+    BITMAPINFO bmi;
+    HDC hdc;
+    HBITMAP bmp;
+    DWORD *bits, expect;
+    BYTE *src24, *dst24;
+    WORD *src16, *dst16;
+    int i, x, ret;
+
+    memset( &bmi, 0, sizeof(bmi) );
+    bmi.bmiHeader.biSize = sizeof(bmi.bmiHeader);
+    bmi.bmiHeader.biWidth = width;
+    bmi.bmiHeader.biHeight = -1;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    hdc = CreateCompatibleDC( 0 );
+    bmp = CreateDIBSection( hdc, &bmi, DIB_RGB_COLORS, (void **)&bits, NULL, 0 );
+    SelectObject( hdc, bmp );
+    src24 = HeapAlloc( GetProcessHeap(), 0, width * 3 + 4 );
+    dst24 = HeapAlloc( GetProcessHeap(), 0, width * 3 + 4 );
+    src16 = HeapAlloc( GetProcessHeap(), 0, width * 2 + 4 );
+    dst16 = HeapAlloc( GetProcessHeap(), 0, width * 2 + 4 );
+
+    srand( 4321 );
+    for (i = 0; i < width * 3 + 4; i++) src24[i] = rand();
+    for (i = 0; i < width + 2; i++) src16[i] = rand() & 0x7fff;
+
+    /* the odd source offsets make the rows start at various alignments */
+    for (x = 0; x < 4; x++)
+    {
+        bmi.bmiHeader.biBitCount = 24;
+        memset( bits, 0xcc, width * 4 );
+        ret = SetDIBitsToDevice( hdc, 0, 0, width - x, 1, x, 0, 0, 1, src24, &bmi, DIB_RGB_COLORS );
+        ok( ret == 1, "SetDIBitsToDevice returned %d\n", ret );
+        for (i = 0; i < width - x; i++)
+            if (bits[i] != (src24[(x + i) * 3] | src24[(x + i) * 3 + 1] << 8 | src24[(x + i) * 3 + 2] << 16))
+                break;
+        ok( i == width - x, "%d: 24-bpp pixel %d wrong %08x\n", x, i, bits[i] );
+
+        bmi.bmiHeader.biBitCount = 16;
+        memset( bits, 0xcc, width * 4 );
+        ret = SetDIBitsToDevice( hdc, 0, 0, width - x, 1, x, 0, 0, 1, src16, &bmi, DIB_RGB_COLORS );
+        ok( ret == 1, "SetDIBitsToDevice returned %d\n", ret );
+        for (i = 0; i < width - x; i++)
+        {
+            WORD val = src16[x + i];
+            expect = ((val & 0x7c00) << 9 | (val & 0x7000) << 4 | (val & 0x03e0) << 6 |
+                      (val & 0x0380) << 1 | (val & 0x001f) << 3 | (val & 0x001c) >> 2);
+            if (bits[i] != expect) break;
+        }
+        ok( i == width - x, "%d: 16-bpp pixel %d wrong %08x\n", x, i, bits[i] );
+    }
+
+    for (i = 0; i < width; i++) bits[i] = rand() << 16 | rand();
+
+    bmi.bmiHeader.biBitCount = 24;
+    ret = GetDIBits( hdc, bmp, 0, 1, dst24, &bmi, DIB_RGB_COLORS );
+    ok( ret == 1, "GetDIBits returned %d\n", ret );
+    for (i = 0; i < width; i++)
+        if (dst24[i * 3] != (BYTE)bits[i] || dst24[i * 3 + 1] != (BYTE)(bits[i] >> 8) ||
+            dst24[i * 3 + 2] != (BYTE)(bits[i] >> 16)) break;
+    ok( i == width, "24-bpp pixel %d wrong\n", i );
+
+    bmi.bmiHeader.biBitCount = 16;
+    ret = GetDIBits( hdc, bmp, 0, 1, dst16, &bmi, DIB_RGB_COLORS );
+    ok( ret == 1, "GetDIBits returned %d\n", ret );
+    for (i = 0; i < width; i++)
+        if (dst16[i] != (((bits[i] >> 9) & 0x7c00) | ((bits[i] >> 6) & 0x03e0) | ((bits[i] >> 3) & 0x001f)))
+            break;
+    ok( i == width, "16-bpp pixel %d wrong %04x\n", i, dst16[i] );
+
+    HeapFree( GetProcessHeap(), 0, src24 );
+    HeapFree( GetProcessHeap(), 0, dst24 );
+    HeapFree( GetProcessHeap(), 0, src16 );
+    HeapFree( GetProcessHeap(), 0, dst16 );
+    DeleteDC( hdc );
+    DeleteObject( bmp );
+}
+
+/* rough timings of full HD conversions, only run in interactive mode since
+ * they depend on the machine and its load and can't be checked */
+static void test_dib_conversion_timings(void)
+{
+    const int width = 1920, height = 1080;
+    BITMAPINFO bmi;
+    HDC hdc;
+    HBITMAP bmp;
+    DWORD *bits, start;
+    BYTE *src;
+    int i;
+
+    memset( &bmi, 0, sizeof(bmi) );
+    bmi.bmiHeader.biSize = sizeof(bmi.bmiHeader);
+    bmi.bmiHeader.biWidth = width;
+    bmi.bmiHeader.biHeight = -height;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    hdc = CreateCompatibleDC( 0 );
+    bmp = CreateDIBSection( hdc, &bmi, DIB_RGB_COLORS, (void **)&bits, NULL, 0 );
+    SelectObject( hdc, bmp );
+    src = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY, width * height * 4 );
+
+    bmi.bmiHeader.biBitCount = 24;
+    start = GetTickCount();
+    for (i = 0; i < 10; i++)
+        SetDIBitsToDevice( hdc, 0, 0, width, height, 0, 0, 0, height, src, &bmi, DIB_RGB_COLORS );
+    trace( "%ux%u 24-bpp SetDIBitsToDevice: %u ms per call\n", width, height, (GetTickCount() - start) / 10 );
+
+    bmi.bmiHeader.biBitCount = 16;
+    start = GetTickCount();
+    for (i = 0; i < 10; i++)
+        SetDIBitsToDevice( hdc, 0, 0, width, height, 0, 0, 0, height, src, &bmi, DIB_RGB_COLORS );
+    trace( "%ux%u 16-bpp SetDIBitsToDevice: %u ms per call\n", width, height, (GetTickCount() - start) / 10 );
+
+    bmi.bmiHeader.biWidth = width / 2;
+    bmi.bmiHeader.biHeight = -height / 2;
+    bmi.bmiHeader.biBitCount = 32;
+    start = GetTickCount();
+    for (i = 0; i < 10; i++)
+        StretchDIBits( hdc, 0, 0, width, height, 0, 0, width / 2, height / 2,
+                       src, &bmi, DIB_RGB_COLORS, SRCCOPY );
+    trace( "%ux%u 32-bpp StretchDIBits: %u ms per call\n", width, height, (GetTickCount() - start) / 10 );
+
+    HeapFree( GetProcessHeap(), 0, src );
+    DeleteDC( hdc );
+    DeleteObject( bmp );
+}
+
 static void test_GdiGradientFill(void)
 {
     HDC hdc;
@@ -5955,6 +6273,10 @@ START_TEST(bitmap)
     test_StretchBlt();
     test_StretchDIBits();
     test_GdiAlphaBlend();
+    test_GdiAlphaBlend_pixels();
+    test_dib_conversions();
+    if (winetest_interactive) test_dib_conversion_timings();
+    test_large_blits();
     test_GdiGradientFill();
     test_32bit_ddb();
     test_bitmapinfoheadersize();
@@ -6596,6 +6596,64 @@ static void test_fake_bold_font(void)
     }
 }
 
+static void test_large_glyphs_redraw(void)
+{
+    static const WCHAR text[] = {'W','i','n','e'};
+    const int width = 1024, height = 384;
+    BITMAPINFO bmi;
+    HDC hdc;
+    HFONT font, old_font;
+    HBITMAP bmp;
+    LOGFONTA lf;
+    DWORD *bits, *expect;
+    WCHAR ch;
+    int i;
+
+    if (!is_truetype_font_installed("Arial"))
+    {
+        skip("Arial is not installed\n");
+        return;
+    }
+
+    hdc = CreateCompatibleDC(0);
+    memset(&bmi, 0, sizeof(bmi));
+    bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biWidth = width;
+    bmi.bmiHeader.biHeight = height;
+    bmi.bmiHeader.biCompression = BI_RGB;
+    bmp = CreateDIBSection(hdc, &bmi, DIB_RGB_COLORS, (void **)&bits, NULL, 0);
+    ok(bmp != NULL, "Can't create DIB\n");
+    SelectObject(hdc, bmp);
+    expect = HeapAlloc(GetProcessHeap(), 0, width * height * sizeof(DWORD));
+
+    /* glyphs this large don't all fit in the glyph cache of the DIB engine */
+    memset(&lf, 0, sizeof(lf));
+    strcpy(lf.lfFaceName, "Arial");
+    lf.lfHeight = -300;
+    lf.lfQuality = ANTIALIASED_QUALITY;
+    font = CreateFontIndirectA(&lf);
+    old_font = SelectObject(hdc, font);
+
+    memset(bits, 0xff, width * height * sizeof(DWORD));
+    ExtTextOutW(hdc, 0, 0, 0, NULL, text, sizeof(text) / sizeof(text[0]), NULL);
+    memcpy(expect, bits, width * height * sizeof(DWORD));
+
+    for (i = 0; i < 3; i++)
+        for (ch = 0x21; ch < 0x7f; ch++) ExtTextOutW(hdc, 0, 0, 0, NULL, &ch, 1, NULL);
+
+    memset(bits, 0xff, width * height * sizeof(DWORD));
+    ExtTextOutW(hdc, 0, 0, 0, NULL, text, sizeof(text) / sizeof(text[0]), NULL);
+    ok(!memcmp(bits, expect, width * height * sizeof(DWORD)), "text rendered differently\n");
+
+    SelectObject(hdc, old_font);
+    DeleteObject(font);
+    DeleteDC(hdc);
+    DeleteObject(bmp);
+    HeapFree(GetProcessHeap(), 0, expect);
+}
+
 static void test_bitmap_font_glyph_index(void)
 {
     const WCHAR text[] = {'#','!','/','b','i','n','/','s','h',0};
@@ -6886,6 +6944,7 @@ START_TEST(font)
     test_GetCharWidth32();
     test_fake_bold_font();
     test_bitmap_font_glyph_index();
+    test_large_glyphs_redraw();
     test_GetCharWidthI();
     test_long_names();
 
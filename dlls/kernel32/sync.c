@@ -2380,6 +2380,29 @@ BOOL WINAPI GetQueuedCompletionStatus( HANDLE CompletionPort, LPDWORD lpNumberOf
 }
 
 
+/******************************************************************************
+ *		GetQueuedCompletionStatusEx (KERNEL32.@)
+ */
+BOOL WINAPI GetQueuedCompletionStatusEx( HANDLE port, OVERLAPPED_ENTRY *entries, ULONG count,
+                                         ULONG *written, DWORD timeout, BOOL alertable )
+{
+    LARGE_INTEGER time;
+    NTSTATUS status;
+
+    TRACE( "%p %p %u %p %u %u\n", port, entries, count, written, timeout, alertable );
+
+    /* OVERLAPPED_ENTRY has the same layout as FILE_IO_COMPLETION_INFORMATION */
+    status = NtRemoveIoCompletionEx( port, (FILE_IO_COMPLETION_INFORMATION *)entries, count,
+                                     written, get_nt_timeout( &time, timeout ), alertable );
+    if (status == STATUS_SUCCESS) return TRUE;
+
+    if (status == STATUS_TIMEOUT) SetLastError( WAIT_TIMEOUT );
+    else if (status == STATUS_USER_APC) SetLastError( WAIT_IO_COMPLETION );
+    else SetLastError( RtlNtStatusToDosError(status) );
+    return FALSE;
+}
+
+
 /******************************************************************************
  *		PostQueuedCompletionStatus (KERNEL32.@)
  */
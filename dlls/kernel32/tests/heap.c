@@ -39,6 +39,7 @@
 #define HEAP_VALIDATE_PARAMS  0x40000000
 
 static BOOL (WINAPI *pHeapQueryInformation)(HANDLE, HEAP_INFORMATION_CLASS, PVOID, SIZE_T, PSIZE_T);
+static BOOL (WINAPI *pHeapSetInformation)(HANDLE, HEAP_INFORMATION_CLASS, PVOID, SIZE_T);
 static BOOL (WINAPI *pGetPhysicallyInstalledSystemMemory)(ULONGLONG *);
 static ULONG (WINAPI *pRtlGetNtGlobalFlags)(void);
 
@@ -625,6 +626,14 @@ static void test_HeapCreate(void)
    ok(dwSize < 0xFFFFFFFF, "The size of the 0-length buffer\n");
    ok(HeapFree(heap, 0, mem1), "Freed the 0-length buffer\n");
 
+   /* HeapCompact returns the largest committed free block */
+   dwSize = HeapCompact(heap, 0);
+   ok(dwSize > 0, "HeapCompact returned 0, error %u\n", GetLastError());
+   mem1 = HeapAlloc(heap, 0, dwSize / 2);
+   ok(mem1 != NULL, "HeapAlloc failed\n");
+   ok(HeapCompact(heap, 0) < dwSize, "HeapCompact didn't shrink after an allocation\n");
+   ok(HeapFree(heap, 0, mem1), "HeapFree failed\n");
+
    /* Check that HeapDestroy works */
    ok(HeapDestroy(heap),"HeapDestroy failed\n");
 }
@@ -892,6 +901,119 @@ static void test_HeapQueryInformation(void)
     ok(info == 0 || info == 1 || info == 2, "expected 0, 1 or 2, got %u\n", info);
 }
 
+static void test_HeapSetInformation(void)
+{
+    BYTE *ptrs[64], *ptr, *mem;
+    HANDLE heap;
+    ULONG info;
+    SIZE_T size;
+    BOOL ret;
+    int i, j;
+
+    pHeapSetInformation = (void *)GetProcAddress(GetModuleHandleA("kernel32.dll"), "HeapSetInformation");
+    if (!pHeapSetInformation || !pHeapQueryInformation)
+    {
+        win_skip("HeapSetInformation is not available\n");
+        return;
+    }
+
+    heap = HeapCreate(HEAP_NO_SERIALIZE, 0, 0);
+    ok(heap != NULL, "HeapCreate failed\n");
+    info = 2;
+    ret = pHeapSetInformation(heap, HeapCompatibilityInformation, &info, sizeof(info));
+    ok(!ret, "HeapSetInformation should fail on a HEAP_NO_SERIALIZE heap\n");
+    HeapDestroy(heap);
+
+    heap = HeapCreate(0, 0x10000, 0x10000);
+    ok(heap != NULL, "HeapCreate failed\n");
+    info = 2;
+    ret = pHeapSetInformation(heap, HeapCompatibilityInformation, &info, sizeof(info));
+    ok(!ret, "HeapSetInformation should fail on a fixed-size heap\n");
+    info = 0xdeadbeef;
+    ret = pHeapQueryInformation(heap, HeapCompatibilityInformation, &info, sizeof(info), NULL);
+    ok(ret, "HeapQueryInformation error %u\n", GetLastError());
+    ok(info != 2, "got %u\n", info);
+    HeapDestroy(heap);
+
+    heap = HeapCreate(0, 0, 0);
+    ok(heap != NULL, "HeapCreate failed\n");
+
+    info = 2;
+    ret = pHeapSetInformation(heap, HeapCompatibilityInformation, &info, sizeof(info));
+    ok(ret, "HeapSetInformation error %u\n", GetLastError());
+
+    info = 0xdeadbeef;
+    ret = pHeapQueryInformation(heap, HeapCompatibilityInformation, &info, sizeof(info), NULL);
+    ok(ret, "HeapQueryInformation error %u\n", GetLastError());
+    ok(info == 2, "expected 2, got %u\n", info);
+
+    for (i = 0; i < sizeof(ptrs) / sizeof(ptrs[0]); i++)
+    {
+        ptrs[i] = HeapAlloc(heap, HEAP_ZERO_MEMORY, i + 1);
+        ok(ptrs[i] != NULL, "%u: HeapAlloc failed\n", i);
+        size = HeapSize(heap, 0, ptrs[i]);
+        ok(size == i + 1, "%u: wrong size %lu\n", i, size);
+        for (j = 0; j <= i; j++) if (ptrs[i][j]) break;
+        ok(j > i, "%u: block not zeroed at %u\n", i, j);
+        memset(ptrs[i], i, i + 1);
+    }
+
+    for (i = 0; i < sizeof(ptrs) / sizeof(ptrs[0]); i++)
+    {
+        ret = HeapValidate(heap, 0, ptrs[i]);
+        ok(ret, "%u: HeapValidate failed\n", i);
+        for (j = 0; j <= i; j++) if (ptrs[i][j] != i) break;
+        ok(j > i, "%u: block overwritten at %u\n", i, j);
+    }
+    ret = HeapValidate(heap, 0, NULL);
+    ok(ret, "HeapValidate failed\n");
+
+    /* the header of this pointer is in an uncommitted page */
+    mem = VirtualAlloc(NULL, 0x10000, MEM_RESERVE, PAGE_READWRITE);
+    ok(mem != NULL, "VirtualAlloc failed\n");
+    ptr = VirtualAlloc(mem + 0x1000, 0x1000, MEM_COMMIT, PAGE_READWRITE);
+    ok(ptr == mem + 0x1000, "VirtualAlloc returned %p\n", ptr);
+    ret = HeapValidate(heap, 0, ptr);
+    ok(!ret, "HeapValidate succeeded\n");
+    ret = HeapValidate(heap, 0, ptrs[5] + 8);
+    ok(!ret, "HeapValidate succeeded\n");
+    /* Windows may terminate the process on heap corruption */
+    if (!strcmp(winetest_platform, "wine"))
+    {
+        size = HeapSize(heap, 0, ptr);
+        ok(size == ~(SIZE_T)0, "wrong size %lu\n", size);
+        size = HeapSize(heap, 0, ptrs[5] + 8);
+        ok(size == ~(SIZE_T)0, "wrong size %lu\n", size);
+        ret = HeapFree(heap, 0, ptr);
+        ok(!ret, "HeapFree succeeded\n");
+        ret = HeapFree(heap, 0, ptrs[5] + 8);
+        ok(!ret, "HeapFree succeeded\n");
+    }
+    VirtualFree(mem, 0, MEM_RELEASE);
+
+    ptr = HeapReAlloc(heap, HEAP_REALLOC_IN_PLACE_ONLY, ptrs[20], 5);
+    ok(ptr == ptrs[20], "HeapReAlloc returned %p instead of %p\n", ptr, ptrs[20]);
+    size = HeapSize(heap, 0, ptr);
+    ok(size == 5, "wrong size %lu\n", size);
+
+    ptr = HeapReAlloc(heap, HEAP_ZERO_MEMORY, ptrs[10], 1000);
+    ok(ptr != NULL, "HeapReAlloc failed\n");
+    for (j = 0; j < 11; j++) if (ptr[j] != 10) break;
+    ok(j == 11, "block data lost at %u\n", j);
+    for (j = 11; j < 1000; j++) if (ptr[j]) break;
+    ok(j == 1000, "block not zeroed at %u\n", j);
+    ptrs[10] = ptr;
+
+    for (i = 0; i < sizeof(ptrs) / sizeof(ptrs[0]); i++)
+    {
+        ret = HeapFree(heap, 0, ptrs[i]);
+        ok(ret, "%u: HeapFree failed\n", i);
+    }
+
+    ret = HeapDestroy(heap);
+    ok(ret, "HeapDestroy failed\n");
+}
+
 static void test_heap_checks( DWORD flags )
 {
     BYTE old, *p, *p2;
@@ -1245,6 +1367,7 @@ START_TEST(heap)
     test_sized_HeapReAlloc((1 << 20), 1);
 
     test_HeapQueryInformation();
+    test_HeapSetInformation();
     test_GetPhysicallyInstalledSystemMemory();
 
     if (pRtlGetNtGlobalFlags)
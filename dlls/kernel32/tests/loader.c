@@ -2003,6 +2003,157 @@ static void test_import_resolution(void)
     }
 }
 
+struct relocated_data
+{
+    ULONG_PTR ptr;
+    char target[16];
+    IMAGE_BASE_RELOCATION reloc;
+    WORD entries[2];
+};
+
+#define RELOC_IMAGE_BASE 0x12350000
+#define RELOC_DATA_RVA(ptr) (page_size + ((char *)(ptr) - (char *)&data))
+
+static HMODULE load_relocated_dll( const char *dll_name )
+{
+    void *reserved;
+    HMODULE mod;
+
+    /* occupy the preferred base so that the dll has to be relocated */
+    reserved = VirtualAlloc( (void *)RELOC_IMAGE_BASE, page_size, MEM_RESERVE, PAGE_NOACCESS );
+    mod = LoadLibraryA( dll_name );
+    ok( mod != NULL, "failed to load err %u\n", GetLastError() );
+    if (reserved) VirtualFree( reserved, 0, MEM_RELEASE );
+    return mod;
+}
+
+static void check_relocated_data( HMODULE mod )
+{
+    struct relocated_data data, *ptr = (struct relocated_data *)((char *)mod + page_size);
+
+    ok( mod != (HMODULE)RELOC_IMAGE_BASE, "dll loaded at its preferred base %p\n", mod );
+    ok( ptr->ptr == (ULONG_PTR)mod + RELOC_DATA_RVA( data.target ), "got pointer %p, expected %p\n",
+        (void *)ptr->ptr, (char *)mod + RELOC_DATA_RVA( data.target ) );
+    if (ptr->ptr == (ULONG_PTR)mod + RELOC_DATA_RVA( data.target ))
+        ok( !strcmp( (char *)ptr->ptr, "relocated" ), "wrong target data '%s'\n", (char *)ptr->ptr );
+}
+
+static void child_relocated_image( const char *dll_name )
+{
+    struct relocated_data *ptr;
+    HMODULE mod;
+
+    mod = load_relocated_dll( dll_name );
+    if (mod)
+    {
+        check_relocated_data( mod );
+        /* modifying the data must not affect the other processes */
+        ptr = (struct relocated_data *)((char *)mod + page_size);
+        ptr->ptr = 0xdeadbeef;
+        strcpy( ptr->target, "modified" );
+        FreeLibrary( mod );
+    }
+    *child_failures = winetest_get_failures();
+}
+
+static void test_relocated_image_sharing(void)
+{
+    char temp_path[MAX_PATH];
+    char dll_name[MAX_PATH];
+    char cmdline[MAX_PATH * 2];
+    char **argv;
+    DWORD dummy, ret, i;
+    HANDLE hfile;
+    HMODULE mod;
+    STARTUPINFOA si = { sizeof(si) };
+    PROCESS_INFORMATION pi;
+    struct relocated_data data;
+    IMAGE_NT_HEADERS nt;
+    IMAGE_SECTION_HEADER section;
+
+    nt = nt_header_template;
+    nt.FileHeader.NumberOfSections = 1;
+    nt.FileHeader.SizeOfOptionalHeader = sizeof(IMAGE_OPTIONAL_HEADER);
+    nt.FileHeader.Characteristics = IMAGE_FILE_EXECUTABLE_IMAGE | IMAGE_FILE_32BIT_MACHINE | IMAGE_FILE_DLL;
+    nt.OptionalHeader.SectionAlignment = page_size;
+    nt.OptionalHeader.FileAlignment = 0x200;
+    nt.OptionalHeader.ImageBase = RELOC_IMAGE_BASE;
+    nt.OptionalHeader.SizeOfImage = 2 * page_size;
+    nt.OptionalHeader.SizeOfHeaders = nt.OptionalHeader.FileAlignment;
+    nt.OptionalHeader.NumberOfRvaAndSizes = IMAGE_NUMBEROF_DIRECTORY_ENTRIES;
+    memset( nt.OptionalHeader.DataDirectory, 0, sizeof(nt.OptionalHeader.DataDirectory) );
+    nt.OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_BASERELOC].Size = sizeof(data.reloc) + sizeof(data.entries);
+    nt.OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_BASERELOC].VirtualAddress = RELOC_DATA_RVA( &data.reloc );
+
+    memset( &data, 0, sizeof(data) );
+    data.ptr = nt.OptionalHeader.ImageBase + RELOC_DATA_RVA( data.target );
+    strcpy( data.target, "relocated" );
+    data.reloc.VirtualAddress = RELOC_DATA_RVA( &data.ptr ) & ~(page_size - 1);
+    data.reloc.SizeOfBlock = sizeof(data.reloc) + sizeof(data.entries);
+    data.entries[0] = ((is_win64 ? IMAGE_REL_BASED_DIR64 : IMAGE_REL_BASED_HIGHLOW) << 12) |
+                      (RELOC_DATA_RVA( &data.ptr ) & (page_size - 1));
+    data.entries[1] = IMAGE_REL_BASED_ABSOLUTE << 12;
+
+    GetTempPathA(MAX_PATH, temp_path);
+    GetTempFileNameA(temp_path, "ldr", 0, dll_name);
+
+    hfile = CreateFileA(dll_name, GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, 0, 0);
+    ok( hfile != INVALID_HANDLE_VALUE, "creation failed\n" );
+
+    memset( &section, 0, sizeof(section) );
+    memcpy( section.Name, ".data", sizeof(".data") );
+    section.PointerToRawData = nt.OptionalHeader.FileAlignment;
+    section.VirtualAddress = nt.OptionalHeader.SectionAlignment;
+    section.Misc.VirtualSize = sizeof(data);
+    section.SizeOfRawData = sizeof(data);
+    section.Characteristics = IMAGE_SCN_CNT_INITIALIZED_DATA | IMAGE_SCN_MEM_READ | IMAGE_SCN_MEM_WRITE;
+
+    WriteFile(hfile, &dos_header, sizeof(dos_header), &dummy, NULL);
+    WriteFile(hfile, &nt, sizeof(nt), &dummy, NULL);
+    WriteFile(hfile, &section, sizeof(section), &dummy, NULL);
+
+    SetFilePointer( hfile, section.PointerToRawData, NULL, SEEK_SET );
+    WriteFile(hfile, &data, sizeof(data), &dummy, NULL);
+
+    CloseHandle( hfile );
+
+    mod = load_relocated_dll( dll_name );
+    if (!mod)
+    {
+        DeleteFileA( dll_name );
+        return;
+    }
+    check_relocated_data( mod );
+
+    /* load the same dll in other processes while it is still relocated here, in Wine
+     * the first one publishes its relocated copy and the second one maps it */
+    winetest_get_mainargs(&argv);
+    for (i = 0; i < 2; i++)
+    {
+        *child_failures = -1;
+        sprintf(cmdline, "\"%s\" loader reloc %s", argv[0], dll_name);
+        ret = CreateProcessA(argv[0], cmdline, NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi);
+        ok(ret, "CreateProcess(%s) error %d\n", cmdline, GetLastError());
+        if (!ret) break;
+        ret = WaitForSingleObject(pi.hProcess, 10000);
+        ok(ret == WAIT_OBJECT_0, "child process failed to terminate\n");
+        if (ret != WAIT_OBJECT_0) TerminateProcess(pi.hProcess, 0);
+        if (*child_failures)
+        {
+            trace("%d failures in child process\n", *child_failures);
+            winetest_add_failures(*child_failures);
+        }
+        CloseHandle(pi.hThread);
+        CloseHandle(pi.hProcess);
+    }
+
+    check_relocated_data( mod );
+    FreeLibrary( mod );
+    DeleteFileA( dll_name );
+}
+
+#undef RELOC_DATA_RVA
+
 #define MAX_COUNT 10
 static HANDLE attached_thread[MAX_COUNT];
 static DWORD attached_thread_count;
@@ -3586,6 +3737,11 @@ START_TEST(loader)
         *child_failures = -1;
 
     argc = winetest_get_mainargs(&argv);
+    if (argc > 3 && !strcmp(argv[2], "reloc"))
+    {
+        child_relocated_image(argv[3]);
+        return;
+    }
     if (argc > 4)
     {
         test_dll_phase = atoi(argv[4]);
@@ -3599,6 +3755,7 @@ START_TEST(loader)
     test_ImportDescriptors();
     test_section_access();
     test_import_resolution();
+    test_relocated_image_sharing();
     test_ExitProcess();
     test_InMemoryOrderModuleList();
 }
@@ -51,6 +51,7 @@ static VOID   (WINAPI *pReleaseSRWLockExclusive)(PSRWLOCK);
 static VOID   (WINAPI *pReleaseSRWLockShared)(PSRWLOCK);
 static BOOLEAN (WINAPI *pTryAcquireSRWLockExclusive)(PSRWLOCK);
 static BOOLEAN (WINAPI *pTryAcquireSRWLockShared)(PSRWLOCK);
+static BOOL   (WINAPI *pGetQueuedCompletionStatusEx)(HANDLE,OVERLAPPED_ENTRY*,ULONG,ULONG*,DWORD,BOOL);
 
 static NTSTATUS (WINAPI *pNtAllocateVirtualMemory)(HANDLE, PVOID *, ULONG, SIZE_T *, ULONG, ULONG);
 static NTSTATUS (WINAPI *pNtFreeVirtualMemory)(HANDLE, PVOID *, SIZE_T *, ULONG);
@@ -868,6 +869,59 @@ static void CALLBACK timer_queue_cb6(PVOID p, BOOLEAN timedOut)
     }
 }
 
+static void test_GetQueuedCompletionStatusEx(void)
+{
+    OVERLAPPED_ENTRY entries[4];
+    OVERLAPPED ov[3];
+    ULONG count;
+    HANDLE port;
+    BOOL ret;
+    int i;
+
+    if (!pGetQueuedCompletionStatusEx)
+    {
+        win_skip("GetQueuedCompletionStatusEx not available\n");
+        return;
+    }
+
+    port = CreateIoCompletionPort( INVALID_HANDLE_VALUE, NULL, 0, 0 );
+    ok( port != NULL, "CreateIoCompletionPort failed, error %u\n", GetLastError() );
+
+    count = 0xdeadbeef;
+    SetLastError( 0xdeadbeef );
+    ret = pGetQueuedCompletionStatusEx( port, entries, 4, &count, 0, FALSE );
+    ok( !ret, "GetQueuedCompletionStatusEx succeeded\n" );
+    ok( GetLastError() == WAIT_TIMEOUT, "got error %u\n", GetLastError() );
+    ok( !count, "got count %u\n", count );
+
+    for (i = 0; i < 3; i++)
+    {
+        ret = PostQueuedCompletionStatus( port, 10 * i, 100 + i, &ov[i] );
+        ok( ret, "PostQueuedCompletionStatus failed, error %u\n", GetLastError() );
+    }
+
+    count = 0;
+    ret = pGetQueuedCompletionStatusEx( port, entries, 2, &count, 0, FALSE );
+    ok( ret, "GetQueuedCompletionStatusEx failed, error %u\n", GetLastError() );
+    ok( count == 2, "got count %u\n", count );
+    for (i = 0; i < count; i++)
+    {
+        ok( entries[i].lpCompletionKey == 100 + i, "%d: got key %lu\n", i, entries[i].lpCompletionKey );
+        ok( entries[i].lpOverlapped == &ov[i], "%d: got overlapped %p\n", i, entries[i].lpOverlapped );
+        ok( entries[i].dwNumberOfBytesTransferred == 10 * i, "%d: got %u bytes\n", i,
+            entries[i].dwNumberOfBytesTransferred );
+    }
+
+    count = 0;
+    ret = pGetQueuedCompletionStatusEx( port, entries, 4, &count, 0, FALSE );
+    ok( ret, "GetQueuedCompletionStatusEx failed, error %u\n", GetLastError() );
+    ok( count == 1, "got count %u\n", count );
+    ok( entries[0].lpCompletionKey == 102, "got key %lu\n", entries[0].lpCompletionKey );
+    ok( entries[0].lpOverlapped == &ov[2], "got overlapped %p\n", entries[0].lpOverlapped );
+
+    CloseHandle( port );
+}
+
 static void test_timer_queue(void)
 {
     HANDLE q, t0, t1, t2, t3, t4, t5;
@@ -2659,6 +2713,7 @@ START_TEST(sync)
     pReleaseSRWLockShared = (void *)GetProcAddress(hdll, "ReleaseSRWLockShared");
     pTryAcquireSRWLockExclusive = (void *)GetProcAddress(hdll, "TryAcquireSRWLockExclusive");
     pTryAcquireSRWLockShared = (void *)GetProcAddress(hdll, "TryAcquireSRWLockShared");
+    pGetQueuedCompletionStatusEx = (void *)GetProcAddress(hdll, "GetQueuedCompletionStatusEx");
     pNtAllocateVirtualMemory = (void *)GetProcAddress(hntdll, "NtAllocateVirtualMemory");
     pNtFreeVirtualMemory = (void *)GetProcAddress(hntdll, "NtFreeVirtualMemory");
     pNtWaitForSingleObject = (void *)GetProcAddress(hntdll, "NtWaitForSingleObject");
@@ -2684,6 +2739,7 @@ START_TEST(sync)
     test_semaphore();
     test_waitable_timer();
     test_iocp_callback();
+    test_GetQueuedCompletionStatusEx();
     test_timer_queue();
     test_WaitForSingleObject();
     test_WaitForMultipleObjects();
@@ -3573,6 +3573,41 @@ NTSTATUS WINAPI NtDeleteFile( POBJECT_ATTRIBUTES ObjectAttributes )
     return status;
 }
 
+static wine_cancel_io_callback cancel_io_callback;
+static RTL_SRWLOCK cancel_io_lock = RTL_SRWLOCK_INIT;
+
+/******************************************************************
+ *		__wine_set_cancel_io_callback    (NTDLL.@)
+ *
+ * Set the function called to cancel the I/O operations that a dll
+ * performs itself, without registering them with the server. Clearing
+ * it waits for the calls in progress, so that the dll can be unloaded.
+ */
+void CDECL __wine_set_cancel_io_callback( wine_cancel_io_callback callback )
+{
+    RtlAcquireSRWLockExclusive( &cancel_io_lock );
+    cancel_io_callback = callback;
+    RtlReleaseSRWLockExclusive( &cancel_io_lock );
+}
+
+/******************************************************************
+ *		cancel_client_io
+ *
+ * Cancel the client-side I/O operations on a handle when CancelIo is
+ * called. Returns TRUE if an operation was cancelled.
+ */
+BOOL cancel_client_io( HANDLE handle, IO_STATUS_BLOCK *iosb, BOOL only_thread )
+{
+    BOOL ret = FALSE;
+
+    if (!cancel_io_callback) return FALSE;
+
+    RtlAcquireSRWLockShared( &cancel_io_lock );
+    if (cancel_io_callback) ret = cancel_io_callback( handle, iosb, only_thread );
+    RtlReleaseSRWLockShared( &cancel_io_lock );
+    return ret;
+}
+
 /******************************************************************
  *		NtCancelIoFileEx    (NTDLL.@)
  *
@@ -3591,6 +3626,8 @@ NTSTATUS WINAPI NtCancelIoFileEx( HANDLE hFile, PIO_STATUS_BLOCK iosb, PIO_STATU
     }
     SERVER_END_REQ;
 
+    if (cancel_client_io( hFile, iosb, FALSE ) && io_status->u.Status == STATUS_NOT_FOUND)
+        io_status->u.Status = STATUS_SUCCESS;
     return io_status->u.Status;
 }
 
@@ -3612,6 +3649,7 @@ NTSTATUS WINAPI NtCancelIoFile( HANDLE hFile, PIO_STATUS_BLOCK io_status )
     }
     SERVER_END_REQ;
 
+    cancel_client_io( hFile, NULL, TRUE );
     return io_status->u.Status;
 }
 
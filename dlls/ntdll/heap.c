@@ -45,6 +45,7 @@
 #include "wine/server.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(heap);
+WINE_DECLARE_DEBUG_CHANNEL(heapprof);
 
 /* Note: the heap data structures are loosely based on what Pietrek describes in his
  * book 'Windows 95 System Programming Secrets', with some adaptations for
@@ -85,6 +86,8 @@ typedef struct
 #define ARENA_PENDING_MAGIC    0xbedead
 #define ARENA_FREE_MAGIC       0x45455246
 #define ARENA_LARGE_MAGIC      0x6752614c
+#define ARENA_LFH_MAGIC        0x48464c
+#define ARENA_LFH_FREE_MAGIC   0x66686c
 
 #define ARENA_INUSE_FILLER     0x55
 #define ARENA_TAIL_FILLER      0xab
@@ -134,6 +137,60 @@ typedef union
 
 struct tagHEAP;
 
+/* Low fragmentation heap segment, blocks of a single size are carved out of it */
+typedef struct tagLFH_SEGMENT
+{
+    struct list         entry;      /* Entry in heap LFH segments list */
+    struct tagHEAP     *heap;       /* Main heap structure */
+    DWORD               block_size; /* Size of the blocks, without the arena */
+    DWORD               magic;      /* Magic number */
+} LFH_SEGMENT;
+
+#define LFH_SEGMENT_MAGIC     ((DWORD)('L' | ('F'<<8) | ('H'<<16) | ('S'<<24)))
+#define LFH_SEGMENT_SIZE      0x10000  /* must match the allocation granularity */
+
+/* Reserved address range that LFH segments are committed from, in order */
+typedef struct
+{
+    void               *base;       /* Base address of the area */
+    SIZE_T              size;       /* Reserved size of the area */
+    LONG                committed;  /* Number of segments committed so far */
+} LFH_AREA;
+
+#define LFH_MAX_AREAS         16
+#define LFH_AREA_MIN_SIZE     (16 * LFH_SEGMENT_SIZE)  /* size of the first area, doubled for each new one */
+
+/* Allocation statistics, collected when the heapprof debug channel is enabled */
+#define HEAP_PROF_NB_CLASSES  32    /* power of two size classes */
+#define HEAP_PROF_NB_SITES    1024  /* size of the call sites hash table */
+#define HEAP_PROF_SAMPLE_RATE 64    /* sample the call site of one allocation out of this many */
+
+typedef struct
+{
+    const void         *caller;     /* Return address of the allocation call */
+    LONG                count;      /* Number of sampled allocations */
+    LONGLONG            bytes;      /* Size of the sampled allocations */
+} HEAP_PROF_SITE;
+
+/* all the fields are updated with interlocked operations, without the heap lock */
+typedef struct
+{
+    LONGLONG            alloc_count;                        /* Number of allocations */
+    LONGLONG            free_count;                         /* Number of frees */
+    LONGLONG            realloc_count;                      /* Number of reallocations */
+    LONGLONG            live_bytes;                         /* Size of the blocks currently allocated */
+    LONGLONG            peak_bytes;                         /* Max value of live_bytes */
+    LONG                class_allocs[HEAP_PROF_NB_CLASSES]; /* Allocations per size class */
+    LONG                class_live[HEAP_PROF_NB_CLASSES];   /* Live blocks per size class */
+    LONG                sample_count;                       /* Allocations considered for sampling */
+    LONG                lost_samples;                       /* Samples dropped because the table is full */
+    HEAP_PROF_SITE      sites[HEAP_PROF_NB_SITES];          /* Sampled call sites */
+} HEAP_PROFILE;
+
+/* HeapCompatibilityInformation values */
+#define HEAP_STANDARD         0
+#define HEAP_LFH              2
+
 typedef struct tagSUBHEAP
 {
     void               *base;       /* Base address of the sub-heap memory block */
@@ -164,6 +221,12 @@ typedef struct tagHEAP
     ARENA_INUSE    **pending_free;  /* Ring buffer for pending free requests */
     RTL_CRITICAL_SECTION critSection; /* Critical section for serialization */
     FREE_LIST_ENTRY *freeList;      /* Free lists */
+    DWORD            compat_info;   /* HeapCompatibilityInformation value */
+    struct list      lfh_list;      /* LFH segments list */
+    SLIST_HEADER    *lfh_buckets;   /* LFH free blocks, one list per small block size */
+    LONG             lfh_area_count; /* Number of LFH areas */
+    LFH_AREA         lfh_areas[LFH_MAX_AREAS]; /* LFH areas, never released before the heap is destroyed */
+    HEAP_PROFILE    *profile;       /* Allocation statistics, if enabled */
 } HEAP;
 
 #define HEAP_MAGIC       ((DWORD)('H' | ('E'<<8) | ('A'<<16) | ('P'<<24)))
@@ -870,6 +933,452 @@ static BOOL validate_large_arena( HEAP *heap, const ARENA_LARGE *arena, BOOL qui
 }
 
 
+/***********************************************************************
+ *           get_prof_class
+ *
+ * Get the power of two size class of an allocation for statistics.
+ */
+static inline unsigned int get_prof_class( SIZE_T size )
+{
+    unsigned int class = 0;
+
+    while (size && class < HEAP_PROF_NB_CLASSES - 1)
+    {
+        size >>= 1;
+        class++;
+    }
+    return class;
+}
+
+
+/***********************************************************************
+ *           prof_add
+ *
+ * Atomically add to a 64-bit statistics counter, and return the new value.
+ */
+static inline LONGLONG prof_add( LONGLONG *value, LONGLONG incr )
+{
+    LONGLONG old;
+
+    do old = *(volatile LONGLONG *)value;
+    while (interlocked_cmpxchg64( value, old + incr, old ) != old);
+    return old + incr;
+}
+
+
+/***********************************************************************
+ *           prof_update_live
+ *
+ * Update the live bytes count and the peak value.
+ */
+static inline void prof_update_live( HEAP_PROFILE *prof, LONGLONG incr )
+{
+    LONGLONG live = prof_add( &prof->live_bytes, incr ), peak;
+
+    while ((peak = *(volatile LONGLONG *)&prof->peak_bytes) < live)
+        if (interlocked_cmpxchg64( &prof->peak_bytes, live, peak ) == peak) break;
+}
+
+
+/***********************************************************************
+ *           prof_sample_caller
+ *
+ * Check whether the call site of the next allocation should be sampled.
+ */
+static inline BOOL prof_sample_caller( HEAP_PROFILE *prof )
+{
+    return !((ULONG)interlocked_xchg_add( &prof->sample_count, 1 ) % HEAP_PROF_SAMPLE_RATE);
+}
+
+
+/***********************************************************************
+ *           prof_record_alloc
+ *
+ * Record an allocation in the heap statistics. The caller is only set for
+ * sampled allocations.
+ */
+static void prof_record_alloc( HEAP *heap, SIZE_T size, const void *caller )
+{
+    HEAP_PROFILE *prof = heap->profile;
+    unsigned int i, class = get_prof_class( size );
+    HEAP_PROF_SITE *site;
+
+    prof_add( &prof->alloc_count, 1 );
+    prof_update_live( prof, size );
+    interlocked_xchg_add( &prof->class_allocs[class], 1 );
+    interlocked_xchg_add( &prof->class_live[class], 1 );
+
+    if (!caller) return;
+
+    for (i = 0; i < 16; i++)
+    {
+        site = &prof->sites[(((ULONG_PTR)caller >> 2) + i) % HEAP_PROF_NB_SITES];
+        if (site->caller == caller || !interlocked_cmpxchg_ptr( (void **)&site->caller, (void *)caller, NULL ) ||
+            site->caller == caller)
+        {
+            interlocked_xchg_add( &site->count, 1 );
+            prof_add( &site->bytes, size );
+            return;
+        }
+    }
+    interlocked_xchg_add( &prof->lost_samples, 1 );
+}
+
+
+/***********************************************************************
+ *           prof_record_free
+ *
+ * Record a free in the heap statistics.
+ */
+static void prof_record_free( HEAP *heap, SIZE_T size )
+{
+    HEAP_PROFILE *prof = heap->profile;
+
+    prof_add( &prof->free_count, 1 );
+    prof_add( &prof->live_bytes, -(LONGLONG)size );
+    interlocked_xchg_add( &prof->class_live[get_prof_class( size )], -1 );
+}
+
+
+/***********************************************************************
+ *           prof_record_realloc
+ *
+ * Record an in-place or moved reallocation in the heap statistics.
+ */
+static void prof_record_realloc( HEAP *heap, SIZE_T old_size, SIZE_T size )
+{
+    HEAP_PROFILE *prof = heap->profile;
+
+    prof_add( &prof->realloc_count, 1 );
+    prof_update_live( prof, (LONGLONG)size - (LONGLONG)old_size );
+    interlocked_xchg_add( &prof->class_live[get_prof_class( old_size )], -1 );
+    interlocked_xchg_add( &prof->class_live[get_prof_class( size )], 1 );
+}
+
+
+/***********************************************************************
+ *           prof_dump
+ *
+ * Dump the heap statistics to the heapprof debug channel.
+ */
+static void prof_dump( HEAP *heap )
+{
+    HEAP_PROFILE *prof = heap->profile;
+    unsigned int i, subheaps = 0, large_blocks = 0, lfh_segments = 0;
+    SUBHEAP *subheap;
+    ARENA_LARGE *large;
+    SIZE_T committed = 0, reserved = 0;
+
+    if (!prof) return;
+
+    if (!(heap->flags & HEAP_NO_SERIALIZE)) RtlEnterCriticalSection( &heap->critSection );
+
+    LIST_FOR_EACH_ENTRY( subheap, &heap->subheap_list, SUBHEAP, entry )
+    {
+        subheaps++;
+        committed += subheap->commitSize;
+        reserved += subheap->size;
+    }
+    LIST_FOR_EACH_ENTRY( large, &heap->large_list, ARENA_LARGE, entry )
+    {
+        large_blocks++;
+        committed += large->block_size;
+        reserved += large->block_size;
+    }
+    for (i = 0; i < heap->lfh_area_count; i++)
+    {
+        lfh_segments += heap->lfh_areas[i].committed;
+        committed += heap->lfh_areas[i].committed * LFH_SEGMENT_SIZE;
+        reserved += heap->lfh_areas[i].size;
+    }
+
+    TRACE_(heapprof)( "heap %p: %s allocs %s frees %s reallocs\n", heap,
+                      wine_dbgstr_longlong( prof->alloc_count ), wine_dbgstr_longlong( prof->free_count ),
+                      wine_dbgstr_longlong( prof->realloc_count ));
+    TRACE_(heapprof)( "heap %p: live %s peak %s committed %08lx reserved %08lx bytes\n",
+                      heap, wine_dbgstr_longlong( prof->live_bytes ), wine_dbgstr_longlong( prof->peak_bytes ),
+                      committed, reserved );
+    TRACE_(heapprof)( "heap %p: %u subheaps %u large blocks %u LFH segments\n",
+                      heap, subheaps, large_blocks, lfh_segments );
+
+    for (i = 0; i < HEAP_PROF_NB_CLASSES; i++)
+    {
+        if (!prof->class_allocs[i] && !prof->class_live[i]) continue;
+        TRACE_(heapprof)( "heap %p: size %08lx-%08lx: %u allocs %u live\n", heap,
+                          i ? (SIZE_T)1 << (i - 1) : 0, i ? ((SIZE_T)1 << i) - 1 : 0,
+                          prof->class_allocs[i], prof->class_live[i] );
+    }
+
+    for (i = 0; i < HEAP_PROF_NB_SITES; i++)
+    {
+        if (!prof->sites[i].caller) continue;
+        TRACE_(heapprof)( "heap %p: caller %p: %u samples %s bytes\n", heap,
+                          prof->sites[i].caller, prof->sites[i].count, wine_dbgstr_longlong( prof->sites[i].bytes ));
+    }
+    if (prof->lost_samples)
+        TRACE_(heapprof)( "heap %p: %u samples lost\n", heap, prof->lost_samples );
+
+    if (!(heap->flags & HEAP_NO_SERIALIZE)) RtlLeaveCriticalSection( &heap->critSection );
+}
+
+
+/***********************************************************************
+ *           heap_dump_profiles
+ *
+ * Dump the statistics of all the heaps of the process.
+ */
+void heap_dump_profiles(void)
+{
+    HEAP *heap;
+
+    if (!processHeap || !TRACE_ON(heapprof)) return;
+
+    RtlEnterCriticalSection( &processHeap->critSection );
+    prof_dump( processHeap );
+    LIST_FOR_EACH_ENTRY( heap, &processHeap->entry, HEAP, entry ) prof_dump( heap );
+    RtlLeaveCriticalSection( &processHeap->critSection );
+}
+
+
+/***********************************************************************
+ *           find_lfh_segment
+ *
+ * Find the LFH segment containing a given address. This doesn't need the
+ * heap lock, as areas and segments are only ever added before their blocks
+ * become reachable, and are not released until the heap is destroyed.
+ */
+static LFH_SEGMENT *find_lfh_segment( const HEAP *heap, const void *ptr )
+{
+    LONG i = *(volatile const LONG *)&heap->lfh_area_count;
+
+    while (i--)
+    {
+        const LFH_AREA *area = &heap->lfh_areas[i];
+        SIZE_T offset = (const char *)ptr - (const char *)area->base;
+
+        if (offset >= area->size) continue;
+        if (offset >= (SIZE_T)*(volatile const LONG *)&area->committed * LFH_SEGMENT_SIZE) return NULL;
+        return (LFH_SEGMENT *)((char *)area->base + (offset & ~(SIZE_T)(LFH_SEGMENT_SIZE - 1)));
+    }
+    return NULL;
+}
+
+
+/***********************************************************************
+ *           get_lfh_segment
+ *
+ * Get the LFH segment of a block without taking the heap lock. The arena
+ * is only dereferenced once it is known to be a block of one of the heap
+ * segments, so that bogus pointers fail like they do for the other blocks.
+ */
+static inline LFH_SEGMENT *get_lfh_segment( const HEAP *heap, const ARENA_INUSE *arena )
+{
+    LFH_SEGMENT *segment;
+    SIZE_T offset;
+
+    if (heap->compat_info != HEAP_LFH) return NULL;
+    if (!(segment = find_lfh_segment( heap, arena ))) return NULL;
+    offset = (const char *)arena - ((const char *)segment + ROUND_SIZE( sizeof(*segment) ));
+    if (offset >= LFH_SEGMENT_SIZE - ROUND_SIZE( sizeof(*segment) ) - sizeof(*arena)) return NULL;
+    if (offset % (sizeof(*arena) + segment->block_size)) return NULL;
+    if (arena->magic != ARENA_LFH_MAGIC && arena->magic != ARENA_LFH_FREE_MAGIC) return NULL;
+    return segment;
+}
+
+
+/***********************************************************************
+ *           commit_lfh_segment
+ *
+ * Commit the next segment of the current LFH area, reserving a new area if needed.
+ * The heap critical section must be held by caller.
+ */
+static LFH_SEGMENT *commit_lfh_segment( HEAP *heap )
+{
+    LFH_AREA *area = heap->lfh_area_count ? &heap->lfh_areas[heap->lfh_area_count - 1] : NULL;
+    LPVOID address;
+    SIZE_T size;
+
+    if (!area || area->committed == area->size / LFH_SEGMENT_SIZE)
+    {
+        if (heap->lfh_area_count == LFH_MAX_AREAS) return NULL;
+        size = (SIZE_T)LFH_AREA_MIN_SIZE << heap->lfh_area_count;
+        for (;;)
+        {
+            address = NULL;
+            if (!NtAllocateVirtualMemory( NtCurrentProcess(), &address, 0, &size,
+                                          MEM_RESERVE, get_protection_type( heap->flags ) )) break;
+            if (size == LFH_SEGMENT_SIZE) return NULL;
+            size /= 2;
+        }
+        area = &heap->lfh_areas[heap->lfh_area_count];
+        area->base = address;
+        area->size = size;
+        area->committed = 0;
+        interlocked_xchg_add( &heap->lfh_area_count, 1 );
+    }
+
+    address = (char *)area->base + area->committed * LFH_SEGMENT_SIZE;
+    size = LFH_SEGMENT_SIZE;
+    if (NtAllocateVirtualMemory( NtCurrentProcess(), &address, 0, &size,
+                                 MEM_COMMIT, get_protection_type( heap->flags ) ))
+        return NULL;
+    return address;
+}
+
+
+/***********************************************************************
+ *           create_lfh_segment
+ *
+ * Create a new LFH segment for the specified bucket, and return one of its blocks.
+ * The other blocks are added to the bucket free list.
+ * The heap critical section must be held by caller.
+ */
+static SLIST_ENTRY *create_lfh_segment( HEAP *heap, unsigned int bucket )
+{
+    LFH_SEGMENT *segment;
+    DWORD block_size = HEAP_MIN_DATA_SIZE + bucket * ALIGNMENT;
+    ARENA_INUSE *arena;
+    char *ptr;
+
+    if (!(segment = commit_lfh_segment( heap )))
+    {
+        WARN("Could not allocate LFH segment for %08x bytes blocks\n", block_size );
+        return NULL;
+    }
+    segment->heap = heap;
+    segment->block_size = block_size;
+    segment->magic = LFH_SEGMENT_MAGIC;
+    list_add_tail( &heap->lfh_list, &segment->entry );
+    /* publish the segment before any of its blocks can be handed out */
+    interlocked_xchg_add( &heap->lfh_areas[heap->lfh_area_count - 1].committed, 1 );
+
+    /* push the blocks in reverse order, so that they get allocated in address order */
+    ptr = (char *)segment + ROUND_SIZE( sizeof(*segment) );
+    ptr += ((LFH_SEGMENT_SIZE - ROUND_SIZE( sizeof(*segment) )) / (sizeof(*arena) + block_size) - 1) *
+           (sizeof(*arena) + block_size);
+    for (;;)
+    {
+        arena = (ARENA_INUSE *)ptr;
+        arena->size = block_size;
+        arena->magic = ARENA_LFH_FREE_MAGIC;
+        arena->unused_bytes = 0;
+        if (ptr == (char *)segment + ROUND_SIZE( sizeof(*segment) )) break;
+        RtlInterlockedPushEntrySList( &heap->lfh_buckets[bucket], (SLIST_ENTRY *)(arena + 1) );
+        ptr -= sizeof(*arena) + block_size;
+    }
+    TRACE( "heap %p: new segment %p for %08x bytes blocks\n", heap, segment, block_size );
+    return (SLIST_ENTRY *)(arena + 1);
+}
+
+
+/***********************************************************************
+ *           allocate_lfh_block
+ *
+ * Allocate a small block from the LFH buckets, without taking the heap lock
+ * unless a new segment is needed.
+ */
+static void *allocate_lfh_block( HEAP *heap, DWORD flags, SIZE_T size, SIZE_T rounded_size )
+{
+    unsigned int bucket = get_freelist_index( rounded_size + sizeof(ARENA_INUSE) );
+    SLIST_ENTRY *entry;
+    ARENA_INUSE *arena;
+
+    if (!(entry = RtlInterlockedPopEntrySList( &heap->lfh_buckets[bucket] )))
+    {
+        RtlEnterCriticalSection( &heap->critSection );
+        if (!(entry = RtlInterlockedPopEntrySList( &heap->lfh_buckets[bucket] )))
+            entry = create_lfh_segment( heap, bucket );
+        RtlLeaveCriticalSection( &heap->critSection );
+        if (!entry) return NULL;
+    }
+
+    arena = (ARENA_INUSE *)entry - 1;
+    arena->magic = ARENA_LFH_MAGIC;
+    arena->unused_bytes = (arena->size & ARENA_SIZE_MASK) - size;
+    notify_alloc( arena + 1, size, flags & HEAP_ZERO_MEMORY );
+    initialize_block( arena + 1, size, arena->unused_bytes, flags );
+    return arena + 1;
+}
+
+
+/***********************************************************************
+ *           free_lfh_block
+ *
+ * Return a small block to its LFH bucket, without taking the heap lock.
+ */
+static BOOL free_lfh_block( HEAP *heap, ARENA_INUSE *arena )
+{
+    if (arena->magic != ARENA_LFH_MAGIC)
+    {
+        WARN( "Heap %p: block %p used after free\n", heap, arena + 1 );
+        return FALSE;
+    }
+    notify_free( arena + 1 );
+    arena->magic = ARENA_LFH_FREE_MAGIC;
+    RtlInterlockedPushEntrySList( &heap->lfh_buckets[get_freelist_index( (arena->size & ARENA_SIZE_MASK) +
+                                                                         sizeof(*arena) )],
+                                  (SLIST_ENTRY *)(arena + 1) );
+    return TRUE;
+}
+
+
+/***********************************************************************
+ *           realloc_lfh_block
+ */
+static void *realloc_lfh_block( HEAP *heap, DWORD flags, void *ptr, SIZE_T size, SIZE_T rounded_size )
+{
+    ARENA_INUSE *arena = (ARENA_INUSE *)ptr - 1;
+    SIZE_T block_size = arena->size & ARENA_SIZE_MASK;
+    SIZE_T old_size = block_size - arena->unused_bytes;
+    void *new_ptr;
+
+    if (rounded_size <= block_size)
+    {
+        arena->unused_bytes = block_size - size;
+        notify_realloc( ptr, old_size, size );
+        if (size > old_size)
+            initialize_block( (char *)ptr + old_size, size - old_size, arena->unused_bytes, flags );
+        if (heap->profile) prof_record_realloc( heap, old_size, size );
+        return ptr;
+    }
+    if (flags & HEAP_REALLOC_IN_PLACE_ONLY) return NULL;
+    if (!(new_ptr = RtlAllocateHeap( heap, flags & ~HEAP_GENERATE_EXCEPTIONS, size ))) return NULL;
+    memcpy( new_ptr, ptr, old_size );
+    RtlFreeHeap( heap, 0, ptr );
+    return new_ptr;
+}
+
+
+/***********************************************************************
+ *           validate_lfh_arena
+ */
+static BOOL validate_lfh_arena( const LFH_SEGMENT *segment, const ARENA_INUSE *arena, BOOL quiet )
+{
+    const char *first = (const char *)segment + ROUND_SIZE( sizeof(*segment) );
+
+    if ((const char *)arena < first || (const char *)(arena + 1) > (const char *)segment + LFH_SEGMENT_SIZE ||
+        ((const char *)arena - first) % (sizeof(*arena) + segment->block_size))
+    {
+        if (quiet == NOISY) ERR( "Heap %p: invalid LFH arena pointer %p\n", segment->heap, arena );
+        else WARN( "Heap %p: invalid LFH arena pointer %p\n", segment->heap, arena );
+        return FALSE;
+    }
+    if (arena->magic != ARENA_LFH_MAGIC && arena->magic != ARENA_LFH_FREE_MAGIC)
+    {
+        if (quiet == NOISY) ERR( "Heap %p: invalid LFH arena magic %08x for %p\n", segment->heap, arena->magic, arena );
+        else WARN( "Heap %p: invalid LFH arena magic %08x for %p\n", segment->heap, arena->magic, arena );
+        return FALSE;
+    }
+    if ((arena->size & ARENA_SIZE_MASK) != segment->block_size || arena->unused_bytes > segment->block_size)
+    {
+        ERR( "Heap %p: bad size %08x/%08x for LFH arena %p\n",
+             segment->heap, arena->size & ARENA_SIZE_MASK, arena->unused_bytes, arena );
+        return FALSE;
+    }
+    return TRUE;
+}
+
+
 /***********************************************************************
  *           HEAP_CreateSubHeap
  */
@@ -927,6 +1436,7 @@ static SUBHEAP *HEAP_CreateSubHeap( HEAP *heap, LPVOID address, DWORD flags,
         heap->grow_size     = max( HEAP_DEF_SIZE, totalSize );
         list_init( &heap->subheap_list );
         list_init( &heap->large_list );
+        list_init( &heap->lfh_list );
 
         subheap = &heap->subheap;
         subheap->base       = address;
@@ -950,6 +1460,13 @@ static SUBHEAP *HEAP_CreateSubHeap( HEAP *heap, LPVOID address, DWORD flags,
             if (i) list_add_after( &pEntry[-1].arena.entry, &pEntry->arena.entry );
         }
 
+        /* Build the LFH buckets, SLIST headers need 16-byte alignment on 64-bit */
+
+        subheap->headerSize = (subheap->headerSize + 15) & ~15;
+        heap->lfh_buckets = (SLIST_HEADER *)((char *)heap + subheap->headerSize);
+        subheap->headerSize = ROUND_SIZE( subheap->headerSize + HEAP_NB_SMALL_FREE_LISTS * sizeof(SLIST_HEADER) );
+        for (i = 0; i < HEAP_NB_SMALL_FREE_LISTS; i++) RtlInitializeSListHead( &heap->lfh_buckets[i] );
+
         /* Initialize critical section */
 
         if (!processHeap)  /* do it by hand to avoid memory allocations */
@@ -1334,6 +1851,7 @@ static BOOL HEAP_IsRealArena( HEAP *heapPtr,   /* [in] ptr to the heap */
     SUBHEAP *subheap;
     BOOL ret = TRUE;
     const ARENA_LARGE *large_arena;
+    const LFH_SEGMENT *segment;
 
     flags &= HEAP_NO_SERIALIZE;
     flags |= heapPtr->flags;
@@ -1348,7 +1866,9 @@ static BOOL HEAP_IsRealArena( HEAP *heapPtr,   /* [in] ptr to the heap */
         if (!(subheap = HEAP_FindSubHeap( heapPtr, arena )) ||
             ((const char *)arena < (char *)subheap->base + subheap->headerSize))
         {
-            if (!(large_arena = find_large_block( heapPtr, block )))
+            if ((segment = find_lfh_segment( heapPtr, arena )))
+                ret = validate_lfh_arena( segment, arena, quiet ) && arena->magic == ARENA_LFH_MAGIC;
+            else if (!(large_arena = find_large_block( heapPtr, block )))
             {
                 if (quiet == NOISY)
                     ERR("Heap %p: block %p is not inside heap\n", heapPtr, block );
@@ -1394,6 +1914,17 @@ static BOOL HEAP_IsRealArena( HEAP *heapPtr,   /* [in] ptr to the heap */
     LIST_FOR_EACH_ENTRY( large_arena, &heapPtr->large_list, ARENA_LARGE, entry )
         if (!(ret = validate_large_arena( heapPtr, large_arena, quiet ))) break;
 
+    LIST_FOR_EACH_ENTRY( segment, &heapPtr->lfh_list, LFH_SEGMENT, entry )
+    {
+        const char *ptr = (const char *)segment + ROUND_SIZE( sizeof(*segment) );
+        const char *end = (const char *)segment + LFH_SEGMENT_SIZE;
+
+        if (!ret) break;
+        for ( ; ptr + sizeof(ARENA_INUSE) + segment->block_size <= end;
+              ptr += sizeof(ARENA_INUSE) + segment->block_size)
+            if (!(ret = validate_lfh_arena( segment, (const ARENA_INUSE *)ptr, NOISY ))) break;
+    }
+
     if (!(flags & HEAP_NO_SERIALIZE)) RtlLeaveCriticalSection( &heapPtr->critSection );
     return ret;
 }
@@ -1515,6 +2046,15 @@ void heap_set_debug_flags( HANDLE handle )
                              large->block_size - sizeof(*large) - large->data_size, flags );
     }
 
+    if (TRACE_ON(heapprof) && !heap->profile)
+    {
+        void *ptr = NULL;
+        SIZE_T size = sizeof(*heap->profile);
+
+        if (!NtAllocateVirtualMemory( NtCurrentProcess(), &ptr, 4, &size, MEM_COMMIT, PAGE_READWRITE ))
+            heap->profile = ptr;
+    }
+
     if ((heap->flags & HEAP_GROWABLE) && !heap->pending_free &&
         ((flags & HEAP_FREE_CHECKING_ENABLED) || RUNNING_ON_VALGRIND))
     {
@@ -1601,6 +2141,7 @@ HANDLE WINAPI RtlDestroyHeap( HANDLE heap )
     ARENA_LARGE *arena, *arena_next;
     SIZE_T size;
     void *addr;
+    LONG i;
 
     TRACE("%p\n", heap );
     if (!heapPtr) return heap;
@@ -1612,6 +2153,14 @@ HANDLE WINAPI RtlDestroyHeap( HANDLE heap )
     list_remove( &heapPtr->entry );
     RtlLeaveCriticalSection( &processHeap->critSection );
 
+    if (heapPtr->profile)
+    {
+        prof_dump( heapPtr );
+        size = 0;
+        addr = heapPtr->profile;
+        NtFreeVirtualMemory( NtCurrentProcess(), &addr, &size, MEM_RELEASE );
+    }
+
     heapPtr->critSection.DebugInfo->Spare[0] = 0;
     RtlDeleteCriticalSection( &heapPtr->critSection );
 
@@ -1622,6 +2171,12 @@ HANDLE WINAPI RtlDestroyHeap( HANDLE heap )
         addr = arena;
         NtFreeVirtualMemory( NtCurrentProcess(), &addr, &size, MEM_RELEASE );
     }
+    for (i = 0; i < heapPtr->lfh_area_count; i++)
+    {
+        size = 0;
+        addr = heapPtr->lfh_areas[i].base;
+        NtFreeVirtualMemory( NtCurrentProcess(), &addr, &size, MEM_RELEASE );
+    }
     LIST_FOR_EACH_ENTRY_SAFE( subheap, next, &heapPtr->subheap_list, SUBHEAP, entry )
     {
         if (subheap == &heapPtr->subheap) continue;  /* do this one last */
@@ -1669,6 +2224,7 @@ PVOID WINAPI RtlAllocateHeap( HANDLE heap, ULONG flags, SIZE_T size )
     SUBHEAP *subheap;
     HEAP *heapPtr = HEAP_GetPtr( heap );
     SIZE_T rounded_size;
+    void *caller = NULL;
 
     /* Validate the parameters */
 
@@ -1683,11 +2239,25 @@ PVOID WINAPI RtlAllocateHeap( HANDLE heap, ULONG flags, SIZE_T size )
     }
     if (rounded_size < HEAP_MIN_DATA_SIZE) rounded_size = HEAP_MIN_DATA_SIZE;
 
+#ifdef __GNUC__
+    if (heapPtr->profile && prof_sample_caller( heapPtr->profile )) caller = __builtin_return_address( 0 );
+#endif
+
+    if (heapPtr->compat_info == HEAP_LFH && rounded_size + sizeof(ARENA_INUSE) <= HEAP_MAX_SMALL_FREE_LIST)
+    {
+        void *ret = allocate_lfh_block( heapPtr, flags, size, rounded_size );
+        if (ret && heapPtr->profile) prof_record_alloc( heapPtr, size, caller );
+        if (!ret && (flags & HEAP_GENERATE_EXCEPTIONS)) RtlRaiseStatus( STATUS_NO_MEMORY );
+        TRACE("(%p,%08x,%08lx): returning %p\n", heap, flags, size, ret );
+        return ret;
+    }
+
     if (!(flags & HEAP_NO_SERIALIZE)) RtlEnterCriticalSection( &heapPtr->critSection );
 
     if (rounded_size >= HEAP_MIN_LARGE_BLOCK_SIZE && (flags & HEAP_GROWABLE))
     {
         void *ret = allocate_large_block( heap, flags, size );
+        if (ret && heapPtr->profile) prof_record_alloc( heapPtr, size, caller );
         if (!(flags & HEAP_NO_SERIALIZE)) RtlLeaveCriticalSection( &heapPtr->critSection );
         if (!ret && (flags & HEAP_GENERATE_EXCEPTIONS)) RtlRaiseStatus( STATUS_NO_MEMORY );
         TRACE("(%p,%08x,%08lx): returning %p\n", heap, flags, size, ret );
@@ -1725,6 +2295,7 @@ PVOID WINAPI RtlAllocateHeap( HANDLE heap, ULONG flags, SIZE_T size )
 
     notify_alloc( pInUse + 1, size, flags & HEAP_ZERO_MEMORY );
     initialize_block( pInUse + 1, size, pInUse->unused_bytes, flags );
+    if (heapPtr->profile) prof_record_alloc( heapPtr, size, caller );
 
     if (!(flags & HEAP_NO_SERIALIZE)) RtlLeaveCriticalSection( &heapPtr->critSection );
 
@@ -1766,15 +2337,35 @@ BOOLEAN WINAPI RtlFreeHeap( HANDLE heap, ULONG flags, PVOID ptr )
 
     flags &= HEAP_NO_SERIALIZE;
     flags |= heapPtr->flags;
+    pInUse  = (ARENA_INUSE *)ptr - 1;
+
+    if (get_lfh_segment( heapPtr, pInUse ))
+    {
+        SIZE_T size = (pInUse->size & ARENA_SIZE_MASK) - pInUse->unused_bytes;
+
+        if (!free_lfh_block( heapPtr, pInUse ))
+        {
+            RtlSetLastWin32ErrorAndNtStatusFromNtStatus( STATUS_INVALID_PARAMETER );
+            TRACE("(%p,%08x,%p): returning FALSE\n", heap, flags, ptr );
+            return FALSE;
+        }
+        if (heapPtr->profile) prof_record_free( heapPtr, size );
+        TRACE("(%p,%08x,%p): returning TRUE\n", heap, flags, ptr );
+        return TRUE;
+    }
+
     if (!(flags & HEAP_NO_SERIALIZE)) RtlEnterCriticalSection( &heapPtr->critSection );
 
     /* Inform valgrind we are trying to free memory, so it can throw up an error message */
     notify_free( ptr );
 
     /* Some sanity checks */
-    pInUse  = (ARENA_INUSE *)ptr - 1;
     if (!validate_block_pointer( heapPtr, &subheap, pInUse )) goto error;
 
+    if (heapPtr->profile)
+        prof_record_free( heapPtr, subheap ? (pInUse->size & ARENA_SIZE_MASK) - pInUse->unused_bytes
+                                           : ((ARENA_LARGE *)ptr - 1)->data_size );
+
     if (!subheap)
         free_large_block( heapPtr, flags, ptr );
     else
@@ -1834,11 +2425,18 @@ PVOID WINAPI RtlReAllocateHeap( HANDLE heap, ULONG flags, PVOID ptr, SIZE_T size
     if (rounded_size < HEAP_MIN_DATA_SIZE) rounded_size = HEAP_MIN_DATA_SIZE;
 
     pArena = (ARENA_INUSE *)ptr - 1;
+    if (get_lfh_segment( heapPtr, pArena ))
+    {
+        if (pArena->magic != ARENA_LFH_MAGIC) goto error;
+        if (!(ret = realloc_lfh_block( heapPtr, flags, ptr, size, rounded_size ))) goto oom;
+        goto done;
+    }
     if (!validate_block_pointer( heapPtr, &subheap, pArena )) goto error;
     if (!subheap)
     {
+        oldActualSize = ((ARENA_LARGE *)ptr - 1)->data_size;
         if (!(ret = realloc_large_block( heapPtr, flags, ptr, size ))) goto oom;
-        goto done;
+        goto resized;
     }
 
     /* Check if we need to grow the block */
@@ -1856,7 +2454,7 @@ PVOID WINAPI RtlReAllocateHeap( HANDLE heap, ULONG flags, PVOID ptr, SIZE_T size
             memcpy( ret, pArena + 1, oldActualSize );
             notify_free( pArena + 1 );
             HEAP_MakeInUseBlockFree( subheap, pArena );
-            goto done;
+            goto resized;
         }
         if ((pNext < (char *)subheap->base + subheap->size) &&
             (*(DWORD *)pNext & ARENA_FLAG_FREE) &&
@@ -1920,6 +2518,8 @@ PVOID WINAPI RtlReAllocateHeap( HANDLE heap, ULONG flags, PVOID ptr, SIZE_T size
     /* Return the new arena */
 
     ret = pArena + 1;
+resized:
+    if (heapPtr->profile) prof_record_realloc( heapPtr, oldActualSize, size );
 done:
     if (!(flags & HEAP_NO_SERIALIZE)) RtlLeaveCriticalSection( &heapPtr->critSection );
     TRACE("(%p,%08x,%p,%08lx): returning %p\n", heap, flags, ptr, size, ret );
@@ -1950,16 +2550,41 @@ error:
  *  flags [I] HEAP_ flags from "winnt.h"
  *
  * RETURNS
- *  The number of bytes compacted.
+ *  The size of the largest committed free block in the heap.
  *
  * NOTES
- *  This function is a harmless stub.
+ *  Free blocks are already coalesced, so nothing is actually compacted.
+ *  When the heapprof debug channel is enabled, the heap allocation
+ *  statistics are dumped first.
  */
 ULONG WINAPI RtlCompactHeap( HANDLE heap, ULONG flags )
 {
-    static BOOL reported;
-    if (!reported++) FIXME( "(%p, 0x%x) stub\n", heap, flags );
-    return 0;
+    HEAP *heapPtr = HEAP_GetPtr( heap );
+    SUBHEAP *subheap;
+    struct list *ptr;
+    char *start, *end;
+    SIZE_T largest = 0;
+
+    if (!heapPtr) return 0;
+    prof_dump( heapPtr );
+
+    flags |= heapPtr->flags;
+    if (!(flags & HEAP_NO_SERIALIZE)) RtlEnterCriticalSection( &heapPtr->critSection );
+    LIST_FOR_EACH( ptr, &heapPtr->freeList[0].arena.entry )
+    {
+        ARENA_FREE *pArena = LIST_ENTRY( ptr, ARENA_FREE, entry );
+
+        if (!(pArena->size & ARENA_SIZE_MASK)) continue;  /* free list head */
+        if (!(subheap = HEAP_FindSubHeap( heapPtr, pArena ))) continue;
+        start = (char *)pArena + sizeof(ARENA_INUSE);
+        end = min( (char *)(pArena + 1) + (pArena->size & ARENA_SIZE_MASK),
+                   (char *)subheap->base + subheap->commitSize );
+        if (end > start) largest = max( largest, end - start );
+    }
+    if (!(flags & HEAP_NO_SERIALIZE)) RtlLeaveCriticalSection( &heapPtr->critSection );
+
+    TRACE( "(%p, 0x%x) returning %lu\n", heap, flags, largest );
+    return min( largest, ~0u );
 }
 
 
@@ -2036,9 +2661,23 @@ SIZE_T WINAPI RtlSizeHeap( HANDLE heap, ULONG flags, const void *ptr )
     }
     flags &= HEAP_NO_SERIALIZE;
     flags |= heapPtr->flags;
+    pArena = (const ARENA_INUSE *)ptr - 1;
+
+    if (get_lfh_segment( heapPtr, pArena ))
+    {
+        if (pArena->magic == ARENA_LFH_MAGIC)
+            ret = (pArena->size & ARENA_SIZE_MASK) - pArena->unused_bytes;
+        else
+        {
+            RtlSetLastWin32ErrorAndNtStatusFromNtStatus( STATUS_INVALID_PARAMETER );
+            ret = ~0UL;
+        }
+        TRACE("(%p,%08x,%p): returning %08lx\n", heap, flags, ptr, ret );
+        return ret;
+    }
+
     if (!(flags & HEAP_NO_SERIALIZE)) RtlEnterCriticalSection( &heapPtr->critSection );
 
-    pArena = (const ARENA_INUSE *)ptr - 1;
     if (!validate_block_pointer( heapPtr, &subheap, pArena ))
     {
         RtlSetLastWin32ErrorAndNtStatusFromNtStatus( STATUS_INVALID_PARAMETER );
@@ -2102,7 +2741,7 @@ NTSTATUS WINAPI RtlWalkHeap( HANDLE heap, PVOID entry_ptr )
 
     if (!(heapPtr->flags & HEAP_NO_SERIALIZE)) RtlEnterCriticalSection( &heapPtr->critSection );
 
-    /* FIXME: enumerate large blocks too */
+    /* FIXME: enumerate large blocks and LFH blocks too */
 
     /* set ptr to the next arena to be examined */
 
@@ -2246,6 +2885,8 @@ ULONG WINAPI RtlGetProcessHeaps( ULONG count, HANDLE *heaps )
 NTSTATUS WINAPI RtlQueryHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS info_class,
                                          PVOID info, SIZE_T size_in, PSIZE_T size_out)
 {
+    HEAP *heapPtr;
+
     switch (info_class)
     {
     case HeapCompatibilityInformation:
@@ -2254,7 +2895,8 @@ NTSTATUS WINAPI RtlQueryHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS inf
         if (size_in < sizeof(ULONG))
             return STATUS_BUFFER_TOO_SMALL;
 
-        *(ULONG *)info = 0; /* standard heap */
+        if (!(heapPtr = HEAP_GetPtr( heap ))) return STATUS_INVALID_HANDLE;
+        *(ULONG *)info = heapPtr->compat_info;
         return STATUS_SUCCESS;
 
     default:
@@ -2268,6 +2910,35 @@ NTSTATUS WINAPI RtlQueryHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS inf
  */
 NTSTATUS WINAPI RtlSetHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS info_class, PVOID info, SIZE_T size)
 {
-    FIXME("%p %d %p %ld stub\n", heap, info_class, info, size);
-    return STATUS_SUCCESS;
+    HEAP *heapPtr;
+    ULONG compat_info;
+
+    switch (info_class)
+    {
+    case HeapCompatibilityInformation:
+        if (size < sizeof(ULONG)) return STATUS_BUFFER_TOO_SMALL;
+        if (!(heapPtr = HEAP_GetPtr( heap ))) return STATUS_INVALID_HANDLE;
+
+        compat_info = *(ULONG *)info;
+        if (compat_info == heapPtr->compat_info) return STATUS_SUCCESS;
+        if (compat_info != HEAP_LFH)
+        {
+            FIXME("%p: unsupported compatibility mode %u\n", heap, compat_info);
+            return STATUS_UNSUCCESSFUL;
+        }
+        /* the LFH can't be used with debugging, unserialized or fixed-size heaps */
+        if ((heapPtr->flags & (HEAP_NO_SERIALIZE | HEAP_VALIDATE | HEAP_TAIL_CHECKING_ENABLED |
+                               HEAP_FREE_CHECKING_ENABLED | HEAP_PAGE_ALLOCS)) ||
+            !(heapPtr->flags & HEAP_GROWABLE) ||
+            heapPtr->pending_free || RUNNING_ON_VALGRIND)
+            return STATUS_UNSUCCESSFUL;
+
+        TRACE("%p: enabling low fragmentation heap\n", heap);
+        heapPtr->compat_info = HEAP_LFH;
+        return STATUS_SUCCESS;
+
+    default:
+        FIXME("%p %d %p %ld stub\n", heap, info_class, info, size);
+        return STATUS_SUCCESS;
+    }
 }
@@ -23,10 +23,16 @@
 #include "wine/port.h"
 
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <stdarg.h>
+#include <stdio.h>
 #ifdef HAVE_SYS_MMAN_H
 # include <sys/mman.h>
 #endif
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>
+#endif
 
 #include "ntstatus.h"
 #define WIN32_NO_STATUS
@@ -87,8 +93,13 @@ static const WCHAR dllW[] = {'.','d','l','l',0};
 typedef struct _wine_modref
 {
     LDR_MODULE            ldr;
+    LIST_ENTRY            base_entry;    /* entry in the base address hash table */
+    LIST_ENTRY            name_entry;    /* entry in the base name hash table */
+    LIST_ENTRY            fileid_entry;  /* entry in the file id hash table */
     dev_t                 dev;
     ino_t                 ino;
+    LONGLONG              mtime;         /* modification time in nanoseconds */
+    ULONGLONG             size;          /* file size */
     int                   alloc_deps;
     int                   nDeps;
     struct _wine_modref **deps;
@@ -122,6 +133,12 @@ static RTL_CRITICAL_SECTION_DEBUG critsect_debug =
 static RTL_CRITICAL_SECTION loader_section = { &critsect_debug, -1, 0, 0, 0, 0 };
 
 static WINE_MODREF *cached_modref;
+
+/* hash tables for fast module lookups, protected by the loader_section */
+#define MODULE_HASH_SIZE 256
+static LIST_ENTRY base_hash_table[MODULE_HASH_SIZE];
+static LIST_ENTRY name_hash_table[MODULE_HASH_SIZE];
+static LIST_ENTRY fileid_hash_table[MODULE_HASH_SIZE];
 static WINE_MODREF *current_modref;
 static WINE_MODREF *last_failed_modref;
 
@@ -343,6 +360,41 @@ static inline ULONG_PTR allocate_stub( const char *dll, const char *name ) { ret
 #endif  /* __i386__ */
 
 
+/* the hash table heads are initialized on first use */
+static inline LIST_ENTRY *get_hash_bucket( LIST_ENTRY *table, ULONG hash )
+{
+    LIST_ENTRY *bucket = &table[hash % MODULE_HASH_SIZE];
+    if (!bucket->Flink) InitializeListHead( bucket );
+    return bucket;
+}
+
+static inline ULONG hash_base_address( const void *base )
+{
+    /* modules are always aligned on a 64k boundary */
+    return (ULONG)((ULONG_PTR)base >> 16);
+}
+
+/* must be consistent with strcmpiW */
+static inline ULONG hash_name( const WCHAR *name )
+{
+    ULONG hash = 0;
+    while (*name) hash = hash * 65599 + tolowerW( *name++ );
+    return hash;
+}
+
+static inline ULONG hash_fileid( dev_t dev, ino_t ino )
+{
+    return (ULONG)ino * 31 + (ULONG)dev;
+}
+
+/* retrieve the base name part of a full path, the same way alloc_module does it */
+static inline const WCHAR *get_basename( const WCHAR *name )
+{
+    const WCHAR *p = strrchrW( name, '\\' );
+    return p ? p + 1 : name;
+}
+
+
 /*************************************************************************
  *		get_modref
  *
@@ -352,16 +404,14 @@ static inline ULONG_PTR allocate_stub( const char *dll, const char *name ) { ret
 static WINE_MODREF *get_modref( HMODULE hmod )
 {
     PLIST_ENTRY mark, entry;
-    PLDR_MODULE mod;
 
     if (cached_modref && cached_modref->ldr.BaseAddress == hmod) return cached_modref;
 
-    mark = &NtCurrentTeb()->Peb->LdrData->InMemoryOrderModuleList;
+    mark = get_hash_bucket( base_hash_table, hash_base_address( hmod ));
     for (entry = mark->Flink; entry != mark; entry = entry->Flink)
     {
-        mod = CONTAINING_RECORD(entry, LDR_MODULE, InMemoryOrderModuleList);
-        if (mod->BaseAddress == hmod)
-            return cached_modref = CONTAINING_RECORD(mod, WINE_MODREF, ldr);
+        WINE_MODREF *wm = CONTAINING_RECORD( entry, WINE_MODREF, base_entry );
+        if (wm->ldr.BaseAddress == hmod) return cached_modref = wm;
     }
     return NULL;
 }
@@ -380,15 +430,11 @@ static WINE_MODREF *find_basename_module( LPCWSTR name )
     if (cached_modref && !strcmpiW( name, cached_modref->ldr.BaseDllName.Buffer ))
         return cached_modref;
 
-    mark = &NtCurrentTeb()->Peb->LdrData->InLoadOrderModuleList;
+    mark = get_hash_bucket( name_hash_table, hash_name( name ));
     for (entry = mark->Flink; entry != mark; entry = entry->Flink)
     {
-        LDR_MODULE *mod = CONTAINING_RECORD(entry, LDR_MODULE, InLoadOrderModuleList);
-        if (!strcmpiW( name, mod->BaseDllName.Buffer ))
-        {
-            cached_modref = CONTAINING_RECORD(mod, WINE_MODREF, ldr);
-            return cached_modref;
-        }
+        WINE_MODREF *wm = CONTAINING_RECORD( entry, WINE_MODREF, name_entry );
+        if (!strcmpiW( name, wm->ldr.BaseDllName.Buffer )) return cached_modref = wm;
     }
     return NULL;
 }
@@ -407,15 +453,12 @@ static WINE_MODREF *find_fullname_module( LPCWSTR name )
     if (cached_modref && !strcmpiW( name, cached_modref->ldr.FullDllName.Buffer ))
         return cached_modref;
 
-    mark = &NtCurrentTeb()->Peb->LdrData->InLoadOrderModuleList;
+    /* modules with the same full name necessarily have the same base name */
+    mark = get_hash_bucket( name_hash_table, hash_name( get_basename( name )));
     for (entry = mark->Flink; entry != mark; entry = entry->Flink)
     {
-        LDR_MODULE *mod = CONTAINING_RECORD(entry, LDR_MODULE, InLoadOrderModuleList);
-        if (!strcmpiW( name, mod->FullDllName.Buffer ))
-        {
-            cached_modref = CONTAINING_RECORD(mod, WINE_MODREF, ldr);
-            return cached_modref;
-        }
+        WINE_MODREF *wm = CONTAINING_RECORD( entry, WINE_MODREF, name_entry );
+        if (!strcmpiW( name, wm->ldr.FullDllName.Buffer )) return cached_modref = wm;
     }
     return NULL;
 }
@@ -434,17 +477,11 @@ static WINE_MODREF *find_fileid_module( HANDLE handle, struct stat *st )
     if (cached_modref && cached_modref->dev == st->st_dev && cached_modref->ino == st->st_ino)
         return cached_modref;
 
-    mark = &NtCurrentTeb()->Peb->LdrData->InLoadOrderModuleList;
+    mark = get_hash_bucket( fileid_hash_table, hash_fileid( st->st_dev, st->st_ino ));
     for (entry = mark->Flink; entry != mark; entry = entry->Flink)
     {
-        LDR_MODULE *mod = CONTAINING_RECORD( entry, LDR_MODULE, InLoadOrderModuleList );
-        WINE_MODREF *wm = CONTAINING_RECORD( mod, WINE_MODREF, ldr );
-
-        if (wm->dev == st->st_dev && wm->ino == st->st_ino)
-        {
-            cached_modref = wm;
-            return wm;
-        }
+        WINE_MODREF *wm = CONTAINING_RECORD( entry, WINE_MODREF, fileid_entry );
+        if (wm->dev == st->st_dev && wm->ino == st->st_ino) return cached_modref = wm;
     }
     return NULL;
 }
@@ -608,13 +645,261 @@ static FARPROC find_named_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY *
 }
 
 
+/* persistent cache of resolved imports, stored in the config dir for each native module */
+
+#define IMPORT_CACHE_MAGIC    0x43504d49  /* "IMPC" */
+#define IMPORT_CACHE_VERSION  2
+
+struct import_cache_header
+{
+    DWORD   magic;
+    DWORD   version;
+    ULONG64 dev;         /* file id of the importing module */
+    ULONG64 ino;
+    LONG64  mtime;
+    ULONG64 size;
+    DWORD   nb_imports;  /* number of import descriptors */
+    DWORD   pad;
+};
+
+struct import_cache_descr
+{
+    ULONG64 dev;         /* file id of the imported module */
+    ULONG64 ino;
+    LONG64  mtime;
+    ULONG64 size;
+    DWORD   timestamp;   /* TimeDateStamp of the imported module */
+    DWORD   count;       /* number of thunks, followed by their RVAs in the imported module */
+};
+
+struct import_cache_entry
+{
+    struct import_cache_descr descr;
+    DWORD                    *rvas;     /* 0 means the import must be resolved by name */
+    BOOL                      updated;  /* entry needs to be written back */
+};
+
+struct import_cache
+{
+    DWORD                     nb_imports;
+    struct import_cache_entry entries[1];
+};
+
+
+/*************************************************************************
+ *		get_import_cache_path
+ *
+ * Build the unix path of the import cache file for a module.
+ * If dir_only is set, return only the directory containing it.
+ */
+static char *get_import_cache_path( const WINE_MODREF *wm, BOOL dir_only )
+{
+    static const char cache_dir[] = "/importcache";
+    const char *config_dir = wine_get_config_dir();
+    char *path;
+    SIZE_T len = strlen( config_dir ) + sizeof(cache_dir) + 64;
+
+    if (!(path = RtlAllocateHeap( GetProcessHeap(), 0, len ))) return NULL;
+    strcpy( path, config_dir );
+    strcat( path, cache_dir );
+    if (!dir_only)
+        sprintf( path + strlen(path), "/%x%08x-%x%08x-%u",
+                 (UINT)((ULONG64)wm->dev >> 32), (UINT)wm->dev,
+                 (UINT)((ULONG64)wm->ino >> 32), (UINT)wm->ino, (UINT)sizeof(void *) * 8 );
+    return path;
+}
+
+
+/*************************************************************************
+ *		free_import_cache
+ */
+static void free_import_cache( struct import_cache *cache )
+{
+    DWORD i;
+
+    if (!cache) return;
+    for (i = 0; i < cache->nb_imports; i++)
+        RtlFreeHeap( GetProcessHeap(), 0, cache->entries[i].rvas );
+    RtlFreeHeap( GetProcessHeap(), 0, cache );
+}
+
+
+/*************************************************************************
+ *		load_import_cache
+ *
+ * Load the cached import bindings of a module. Entries that can't be
+ * read are left empty and will be filled by import_dll.
+ * The loader_section must be locked while calling this function.
+ */
+static struct import_cache *load_import_cache( const WINE_MODREF *wm, DWORD nb_imports )
+{
+    struct import_cache *cache;
+    struct import_cache_header header;
+    char *path;
+    DWORD i;
+    int fd;
+
+    if (!wm->dev && !wm->ino) return NULL;  /* not backed by a file */
+    if (TRACE_ON(relay) || TRACE_ON(snoop)) return NULL;
+
+    if (!(cache = RtlAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY,
+                                   FIELD_OFFSET( struct import_cache, entries[nb_imports] ))))
+        return NULL;
+    cache->nb_imports = nb_imports;
+
+    if (!(path = get_import_cache_path( wm, FALSE ))) return cache;
+    fd = open( path, O_RDONLY );
+    RtlFreeHeap( GetProcessHeap(), 0, path );
+    if (fd == -1) return cache;
+
+    if (read( fd, &header, sizeof(header) ) != sizeof(header) ||
+        header.magic != IMPORT_CACHE_MAGIC ||
+        header.version != IMPORT_CACHE_VERSION ||
+        header.dev != wm->dev || header.ino != wm->ino || header.mtime != wm->mtime ||
+        header.size != wm->size || header.nb_imports != nb_imports)
+    {
+        TRACE( "ignoring stale import cache for %s\n", debugstr_w(wm->ldr.FullDllName.Buffer) );
+        close( fd );
+        return cache;
+    }
+
+    for (i = 0; i < nb_imports; i++)
+    {
+        struct import_cache_entry *entry = &cache->entries[i];
+        SIZE_T size;
+
+        if (read( fd, &entry->descr, sizeof(entry->descr) ) != sizeof(entry->descr)) break;
+        if (!entry->descr.count) continue;
+        size = entry->descr.count * sizeof(DWORD);
+        if (!(entry->rvas = RtlAllocateHeap( GetProcessHeap(), 0, size )) ||
+            read( fd, entry->rvas, size ) != size)
+        {
+            RtlFreeHeap( GetProcessHeap(), 0, entry->rvas );
+            entry->rvas = NULL;
+            entry->descr.count = 0;
+            break;
+        }
+    }
+    close( fd );
+    return cache;
+}
+
+
+/*************************************************************************
+ *		save_import_cache
+ *
+ * Write back the import cache of a module if it has been modified.
+ * The loader_section must be locked while calling this function.
+ */
+static void save_import_cache( const WINE_MODREF *wm, const struct import_cache *cache )
+{
+    struct import_cache_header header;
+    char *path, *tmp;
+    DWORD i;
+    int fd, ret = 0;
+
+    for (i = 0; i < cache->nb_imports; i++) if (cache->entries[i].updated) break;
+    if (i == cache->nb_imports) return;
+
+    if (!(path = get_import_cache_path( wm, TRUE ))) return;
+    mkdir( path, 0777 );
+    RtlFreeHeap( GetProcessHeap(), 0, path );
+
+    if (!(path = get_import_cache_path( wm, FALSE ))) return;
+    if (!(tmp = RtlAllocateHeap( GetProcessHeap(), 0, strlen(path) + 16 )))
+    {
+        RtlFreeHeap( GetProcessHeap(), 0, path );
+        return;
+    }
+    /* write to a temporary file first, so that other processes never see a partial file */
+    sprintf( tmp, "%s.%x", path, getpid() );
+    if ((fd = open( tmp, O_WRONLY | O_CREAT | O_TRUNC, 0666 )) != -1)
+    {
+        header.magic      = IMPORT_CACHE_MAGIC;
+        header.version    = IMPORT_CACHE_VERSION;
+        header.dev        = wm->dev;
+        header.ino        = wm->ino;
+        header.mtime      = wm->mtime;
+        header.size       = wm->size;
+        header.nb_imports = cache->nb_imports;
+        header.pad        = 0;
+        ret = write( fd, &header, sizeof(header) ) == sizeof(header);
+        for (i = 0; ret && i < cache->nb_imports; i++)
+        {
+            const struct import_cache_entry *entry = &cache->entries[i];
+            SIZE_T size = entry->descr.count * sizeof(DWORD);
+
+            ret = write( fd, &entry->descr, sizeof(entry->descr) ) == sizeof(entry->descr) &&
+                  (!size || write( fd, entry->rvas, size ) == size);
+        }
+        close( fd );
+        if (ret) ret = !rename( tmp, path );
+        if (!ret) unlink( tmp );
+    }
+    if (!ret) WARN( "failed to write import cache %s: %s\n", debugstr_a(path), strerror(errno) );
+    else TRACE( "saved import cache for %s\n", debugstr_w(wm->ldr.FullDllName.Buffer) );
+    RtlFreeHeap( GetProcessHeap(), 0, tmp );
+    RtlFreeHeap( GetProcessHeap(), 0, path );
+}
+
+
+/*************************************************************************
+ *		check_import_cache_entry
+ *
+ * Check whether a cache entry matches the module actually imported.
+ * If not, reset it so that it gets filled with the resolved imports.
+ */
+static BOOL check_import_cache_entry( struct import_cache_entry *entry, const WINE_MODREF *imp,
+                                      DWORD count )
+{
+    const IMAGE_NT_HEADERS *nt = RtlImageNtHeader( imp->ldr.BaseAddress );
+    DWORD i;
+
+    if (!imp->dev && !imp->ino)
+    {
+        /* builtin modules have no file id, their imports can't be cached */
+        if (!entry->descr.count) return FALSE;
+        RtlFreeHeap( GetProcessHeap(), 0, entry->rvas );
+        entry->rvas = NULL;
+        memset( &entry->descr, 0, sizeof(entry->descr) );
+        entry->updated = TRUE;
+        return FALSE;
+    }
+
+    if (entry->descr.count == count && entry->rvas &&
+        entry->descr.dev == imp->dev && entry->descr.ino == imp->ino &&
+        entry->descr.mtime == imp->mtime && entry->descr.size == imp->size &&
+        entry->descr.timestamp == nt->FileHeader.TimeDateStamp)
+    {
+        /* don't trust a corrupted file to point outside of the module */
+        for (i = 0; i < count; i++) if (entry->rvas[i] >= imp->ldr.SizeOfImage) break;
+        if (i == count) return TRUE;
+        WARN( "invalid import cache entry for %s\n", debugstr_w(imp->ldr.FullDllName.Buffer) );
+    }
+
+    RtlFreeHeap( GetProcessHeap(), 0, entry->rvas );
+    memset( &entry->descr, 0, sizeof(entry->descr) );
+    entry->updated = TRUE;
+    if (!(entry->rvas = RtlAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY, count * sizeof(DWORD) )))
+        return FALSE;
+    entry->descr.dev       = imp->dev;
+    entry->descr.ino       = imp->ino;
+    entry->descr.mtime     = imp->mtime;
+    entry->descr.size      = imp->size;
+    entry->descr.timestamp = nt->FileHeader.TimeDateStamp;
+    entry->descr.count     = count;
+    return FALSE;
+}
+
+
 /*************************************************************************
  *		import_dll
  *
  * Import the dll specified by the given import descriptor.
  * The loader_section must be locked while calling this function.
  */
-static BOOL import_dll( HMODULE module, const IMAGE_IMPORT_DESCRIPTOR *descr, LPCWSTR load_path, WINE_MODREF **pwm )
+static BOOL import_dll( HMODULE module, const IMAGE_IMPORT_DESCRIPTOR *descr, LPCWSTR load_path,
+                        WINE_MODREF **pwm, struct import_cache_entry *cache )
 {
     NTSTATUS status;
     WINE_MODREF *wmImp;
@@ -628,7 +913,8 @@ static BOOL import_dll( HMODULE module, const IMAGE_IMPORT_DESCRIPTOR *descr, LP
     DWORD len = strlen(name);
     PVOID protect_base;
     SIZE_T protect_size = 0;
-    DWORD protect_old;
+    DWORD protect_old, i, nb_thunks;
+    BOOL cached;
 
     thunk_list = get_rva( module, (DWORD)descr->FirstThunk );
     if (descr->u.OriginalFirstThunk)
@@ -675,6 +961,7 @@ static BOOL import_dll( HMODULE module, const IMAGE_IMPORT_DESCRIPTOR *descr, LP
     /* unprotect the import address table since it can be located in
      * readonly section */
     while (import_list[protect_size].u1.Ordinal) protect_size++;
+    nb_thunks = protect_size;
     protect_base = thunk_list;
     protect_size *= sizeof(*thunk_list);
     NtProtectVirtualMemory( NtCurrentProcess(), &protect_base,
@@ -709,9 +996,16 @@ static BOOL import_dll( HMODULE module, const IMAGE_IMPORT_DESCRIPTOR *descr, LP
         goto done;
     }
 
-    while (import_list->u1.Ordinal)
+    cached = cache && check_import_cache_entry( cache, wmImp, nb_thunks );
+    if (cached) TRACE_(imports)( "using cached imports for %s\n", name );
+
+    for (i = 0; import_list->u1.Ordinal; i++)
     {
-        if (IMAGE_SNAP_BY_ORDINAL(import_list->u1.Ordinal))
+        if (cached && cache->rvas[i])
+        {
+            thunk_list->u1.Function = (ULONG_PTR)get_rva( imp_mod, cache->rvas[i] );
+        }
+        else if (IMAGE_SNAP_BY_ORDINAL(import_list->u1.Ordinal))
         {
             int ordinal = IMAGE_ORDINAL(import_list->u1.Ordinal);
 
@@ -743,6 +1037,11 @@ static BOOL import_dll( HMODULE module, const IMAGE_IMPORT_DESCRIPTOR *descr, LP
             TRACE_(imports)("--- %s %s.%d = %p\n",
                             pe_name->Name, name, pe_name->Hint, (void *)thunk_list->u1.Function);
         }
+        /* only cache exports that resolve into the imported module itself, not forwards or stubs */
+        if (cache && !cached && cache->rvas &&
+            thunk_list->u1.Function >= (ULONG_PTR)imp_mod &&
+            thunk_list->u1.Function < (ULONG_PTR)imp_mod + wmImp->ldr.SizeOfImage)
+            cache->rvas[i] = thunk_list->u1.Function - (ULONG_PTR)imp_mod;
         import_list++;
         thunk_list++;
     }
@@ -977,6 +1276,7 @@ static NTSTATUS fixup_imports( WINE_MODREF *wm, LPCWSTR load_path )
     int i, dep, nb_imports;
     const IMAGE_IMPORT_DESCRIPTOR *imports;
     WINE_MODREF *prev, *imp;
+    struct import_cache *cache;
     DWORD size;
     NTSTATUS status;
     ULONG_PTR cookie;
@@ -1005,6 +1305,8 @@ static NTSTATUS fixup_imports( WINE_MODREF *wm, LPCWSTR load_path )
     /* load the imported modules. They are automatically
      * added to the modref list of the process.
      */
+    cache = load_import_cache( wm, nb_imports );
+
     prev = current_modref;
     current_modref = wm;
     status = STATUS_SUCCESS;
@@ -1012,7 +1314,8 @@ static NTSTATUS fixup_imports( WINE_MODREF *wm, LPCWSTR load_path )
     {
         dep = wm->nDeps++;
 
-        if (!import_dll( wm->ldr.BaseAddress, &imports[i], load_path, &imp ))
+        if (!import_dll( wm->ldr.BaseAddress, &imports[i], load_path, &imp,
+                         cache ? &cache->entries[i] : NULL ))
         {
             imp = NULL;
             status = STATUS_DLL_NOT_FOUND;
@@ -1020,6 +1323,8 @@ static NTSTATUS fixup_imports( WINE_MODREF *wm, LPCWSTR load_path )
         wm->deps[dep] = imp;
     }
     current_modref = prev;
+    if (cache && !status) save_import_cache( wm, cache );
+    free_import_cache( cache );
     if (wm->ldr.ActivationContext) RtlDeactivateActivationContext( 0, cookie );
     return status;
 }
@@ -1062,6 +1367,10 @@ static WINE_MODREF *alloc_module( HMODULE hModule, LPCWSTR filename )
                    &wm->ldr.InLoadOrderModuleList);
     InsertTailList(&NtCurrentTeb()->Peb->LdrData->InMemoryOrderModuleList,
                    &wm->ldr.InMemoryOrderModuleList);
+    InsertTailList( get_hash_bucket( base_hash_table, hash_base_address( hModule )), &wm->base_entry );
+    InsertTailList( get_hash_bucket( name_hash_table, hash_name( p )), &wm->name_entry );
+    /* the file id is not known yet, see set_module_fileid */
+    InitializeListHead( &wm->fileid_entry );
     /* wait until init is called for inserting into InInitializationOrderModuleList */
 
     if (!(nt->OptionalHeader.DllCharacteristics & IMAGE_DLLCHARACTERISTICS_NX_COMPAT))
@@ -1074,6 +1383,29 @@ static WINE_MODREF *alloc_module( HMODULE hModule, LPCWSTR filename )
 }
 
 
+/*************************************************************************
+ *		set_module_fileid
+ *
+ * Set the file id of a module and add it to the file id hash table.
+ * The loader_section must be locked while calling this function.
+ */
+static void set_module_fileid( WINE_MODREF *wm, const struct stat *st )
+{
+    wm->dev = st->st_dev;
+    wm->ino = st->st_ino;
+    wm->mtime = (LONGLONG)st->st_mtime * 1000000000;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+    wm->mtime += st->st_mtim.tv_nsec;
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC)
+    wm->mtime += st->st_mtimespec.tv_nsec;
+#endif
+    wm->size = st->st_size;
+    RemoveEntryList( &wm->fileid_entry );
+    InsertTailList( get_hash_bucket( fileid_hash_table, hash_fileid( wm->dev, wm->ino )),
+                    &wm->fileid_entry );
+}
+
+
 /*************************************************************************
  *              alloc_thread_tls
  *
@@ -1697,9 +2029,12 @@ static void load_builtin_callback( void *module, const char *filename )
         if (!load_path) load_path = emptyW;
         if (fixup_imports( wm, load_path ) != STATUS_SUCCESS)
         {
-            /* the module has only be inserted in the load & memory order lists */
+            /* the module has only be inserted in the load & memory order lists and the hash tables */
             RemoveEntryList(&wm->ldr.InLoadOrderModuleList);
             RemoveEntryList(&wm->ldr.InMemoryOrderModuleList);
+            RemoveEntryList(&wm->base_entry);
+            RemoveEntryList(&wm->name_entry);
+            RemoveEntryList(&wm->fileid_entry);
             /* FIXME: free the modref */
             builtin_load_info->status = STATUS_DLL_NOT_FOUND;
             return;
@@ -1897,6 +2232,7 @@ static NTSTATUS load_native_dll( LPCWSTR load_path, LPCWSTR name, HANDLE file,
     WINE_MODREF *wm;
     NTSTATUS status;
     pe_image_info_t image_info;
+    enum image_reloc reloc = IMAGE_RELOC_NEEDED;
 
     TRACE("Trying native dll %s\n", debugstr_w(name));
 
@@ -1907,12 +2243,13 @@ static NTSTATUS load_native_dll( LPCWSTR load_path, LPCWSTR name, HANDLE file,
     if (status != STATUS_SUCCESS) return status;
 
     module = NULL;
-    status = virtual_map_section( mapping, &module, 0, 0, NULL, &len, PAGE_EXECUTE_READ, &image_info );
-    NtClose( mapping );
+    status = virtual_map_section( mapping, &module, 0, 0, NULL, &len, PAGE_EXECUTE_READ,
+                                  &image_info, &reloc );
 
     if ((status == STATUS_SUCCESS || status == STATUS_IMAGE_NOT_AT_BASE) &&
         !is_valid_binary( module, &image_info ))
     {
+        NtClose( mapping );
         NtUnmapViewOfSection( NtCurrentProcess(), module );
         return STATUS_INVALID_IMAGE_FORMAT;
     }
@@ -1920,7 +2257,12 @@ static NTSTATUS load_native_dll( LPCWSTR load_path, LPCWSTR name, HANDLE file,
     /* perform base relocation, if necessary */
 
     if (status == STATUS_IMAGE_NOT_AT_BASE)
-        status = perform_relocations( module, len );
+    {
+        if (reloc == IMAGE_RELOC_DONE) status = STATUS_SUCCESS;
+        else if (!(status = perform_relocations( module, len )) && reloc == IMAGE_RELOC_WANTED)
+            virtual_publish_relocated_image( mapping, module, len );
+    }
+    NtClose( mapping );
 
     if (status != STATUS_SUCCESS)
     {
@@ -1936,8 +2278,7 @@ static NTSTATUS load_native_dll( LPCWSTR load_path, LPCWSTR name, HANDLE file,
         return STATUS_NO_MEMORY;
     }
 
-    wm->dev = st->st_dev;
-    wm->ino = st->st_ino;
+    set_module_fileid( wm, st );
     if (image_info.loader_flags) wm->ldr.Flags |= LDR_COR_IMAGE;
     if (image_info.image_flags & IMAGE_FLAGS_ComPlusILOnly) wm->ldr.Flags |= LDR_COR_ILONLY;
 
@@ -1957,9 +2298,12 @@ static NTSTATUS load_native_dll( LPCWSTR load_path, LPCWSTR name, HANDLE file,
             status = fixup_imports( wm, load_path );
         if (status != STATUS_SUCCESS)
         {
-            /* the module has only be inserted in the load & memory order lists */
+            /* the module has only be inserted in the load & memory order lists and the hash tables */
             RemoveEntryList(&wm->ldr.InLoadOrderModuleList);
             RemoveEntryList(&wm->ldr.InMemoryOrderModuleList);
+            RemoveEntryList(&wm->base_entry);
+            RemoveEntryList(&wm->name_entry);
+            RemoveEntryList(&wm->fileid_entry);
 
             /* FIXME: there are several more dangling references
              * left. Including dlls loaded by this dll before the
@@ -2891,6 +3235,7 @@ void WINAPI LdrShutdownProcess(void)
     TRACE("()\n");
     process_detaching = TRUE;
     process_detach();
+    heap_dump_profiles();
 }
 
 
@@ -2962,6 +3307,9 @@ static void free_modref( WINE_MODREF *wm )
 {
     RemoveEntryList(&wm->ldr.InLoadOrderModuleList);
     RemoveEntryList(&wm->ldr.InMemoryOrderModuleList);
+    RemoveEntryList(&wm->base_entry);
+    RemoveEntryList(&wm->name_entry);
+    RemoveEntryList(&wm->fileid_entry);
     if (wm->ldr.InInitializationOrderModuleList.Flink)
         RemoveEntryList(&wm->ldr.InInitializationOrderModuleList);
 
@@ -3262,11 +3610,24 @@ void WINAPI LdrInitializeThunk( void *kernel_start, ULONG_PTR unknown2,
     PEB *peb = NtCurrentTeb()->Peb;
 
     kernel32_start_process = kernel_start;
-    if (main_exe_file) NtClose( main_exe_file );  /* at this point the main module is created */
 
     /* allocate the modref for the main exe (if not already done) */
     wm = get_modref( peb->ImageBaseAddress );
     assert( wm );
+
+    if (main_exe_file)  /* at this point the main module is created */
+    {
+        struct stat st;
+        int fd, needs_close;
+
+        if (!(wm->ldr.Flags & LDR_WINE_INTERNAL) &&
+            !server_get_unix_fd( main_exe_file, 0, &fd, &needs_close, NULL, NULL ))
+        {
+            if (!fstat( fd, &st )) set_module_fileid( wm, &st );
+            if (needs_close) close( fd );
+        }
+        NtClose( main_exe_file );
+    }
     if (wm->ldr.Flags & LDR_IMAGE_IS_DLL)
     {
         ERR("%s is a dll, not an executable\n", debugstr_w(wm->ldr.FullDllName.Buffer) );
@@ -46,6 +46,9 @@ struct drive_info
 };
 
 extern NTSTATUS close_handle( HANDLE ) DECLSPEC_HIDDEN;
+
+typedef BOOL (CDECL *wine_cancel_io_callback)( HANDLE handle, IO_STATUS_BLOCK *iosb, BOOL only_thread );
+extern BOOL cancel_client_io( HANDLE handle, IO_STATUS_BLOCK *iosb, BOOL only_thread ) DECLSPEC_HIDDEN;
 extern ULONG_PTR get_system_affinity_mask(void) DECLSPEC_HIDDEN;
 
 /* exceptions */
@@ -79,6 +82,7 @@ extern void virtual_init(void) DECLSPEC_HIDDEN;
 extern void virtual_init_threading(void) DECLSPEC_HIDDEN;
 extern void fill_cpu_info(void) DECLSPEC_HIDDEN;
 extern void heap_set_debug_flags( HANDLE handle ) DECLSPEC_HIDDEN;
+extern void heap_dump_profiles(void) DECLSPEC_HIDDEN;
 
 /* server support */
 extern timeout_t server_start_time DECLSPEC_HIDDEN;
@@ -165,9 +169,17 @@ extern NTSTATUS nt_to_unix_file_name_attr( const OBJECT_ATTRIBUTES *attr, ANSI_S
                                            UINT disposition ) DECLSPEC_HIDDEN;
 
 /* virtual memory */
+enum image_reloc
+{
+    IMAGE_RELOC_NEEDED,     /* the loader has to apply the relocations */
+    IMAGE_RELOC_WANTED,     /* same, and the result should be published for another process */
+    IMAGE_RELOC_DONE        /* the image was mapped from an already relocated copy */
+};
+
 extern NTSTATUS virtual_map_section( HANDLE handle, PVOID *addr_ptr, ULONG zero_bits, SIZE_T commit_size,
                                      const LARGE_INTEGER *offset_ptr, SIZE_T *size_ptr, ULONG protect,
-                                     pe_image_info_t *image_info ) DECLSPEC_HIDDEN;
+                                     pe_image_info_t *image_info, enum image_reloc *reloc ) DECLSPEC_HIDDEN;
+extern void virtual_publish_relocated_image( HANDLE mapping, void *module, SIZE_T size ) DECLSPEC_HIDDEN;
 extern void virtual_get_system_info( SYSTEM_BASIC_INFORMATION *info ) DECLSPEC_HIDDEN;
 extern NTSTATUS virtual_create_builtin_view( void *base ) DECLSPEC_HIDDEN;
 extern NTSTATUS virtual_alloc_thread_stack( TEB *teb, SIZE_T reserve_size,
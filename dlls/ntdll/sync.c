@@ -1331,6 +1331,63 @@ NTSTATUS WINAPI NtRemoveIoCompletion( HANDLE CompletionPort, PULONG_PTR Completi
     return status;
 }
 
+/******************************************************************
+ *              NtRemoveIoCompletionEx (NTDLL.@)
+ *              ZwRemoveIoCompletionEx (NTDLL.@)
+ *
+ * (Wait for and) retrieve up to count completion messages from completion object's queue
+ *
+ * PARAMS
+ *      port      [I] HANDLE to I/O completion object
+ *      info      [O] array of retrieved completion messages
+ *      count     [I] size of the info array
+ *      written   [O] number of messages retrieved
+ *      timeout   [I] optional wait time in NTDLL format
+ *      alertable [I] whether the wait is alertable
+ *
+ */
+NTSTATUS WINAPI NtRemoveIoCompletionEx( HANDLE port, FILE_IO_COMPLETION_INFORMATION *info, ULONG count,
+                                        ULONG *written, LARGE_INTEGER *timeout, BOOLEAN alertable )
+{
+    struct completion_msg msgs[64];
+    NTSTATUS status;
+    ULONG i, ret = 0;
+
+    TRACE( "(%p, %p, %u, %p, %p, %u)\n", port, info, count, written, timeout, alertable );
+
+    if (!count) return STATUS_INVALID_PARAMETER;
+
+    while (ret < count)
+    {
+        SERVER_START_REQ( remove_completions )
+        {
+            req->handle = wine_server_obj_handle( port );
+            wine_server_set_reply( req, msgs, min( count - ret, sizeof(msgs)/sizeof(msgs[0]) ) * sizeof(msgs[0]) );
+            if (!(status = wine_server_call( req )))
+            {
+                for (i = 0; i < wine_server_reply_size( reply ) / sizeof(msgs[0]); i++, ret++)
+                {
+                    info[ret].CompletionKey             = msgs[i].ckey;
+                    info[ret].CompletionValue           = msgs[i].cvalue;
+                    info[ret].IoStatusBlock.Information = msgs[i].information;
+                    info[ret].IoStatusBlock.u.Status    = msgs[i].status;
+                }
+            }
+        }
+        SERVER_END_REQ;
+
+        if (status != STATUS_PENDING) break;
+        if (ret) break;  /* don't wait once we got something */
+
+        status = NtWaitForSingleObject( port, alertable, timeout );
+        if (status != WAIT_OBJECT_0) break;
+    }
+
+    *written = ret;
+    if (ret) return STATUS_SUCCESS;
+    return status;
+}
+
 /******************************************************************
  *              NtOpenIoCompletion (NTDLL.@)
  *              ZwOpenIoCompletion (NTDLL.@)
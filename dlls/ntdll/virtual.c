@@ -74,6 +74,9 @@ struct file_view
     void         *base;          /* base address */
     size_t        size;          /* size in bytes */
     unsigned int  protect;       /* protection for all pages at allocation time and SEC_* flags */
+    char         *tree_start;    /* start of the first view in the tree entry's subtree */
+    char         *tree_end;      /* end of the last view in the tree entry's subtree */
+    size_t        tree_gap;      /* largest free gap between two views of the subtree */
 };
 
 /* per-page protection flags */
@@ -281,6 +284,35 @@ static int compare_view( const void *addr, const struct wine_rb_entry *entry )
 }
 
 
+/***********************************************************************
+ *           augment_view
+ *
+ * Recompute the subtree bounds and largest free gap of a view tree entry.
+ */
+static void augment_view( struct wine_rb_entry *entry )
+{
+    struct file_view *view = WINE_RB_ENTRY_VALUE( entry, struct file_view, entry );
+
+    view->tree_start = view->base;
+    view->tree_end = (char *)view->base + view->size;
+    view->tree_gap = 0;
+
+    if (entry->left)
+    {
+        struct file_view *left = WINE_RB_ENTRY_VALUE( entry->left, struct file_view, entry );
+        view->tree_start = left->tree_start;
+        view->tree_gap = max( left->tree_gap, (char *)view->base - left->tree_end );
+    }
+    if (entry->right)
+    {
+        struct file_view *right = WINE_RB_ENTRY_VALUE( entry->right, struct file_view, entry );
+        view->tree_end = right->tree_end;
+        view->tree_gap = max( view->tree_gap, right->tree_gap );
+        view->tree_gap = max( view->tree_gap, right->tree_start - ((char *)view->base + view->size) );
+    }
+}
+
+
 /***********************************************************************
  *           VIRTUAL_GetProtStr
  */
@@ -451,70 +483,70 @@ static struct file_view *find_view_range( const void *addr, size_t size )
 
 
 /***********************************************************************
- *           find_free_area
+ *           find_free_area_in_tree
  *
- * Find a free area between views inside the specified range.
- * The csVirtual section must be held by caller.
+ * Find a free area inside the subtree of the specified entry, or between the subtree
+ * and the lower and upper bounds. The bounds are clipped to the range being searched.
  */
-static void *find_free_area( void *base, void *end, size_t size, size_t mask, int top_down )
+static void *find_free_area_in_tree( struct wine_rb_entry *entry, char *lower, char *upper,
+                                     size_t size, size_t mask, int top_down )
 {
-    struct wine_rb_entry *first = NULL, *ptr = views_tree.root;
-    void *start;
+    struct file_view *view;
+    char *start;
+    void *ret;
 
-    /* find the first (resp. last) view inside the range */
-    while (ptr)
+    if (upper <= lower || (size_t)(upper - lower) < size) return NULL;
+
+    if (!entry)
     {
-        struct file_view *view = WINE_RB_ENTRY_VALUE( ptr, struct file_view, entry );
-        if ((char *)view->base + view->size >= (char *)end)
-        {
-            end = min( end, view->base );
-            ptr = ptr->left;
-        }
-        else if (view->base <= base)
+        if (top_down)
         {
-            base = max( (char *)base, (char *)view->base + view->size );
-            ptr = ptr->right;
+            start = ROUND_ADDR( upper - size, mask );
+            if (start < lower) return NULL;
         }
         else
         {
-            first = ptr;
-            ptr = top_down ? ptr->right : ptr->left;
+            start = ROUND_ADDR( lower + mask, mask );
+            if (!start || start < lower || start >= upper || (size_t)(upper - start) < size) return NULL;
         }
+        return start;
     }
 
-    if (top_down)
-    {
-        start = ROUND_ADDR( (char *)end - size, mask );
-        if (start >= end || start < base) return NULL;
+    view = WINE_RB_ENTRY_VALUE( entry, struct file_view, entry );
 
-        while (first)
-        {
-            struct file_view *view = WINE_RB_ENTRY_VALUE( first, struct file_view, entry );
+    /* skip subtrees that don't have any gap large enough */
+    if (view->tree_gap < size &&
+        (view->tree_start <= lower || (size_t)(view->tree_start - lower) < size) &&
+        (view->tree_end >= upper || (size_t)(upper - view->tree_end) < size))
+        return NULL;
 
-            if ((char *)view->base + view->size <= (char *)start) break;
-            start = ROUND_ADDR( (char *)view->base - size, mask );
-            /* stop if remaining space is not large enough */
-            if (!start || start >= end || start < base) return NULL;
-            first = wine_rb_prev( first );
-        }
-    }
-    else
+    if (top_down)
     {
-        start = ROUND_ADDR( (char *)base + mask, mask );
-        if (!start || start >= end || (char *)end - (char *)start < size) return NULL;
+        if ((ret = find_free_area_in_tree( entry->right, max( lower, (char *)view->base + view->size ),
+                                           upper, size, mask, top_down )))
+            return ret;
+        return find_free_area_in_tree( entry->left, lower, min( upper, (char *)view->base ),
+                                       size, mask, top_down );
+    }
+    if ((ret = find_free_area_in_tree( entry->left, lower, min( upper, (char *)view->base ),
+                                       size, mask, top_down )))
+        return ret;
+    return find_free_area_in_tree( entry->right, max( lower, (char *)view->base + view->size ),
+                                   upper, size, mask, top_down );
+}
 
-        while (first)
-        {
-            struct file_view *view = WINE_RB_ENTRY_VALUE( first, struct file_view, entry );
 
-            if ((char *)view->base >= (char *)start + size) break;
-            start = ROUND_ADDR( (char *)view->base + view->size + mask, mask );
-            /* stop if remaining space is not large enough */
-            if (!start || start >= end || (char *)end - (char *)start < size) return NULL;
-            first = wine_rb_next( first );
-        }
-    }
-    return start;
+/***********************************************************************
+ *           find_free_area
+ *
+ * Find a free area between views inside the specified range.
+ * The view tree is augmented with the largest gap of each subtree, so that
+ * subtrees without enough free space can be skipped.
+ * The csVirtual section must be held by caller.
+ */
+static void *find_free_area( void *base, void *end, size_t size, size_t mask, int top_down )
+{
+    return find_free_area_in_tree( views_tree.root, base, end, size, mask, top_down );
 }
 
 
@@ -1352,22 +1384,83 @@ static NTSTATUS map_pe_header( void *ptr, size_t size, int fd, BOOL *removable )
 }
 
 
+/***********************************************************************
+ *           prefetch_image_section
+ *
+ * Start reading in the pages of an image section that will most likely be used,
+ * so that they don't get faulted in one at a time once the code starts running.
+ */
+static void prefetch_image_section( char *base, const IMAGE_SECTION_HEADER *sec,
+                                    const IMAGE_DATA_DIRECTORY *resources )
+{
+#ifdef MADV_WILLNEED
+    SIZE_T size = sec->SizeOfRawData;
+
+    if (!sec->PointerToRawData || !size) return;
+    if (sec->Characteristics & IMAGE_SCN_MEM_DISCARDABLE) return;
+    if (!(sec->Characteristics & (IMAGE_SCN_CNT_CODE | IMAGE_SCN_CNT_INITIALIZED_DATA))) return;
+    /* resources are usually large and only partially used, leave them to demand paging */
+    if (resources->Size && resources->VirtualAddress >= sec->VirtualAddress &&
+        resources->VirtualAddress < sec->VirtualAddress + size) return;
+
+    if (sec->Misc.VirtualSize && sec->Misc.VirtualSize < size) size = sec->Misc.VirtualSize;
+    madvise( base + sec->VirtualAddress, ROUND_SIZE( sec->VirtualAddress, size ), MADV_WILLNEED );
+#endif
+}
+
+
+/***********************************************************************
+ *           get_relocated_image_fd
+ *
+ * Get a file descriptor for the copy of an image relocated to a given base,
+ * if another process mapping the image at that address has published it.
+ * Otherwise wanted is set if another process maps the image at that address
+ * and would share the copy relocated by this one.
+ */
+static int get_relocated_image_fd( HANDLE hmapping, void *base, BOOL *wanted )
+{
+    HANDLE file;
+    NTSTATUS status;
+    int fd, needs_close;
+
+    SERVER_START_REQ( get_image_relocation )
+    {
+        req->mapping = wine_server_obj_handle( hmapping );
+        req->base    = wine_server_client_ptr( base );
+        status = wine_server_call( req );
+        file = wine_server_ptr_handle( reply->file );
+        *wanted = reply->wanted;
+    }
+    SERVER_END_REQ;
+    if (status) return -1;
+
+    if (server_get_unix_fd( file, FILE_READ_DATA, &fd, &needs_close, NULL, NULL )) fd = -1;
+    else if (!needs_close) fd = dup( fd );
+    close_handle( file );
+    return fd;
+}
+
+
 /***********************************************************************
  *           map_image
  *
  * Map an executable (PE format) image into memory.
+ * If reloc is not NULL, the image may be mapped already relocated, in which case it's set
+ * to IMAGE_RELOC_DONE.
  */
 static NTSTATUS map_image( HANDLE hmapping, ACCESS_MASK access, int fd, SIZE_T mask,
-                           pe_image_info_t *image_info, int shared_fd, BOOL removable, PVOID *addr_ptr )
+                           pe_image_info_t *image_info, int shared_fd, BOOL removable, PVOID *addr_ptr,
+                           enum image_reloc *reloc )
 {
     IMAGE_DOS_HEADER *dos;
     IMAGE_NT_HEADERS *nt;
     IMAGE_SECTION_HEADER sections[96];
     IMAGE_SECTION_HEADER *sec;
-    IMAGE_DATA_DIRECTORY *imports;
+    IMAGE_DATA_DIRECTORY *imports, resources;
     NTSTATUS status = STATUS_CONFLICTING_ADDRESSES;
     SIZE_T header_size, total_size = image_info->map_size;
-    int i;
+    int i, reloc_fd;
+    BOOL wanted = FALSE;
     off_t pos;
     sigset_t sigset;
     struct stat st;
@@ -1425,6 +1518,7 @@ static NTSTATUS map_image( HANDLE hmapping, ACCESS_MASK access, int fd, SIZE_T m
 
     imports = nt->OptionalHeader.DataDirectory + IMAGE_DIRECTORY_ENTRY_IMPORT;
     if (!imports->Size || !imports->VirtualAddress) imports = NULL;
+    resources = nt->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_RESOURCE];
 
     /* check for non page-aligned binary */
 
@@ -1452,6 +1546,22 @@ static NTSTATUS map_image( HANDLE hmapping, ACCESS_MASK access, int fd, SIZE_T m
         goto done;
     }
 
+    /* map the copy published by another process that relocated the dll to this address, if any */
+
+    if (reloc && ptr != base && shared_fd == -1 && !removable &&
+        (image_info->image_charact & IMAGE_FILE_DLL) &&
+        (reloc_fd = get_relocated_image_fd( hmapping, ptr, &wanted )) != -1)
+    {
+        NTSTATUS res = map_file_into_view( view, reloc_fd, 0, total_size, 0,
+                                           VPROT_COMMITTED | VPROT_READ | VPROT_WRITECOPY, FALSE );
+        close( reloc_fd );
+        if (res != STATUS_SUCCESS) goto error;
+        TRACE_(module)( "mapped relocated copy of image at %p\n", ptr );
+        *reloc = IMAGE_RELOC_DONE;
+        goto set_protections;
+    }
+    if (wanted) *reloc = IMAGE_RELOC_WANTED;
+
 
     /* map all the sections */
 
@@ -1544,6 +1654,7 @@ static NTSTATUS map_image( HANDLE hmapping, ACCESS_MASK access, int fd, SIZE_T m
 
     /* set the image protections */
 
+ set_protections:
     VIRTUAL_SetProt( view, ptr, ROUND_SIZE( 0, header_size ), VPROT_COMMITTED | VPROT_READ );
 
     sec = sections;
@@ -1569,6 +1680,9 @@ static NTSTATUS map_image( HANDLE hmapping, ACCESS_MASK access, int fd, SIZE_T m
         if (!VIRTUAL_SetProt( view, ptr + sec->VirtualAddress, size, vprot ) && (vprot & VPROT_EXEC))
             ERR( "failed to set %08x protection on section %.8s, noexec filesystem?\n",
                  sec->Characteristics, sec->Name );
+
+        /* sections read from removable media are already in memory */
+        if (!removable) prefetch_image_section( ptr, sec, &resources );
     }
 
  done:
@@ -1602,6 +1716,44 @@ static NTSTATUS map_image( HANDLE hmapping, ACCESS_MASK access, int fd, SIZE_T m
 }
 
 
+/***********************************************************************
+ *             virtual_publish_relocated_image
+ *
+ * Publish the image just relocated by the loader, so that the other processes
+ * mapping it at the same address can share the relocated pages. Only done
+ * once map_image found that another process maps it there too.
+ */
+void virtual_publish_relocated_image( HANDLE mapping, void *module, SIZE_T size )
+{
+    LARGE_INTEGER section_size;
+    HANDLE section;
+    SIZE_T view_size = 0;
+    void *ptr = NULL;
+
+    if (!virtual_check_buffer_for_read( module, size )) return;
+
+    section_size.QuadPart = size;
+    if (NtCreateSection( &section, SECTION_MAP_READ | SECTION_MAP_WRITE, NULL, &section_size,
+                         PAGE_READWRITE, SEC_COMMIT, 0 )) return;
+    if (!NtMapViewOfSection( section, NtCurrentProcess(), &ptr, 0, 0, NULL, &view_size,
+                             ViewShare, 0, PAGE_READWRITE ))
+    {
+        memcpy( ptr, module, size );
+        NtUnmapViewOfSection( NtCurrentProcess(), ptr );
+
+        SERVER_START_REQ( publish_image_relocation )
+        {
+            req->mapping = wine_server_obj_handle( mapping );
+            req->base    = wine_server_client_ptr( module );
+            req->copy    = wine_server_obj_handle( section );
+            if (!wine_server_call( req )) TRACE_(module)( "published relocated copy of image at %p\n", module );
+        }
+        SERVER_END_REQ;
+    }
+    NtClose( section );
+}
+
+
 /***********************************************************************
  *             virtual_map_section
  *
@@ -1609,7 +1761,7 @@ static NTSTATUS map_image( HANDLE hmapping, ACCESS_MASK access, int fd, SIZE_T m
  */
 NTSTATUS virtual_map_section( HANDLE handle, PVOID *addr_ptr, ULONG zero_bits, SIZE_T commit_size,
                               const LARGE_INTEGER *offset_ptr, SIZE_T *size_ptr, ULONG protect,
-                              pe_image_info_t *image_info )
+                              pe_image_info_t *image_info, enum image_reloc *reloc )
 {
     NTSTATUS res;
     mem_size_t full_size;
@@ -1670,13 +1822,14 @@ NTSTATUS virtual_map_section( HANDLE handle, PVOID *addr_ptr, ULONG zero_bits, S
             if ((res = server_get_unix_fd( shared_file, FILE_READ_DATA|FILE_WRITE_DATA,
                                            &shared_fd, &shared_needs_close, NULL, NULL ))) goto done;
             res = map_image( handle, access, unix_handle, mask, image_info,
-                             shared_fd, needs_close, addr_ptr );
+                             shared_fd, needs_close, addr_ptr, reloc );
             if (shared_needs_close) close( shared_fd );
             close_handle( shared_file );
         }
         else
         {
-            res = map_image( handle, access, unix_handle, mask, image_info, -1, needs_close, addr_ptr );
+            res = map_image( handle, access, unix_handle, mask, image_info, -1, needs_close,
+                             addr_ptr, reloc );
         }
         if (needs_close) close( unix_handle );
         if (res >= 0) *size_ptr = image_info->map_size;
@@ -1830,7 +1983,7 @@ void virtual_init(void)
     view_block_start = alloc_views.base;
     view_block_end = view_block_start + view_block_size / sizeof(*view_block_start);
     pages_vprot = (void *)((char *)alloc_views.base + view_block_size);
-    wine_rb_init( &views_tree, compare_view );
+    wine_rb_init_augmented( &views_tree, compare_view, augment_view );
 
     /* make the DOS area accessible (except the low 64K) to hide bugs in broken apps like Excel 2003 */
     size = (char *)address_space_start - (char *)0x10000;
@@ -1967,6 +2120,7 @@ NTSTATUS virtual_alloc_thread_stack( TEB *teb, SIZE_T reserve_size, SIZE_T commi
         /* shrink the first view and create a second one for the extra size */
         /* this allows the app to free the stack without freeing the thread start portion */
         view->size -= extra_size;
+        wine_rb_augment_path( &views_tree, &view->entry );
         status = create_view( &extra_view, (char *)view->base + view->size, extra_size,
                               VPROT_READ | VPROT_WRITE | VPROT_COMMITTED );
         if (status != STATUS_SUCCESS)
@@ -2169,6 +2323,64 @@ ssize_t CDECL __wine_locked_recvmsg( int fd, struct msghdr *hdr, int flags )
 }
 
 
+#ifdef HAVE_RECVMMSG
+
+/***********************************************************************
+ *           __wine_locked_recvmmsg
+ */
+int CDECL __wine_locked_recvmmsg( int fd, struct mmsghdr *hdrs, unsigned int count, int flags )
+{
+    sigset_t sigset;
+    unsigned int i;
+    size_t j = 0;
+    BOOL has_write_watch = FALSE;
+    int err = EFAULT;
+
+    int ret = recvmmsg( fd, hdrs, count, flags, NULL );
+    if (ret != -1 || errno != EFAULT) return ret;
+
+    server_enter_uninterrupted_section( &csVirtual, &sigset );
+    for (i = 0; i < count; i++)
+    {
+        struct msghdr *hdr = &hdrs[i].msg_hdr;
+
+        for (j = 0; j < hdr->msg_iovlen; j++)
+            if (check_write_access( hdr->msg_iov[j].iov_base, hdr->msg_iov[j].iov_len, &has_write_watch ))
+                break;
+        if (j < hdr->msg_iovlen) break;
+    }
+    if (i == count)
+    {
+        ret = recvmmsg( fd, hdrs, count, flags, NULL );
+        err = errno;
+    }
+    if (has_write_watch)
+    {
+        if (i < count)
+            while (j--) update_write_watches( hdrs[i].msg_hdr.msg_iov[j].iov_base,
+                                              hdrs[i].msg_hdr.msg_iov[j].iov_len, 0 );
+        while (i--)
+            for (j = 0; j < hdrs[i].msg_hdr.msg_iovlen; j++)
+                update_write_watches( hdrs[i].msg_hdr.msg_iov[j].iov_base,
+                                      hdrs[i].msg_hdr.msg_iov[j].iov_len, 0 );
+    }
+
+    server_leave_uninterrupted_section( &csVirtual, &sigset );
+    errno = err;
+    return ret;
+}
+
+#else  /* HAVE_RECVMMSG */
+
+int CDECL __wine_locked_recvmmsg( int fd, void *hdrs, unsigned int count, int flags )
+{
+    errno = ENOSYS;
+    return -1;
+}
+
+#endif  /* HAVE_RECVMMSG */
+
+
 /***********************************************************************
  *           virtual_is_valid_code_address
  */
@@ -3122,7 +3334,7 @@ NTSTATUS WINAPI NtMapViewOfSection( HANDLE handle, HANDLE process, PVOID *addr_p
     }
 
     return virtual_map_section( handle, addr_ptr, zero_bits, commit_size,
-                                offset_ptr, size_ptr, protect, &image_info );
+                                offset_ptr, size_ptr, protect, &image_info, NULL );
 }
 
 
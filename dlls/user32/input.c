@@ -171,28 +171,29 @@ static void update_mouse_coords( INPUT *input )
  */
 UINT WINAPI SendInput( UINT count, LPINPUT inputs, int size )
 {
-    UINT i;
+    INPUT batch[64];
+    UINT i, n, sent, total = 0;
     NTSTATUS status;
 
-    for (i = 0; i < count; i++)
+    while (total < count)
     {
-        if (inputs[i].type == INPUT_MOUSE)
-        {
-            /* we need to update the coordinates to what the server expects */
-            INPUT input = inputs[i];
-            update_mouse_coords( &input );
-            status = send_hardware_message( 0, &input, SEND_HWMSG_INJECTED );
-        }
-        else status = send_hardware_message( 0, &inputs[i], SEND_HWMSG_INJECTED );
-
+        n = min( count - total, ARRAY_SIZE(batch) );
+        memcpy( batch, inputs + total, n * sizeof(batch[0]) );
+        /* we need to update the coordinates to what the server expects */
+        for (i = 0; i < n; i++)
+            if (batch[i].type == INPUT_MOUSE) update_mouse_coords( &batch[i] );
+
+        status = send_hardware_messages( 0, batch, n, SEND_HWMSG_INJECTED, &sent );
+        total += sent;
         if (status)
         {
             SetLastError( RtlNtStatusToDosError(status) );
             break;
         }
+        if (sent < n) break;
     }
 
-    return i;
+    return total;
 }
 
 
@@ -233,16 +234,66 @@ void WINAPI mouse_event( DWORD dwFlags, DWORD dx, DWORD dy,
 }
 
 
+/***********************************************************************
+ *		get_desktop_shm
+ *
+ * Map the shared input state of the current thread desktop.
+ */
+static const volatile desktop_shm_t *get_desktop_shm(void)
+{
+    struct user_key_state_info *key_state_info = get_user_thread_info()->key_state;
+    HANDLE handle = 0;
+
+    if (!key_state_info)
+    {
+        if (!(key_state_info = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*key_state_info) )))
+            return NULL;
+        get_user_thread_info()->key_state = key_state_info;
+    }
+    if (key_state_info->desktop_shm) return key_state_info->desktop_shm;
+
+    SERVER_START_REQ( get_desktop_shared_memory )
+    {
+        if (!wine_server_call( req )) handle = wine_server_ptr_handle( reply->handle );
+    }
+    SERVER_END_REQ;
+
+    if (!handle) return NULL;
+    key_state_info->desktop_shm = MapViewOfFile( handle, FILE_MAP_READ, 0, 0, 0 );
+    CloseHandle( handle );
+    return key_state_info->desktop_shm;
+}
+
+
 /***********************************************************************
  *		GetCursorPos (USER32.@)
  */
 BOOL WINAPI DECLSPEC_HOTPATCH GetCursorPos( POINT *pt )
 {
+    const volatile desktop_shm_t *shm;
     BOOL ret;
     DWORD last_change;
+    unsigned int seq;
 
     if (!pt) return FALSE;
 
+    if ((shm = get_desktop_shm()))
+    {
+        do
+        {
+            while ((seq = shm->seq) & 1) /* the server is updating the cursor */;
+            shm_read_barrier();
+            pt->x = shm->cursor_x;
+            pt->y = shm->cursor_y;
+            last_change = shm->cursor_last_change;
+            shm_read_barrier();
+        } while (shm->seq != seq);
+
+        /* query new position from graphics driver if we haven't updated recently */
+        if (GetTickCount() - last_change > 100) return USER_Driver->pGetCursorPos( pt );
+        return TRUE;
+    }
+
     SERVER_START_REQ( set_cursor )
     {
         if ((ret = !wine_server_call( req )))
@@ -389,8 +440,9 @@ static void check_for_events( UINT flags )
 SHORT WINAPI DECLSPEC_HOTPATCH GetAsyncKeyState( INT key )
 {
     struct user_key_state_info *key_state_info = get_user_thread_info()->key_state;
+    const volatile desktop_shm_t *shm;
     INT counter = global_key_state_counter;
-    BYTE prev_key_state;
+    BYTE prev_key_state, state;
     SHORT ret;
 
     if (key < 0 || key >= 256) return 0;
@@ -399,6 +451,10 @@ SHORT WINAPI DECLSPEC_HOTPATCH GetAsyncKeyState( INT key )
 
     if ((ret = USER_Driver->pGetAsyncKeyState( key )) == -1)
     {
+        /* the "pressed since last call" bit is cleared by get_key_state, let the server do it */
+        if ((shm = get_desktop_shm()) && !((state = shm->keystate[key]) & 0x40))
+            return (state & 0x80) ? 0x8000 : 0;
+
         if (key_state_info &&
             !(key_state_info->state[key] & 0xc0) &&
             key_state_info->counter == counter &&
@@ -651,9 +707,70 @@ UINT WINAPI GetRawInputData(HRAWINPUT rawinput, UINT command, void *data, UINT *
 */
 UINT WINAPI DECLSPEC_HOTPATCH GetRawInputBuffer(PRAWINPUT pData, PUINT pcbSize, UINT cbSizeHeader)
 {
-    FIXME("(pData=%p, pcbSize=%p, cbSizeHeader=%d) stub!\n", pData, pcbSize, cbSizeHeader);
+    struct hardware_msg_data msg_data[64];
+    RAWINPUT rawinput, *next = pData;
+    UINT i, n, size, max_count, count = 0;
 
-    return 0;
+    TRACE("(pData=%p, pcbSize=%p, cbSizeHeader=%d)\n", pData, pcbSize, cbSizeHeader);
+
+    if (cbSizeHeader != sizeof(RAWINPUTHEADER) || !pcbSize)
+    {
+        SetLastError(ERROR_INVALID_PARAMETER);
+        return ~0U;
+    }
+
+    if (!pData || *pcbSize < sizeof(RAWINPUT))
+    {
+        /* return the size of the next message without removing it */
+        n = 0;
+        SERVER_START_REQ( get_rawinput_buffer )
+        {
+            req->remove = 0;
+            wine_server_set_reply( req, msg_data, sizeof(msg_data[0]) );
+            if (!wine_server_call( req )) n = reply->count;
+        }
+        SERVER_END_REQ;
+
+        if (!n || !rawinput_from_hardware_message( &rawinput, msg_data ))
+        {
+            *pcbSize = 0;
+            return 0;
+        }
+        if (!pData)
+        {
+            *pcbSize = rawinput.header.dwSize;
+            return 0;
+        }
+        /* we only retrieve messages when a full RAWINPUT fits in the buffer */
+        *pcbSize = sizeof(RAWINPUT);
+        SetLastError(ERROR_INSUFFICIENT_BUFFER);
+        return ~0U;
+    }
+
+    /* every message fits in sizeof(RAWINPUT), which is a multiple of the block alignment */
+    max_count = *pcbSize / sizeof(RAWINPUT);
+    while (count < max_count)
+    {
+        size = min( max_count - count, ARRAY_SIZE(msg_data) );
+        n = 0;
+        SERVER_START_REQ( get_rawinput_buffer )
+        {
+            req->remove = 1;
+            wine_server_set_reply( req, msg_data, size * sizeof(msg_data[0]) );
+            if (!wine_server_call( req )) n = reply->count;
+        }
+        SERVER_END_REQ;
+
+        for (i = 0; i < n; i++)
+        {
+            if (!rawinput_from_hardware_message( next, &msg_data[i] )) continue;
+            next = NEXTRAWINPUTBLOCK( next );
+            count++;
+        }
+        if (n < size) break;  /* no more messages */
+    }
+
+    return count;
 }
 
 
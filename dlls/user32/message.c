@@ -2279,17 +2279,13 @@ static void accept_hardware_message( UINT hw_id, BOOL remove )
 }
 
 
-static BOOL process_rawinput_message( MSG *msg, const struct hardware_msg_data *msg_data )
+/***********************************************************************
+ *          rawinput_from_hardware_message
+ *
+ * Convert the server data of a WM_INPUT message to a RAWINPUT structure.
+ */
+BOOL rawinput_from_hardware_message( RAWINPUT *rawinput, const struct hardware_msg_data *msg_data )
 {
-    struct user_thread_info *thread_info = get_user_thread_info();
-    RAWINPUT *rawinput = thread_info->rawinput;
-
-    if (!rawinput)
-    {
-        thread_info->rawinput = HeapAlloc( GetProcessHeap(), 0, sizeof(*rawinput) );
-        if (!(rawinput = thread_info->rawinput)) return FALSE;
-    }
-
     rawinput->header.dwType = msg_data->rawinput.type;
     if (msg_data->rawinput.type == RIM_TYPEMOUSE)
     {
@@ -2386,7 +2382,22 @@ static BOOL process_rawinput_message( MSG *msg, const struct hardware_msg_data *
         FIXME("Unhandled rawinput type %#x.\n", msg_data->rawinput.type);
         return FALSE;
     }
+    return TRUE;
+}
+
+
+static BOOL process_rawinput_message( MSG *msg, const struct hardware_msg_data *msg_data )
+{
+    struct user_thread_info *thread_info = get_user_thread_info();
+    RAWINPUT *rawinput = thread_info->rawinput;
+
+    if (!rawinput)
+    {
+        thread_info->rawinput = HeapAlloc( GetProcessHeap(), 0, sizeof(*rawinput) );
+        if (!(rawinput = thread_info->rawinput)) return FALSE;
+    }
 
+    if (!rawinput_from_hardware_message( rawinput, msg_data )) return FALSE;
     msg->lParam = (LPARAM)rawinput;
     return TRUE;
 }
@@ -2725,6 +2736,68 @@ static inline void call_sendmsg_callback( SENDASYNCPROC callback, HWND hwnd, UIN
 }
 
 
+/***********************************************************************
+ *           get_queue_shm
+ *
+ * Map the shared memory of the server-side queue of the current thread.
+ */
+static const volatile queue_shm_t *get_queue_shm(void)
+{
+    struct user_thread_info *thread_info = get_user_thread_info();
+    HANDLE handle = 0;
+
+    if (thread_info->queue_shm) return thread_info->queue_shm;
+
+    SERVER_START_REQ( get_queue_shared_memory )
+    {
+        if (!wine_server_call( req )) handle = wine_server_ptr_handle( reply->handle );
+    }
+    SERVER_END_REQ;
+
+    if (!handle) return NULL;
+    thread_info->queue_shm = MapViewOfFile( handle, FILE_MAP_READ, 0, 0, 0 );
+    CloseHandle( handle );
+    return thread_info->queue_shm;
+}
+
+
+/***********************************************************************
+ *           is_queue_idle
+ *
+ * Check in the queue shared memory if a get_message request would find nothing
+ * for the given filter, and leave the queue masks unchanged. The request is
+ * also needed until the queue has signaled the process idle event, otherwise
+ * WaitForInputIdle would never return.
+ */
+static BOOL is_queue_idle( UINT flags, UINT wake_mask, UINT changed_mask )
+{
+    struct user_thread_info *thread_info = get_user_thread_info();
+    const volatile queue_shm_t *shm;
+    unsigned int seq, filter = flags >> 16, bits;
+    BOOL ret;
+
+    /* the server considers the thread hung if it doesn't get messages for a while */
+    if (GetTickCount() - thread_info->last_get_msg > 1000) return FALSE;
+    if (!(shm = get_queue_shm())) return FALSE;
+
+    if (!filter) filter = QS_ALLINPUT;
+    bits = filter | QS_SENDMESSAGE;
+    if (filter & QS_POSTMESSAGE) bits |= QS_ALLPOSTMESSAGE;
+
+    do
+    {
+        while ((seq = shm->seq) & 1) /* the server is updating the data */;
+        shm_read_barrier();
+        /* changed bits are cleared by get_message, let the server do it */
+        ret = shm->idle && !(shm->wake_bits & bits) && !(shm->changed_bits & bits) &&
+              shm->wake_mask == wake_mask && shm->changed_mask == changed_mask;
+        shm_read_barrier();
+    } while (shm->seq != seq);
+
+    return ret;
+}
+
+
 /***********************************************************************
  *           peek_message
  *
@@ -2751,6 +2824,14 @@ static BOOL peek_message( MSG *msg, HWND hwnd, UINT first, UINT last, UINT flags
         size_t size = 0;
         const message_data_t *msg_data = buffer;
 
+        if (!hw_id && is_queue_idle( flags, changed_mask & (QS_SENDMESSAGE | QS_SMRESULT), changed_mask ))
+        {
+            HeapFree( GetProcessHeap(), 0, buffer );
+            thread_info->wake_mask = changed_mask & (QS_SENDMESSAGE | QS_SMRESULT);
+            thread_info->changed_mask = changed_mask;
+            return FALSE;
+        }
+
         SERVER_START_REQ( get_message )
         {
             req->flags     = flags;
@@ -2761,7 +2842,9 @@ static BOOL peek_message( MSG *msg, HWND hwnd, UINT first, UINT last, UINT flags
             req->wake_mask = changed_mask & (QS_SENDMESSAGE | QS_SMRESULT);
             req->changed_mask = changed_mask;
             wine_server_set_reply( req, buffer, buffer_size );
-            if (!(res = wine_server_call( req )))
+            res = wine_server_call( req );
+            thread_info->last_get_msg = GetTickCount();
+            if (!res)
             {
                 size = wine_server_reply_size( reply );
                 info.type        = reply->type;
@@ -3287,6 +3370,110 @@ static BOOL send_message( struct send_message_info *info, DWORD_PTR *res_ptr, BO
 }
 
 
+/***********************************************************************
+ *		input_to_hw_input
+ *
+ * Convert an INPUT structure to the server format.
+ */
+static void input_to_hw_input( hw_input_t *hw_input, const INPUT *input )
+{
+    memset( hw_input, 0, sizeof(*hw_input) );
+    hw_input->type = input->type;
+    switch (input->type)
+    {
+    case INPUT_MOUSE:
+        hw_input->mouse.x     = input->u.mi.dx;
+        hw_input->mouse.y     = input->u.mi.dy;
+        hw_input->mouse.data  = input->u.mi.mouseData;
+        hw_input->mouse.flags = input->u.mi.dwFlags;
+        hw_input->mouse.time  = input->u.mi.time;
+        hw_input->mouse.info  = input->u.mi.dwExtraInfo;
+        break;
+    case INPUT_KEYBOARD:
+        hw_input->kbd.vkey  = input->u.ki.wVk;
+        hw_input->kbd.scan  = input->u.ki.wScan;
+        hw_input->kbd.flags = input->u.ki.dwFlags;
+        hw_input->kbd.time  = input->u.ki.time;
+        hw_input->kbd.info  = input->u.ki.dwExtraInfo;
+        break;
+    case INPUT_HARDWARE:
+        hw_input->hw.msg    = input->u.hi.uMsg;
+        hw_input->hw.lparam = MAKELONG( input->u.hi.wParamL, input->u.hi.wParamH );
+        break;
+    }
+}
+
+
+/***********************************************************************
+ *		send_hardware_messages
+ *
+ * Send a batch of hardware messages, with as few server calls as possible.
+ * The number of inputs that have been sent is returned in 'sent'.
+ */
+NTSTATUS send_hardware_messages( HWND hwnd, const INPUT *inputs, UINT count, UINT flags, UINT *sent )
+{
+    struct user_key_state_info *key_state_info = get_user_thread_info()->key_state;
+    struct send_message_info info;
+    hw_input_t hw_inputs[64];
+    int prev_x, prev_y, new_x, new_y;
+    INT counter;
+    NTSTATUS ret = STATUS_SUCCESS;
+    UINT i, n, done;
+    BOOL wait;
+
+    info.type     = MSG_HARDWARE;
+    info.dest_tid = 0;
+    info.hwnd     = hwnd;
+    info.flags    = 0;
+    info.timeout  = 0;
+
+    for (*sent = 0; *sent < count; *sent += done)
+    {
+        n = min( count - *sent, ARRAY_SIZE(hw_inputs) );
+        for (i = 0; i < n; i++) input_to_hw_input( &hw_inputs[i], &inputs[*sent + i] );
+
+        counter = global_key_state_counter;
+        done = 0;
+        SERVER_START_REQ( send_hardware_messages )
+        {
+            req->win   = wine_server_user_handle( hwnd );
+            req->flags = flags;
+            wine_server_add_data( req, hw_inputs, n * sizeof(hw_inputs[0]) );
+            if (key_state_info) wine_server_set_reply( req, key_state_info->state,
+                                                       sizeof(key_state_info->state) );
+            ret = wine_server_call( req );
+            done   = reply->count;
+            wait   = reply->wait;
+            prev_x = reply->prev_x;
+            prev_y = reply->prev_y;
+            new_x  = reply->new_x;
+            new_y  = reply->new_y;
+        }
+        SERVER_END_REQ;
+
+        if (!ret)
+        {
+            if (key_state_info)
+            {
+                key_state_info->time    = GetTickCount();
+                key_state_info->counter = counter;
+            }
+            if ((flags & SEND_HWMSG_INJECTED) && (prev_x != new_x || prev_y != new_y))
+                USER_Driver->pSetCursorPos( new_x, new_y );
+        }
+
+        if (wait)
+        {
+            LRESULT ignored;
+            wait_message_reply( 0 );
+            retrieve_reply( &info, 0, &ignored );
+        }
+        if (ret || !done) break;
+    }
+    return ret;
+}
+
+
 /***********************************************************************
  *		send_hardware_message
  */
@@ -3307,31 +3494,9 @@ NTSTATUS send_hardware_message( HWND hwnd, const INPUT *input, UINT flags )
 
     SERVER_START_REQ( send_hardware_message )
     {
-        req->win        = wine_server_user_handle( hwnd );
-        req->flags      = flags;
-        req->input.type = input->type;
-        switch (input->type)
-        {
-        case INPUT_MOUSE:
-            req->input.mouse.x     = input->u.mi.dx;
-            req->input.mouse.y     = input->u.mi.dy;
-            req->input.mouse.data  = input->u.mi.mouseData;
-            req->input.mouse.flags = input->u.mi.dwFlags;
-            req->input.mouse.time  = input->u.mi.time;
-            req->input.mouse.info  = input->u.mi.dwExtraInfo;
-            break;
-        case INPUT_KEYBOARD:
-            req->input.kbd.vkey  = input->u.ki.wVk;
-            req->input.kbd.scan  = input->u.ki.wScan;
-            req->input.kbd.flags = input->u.ki.dwFlags;
-            req->input.kbd.time  = input->u.ki.time;
-            req->input.kbd.info  = input->u.ki.dwExtraInfo;
-            break;
-        case INPUT_HARDWARE:
-            req->input.hw.msg    = input->u.hi.uMsg;
-            req->input.hw.lparam = MAKELONG( input->u.hi.wParamL, input->u.hi.wParamH );
-            break;
-        }
+        req->win   = wine_server_user_handle( hwnd );
+        req->flags = flags;
+        input_to_hw_input( &req->input, input );
         if (key_state_info) wine_server_set_reply( req, key_state_info->state,
                                                    sizeof(key_state_info->state) );
         ret = wine_server_call( req );
@@ -1535,6 +1535,66 @@ static void test_GetRawInputDeviceList(void)
     ok(odevcount == oret, "expected %d, got %d\n", oret, odevcount);
 }
 
+static void test_GetRawInputBuffer(void)
+{
+    RAWINPUTDEVICE raw_devices[1];
+    RAWINPUT buffer[16], *rawinput = buffer;
+    UINT size, count, i;
+    HWND hwnd;
+    BOOL ret;
+
+    hwnd = CreateWindowA("static", "static", WS_VISIBLE | WS_POPUP, 0, 0, 100, 100, 0, NULL, NULL, NULL);
+    ok(hwnd != 0, "CreateWindowA failed\n");
+    SetForegroundWindow(hwnd);
+    empty_message_queue();
+
+    raw_devices[0].usUsagePage = 0x01;
+    raw_devices[0].usUsage = 0x02;
+    raw_devices[0].dwFlags = RIDEV_INPUTSINK;
+    raw_devices[0].hwndTarget = hwnd;
+    ret = RegisterRawInputDevices(raw_devices, 1, sizeof(raw_devices[0]));
+    ok(ret, "RegisterRawInputDevices failed, error %u\n", GetLastError());
+
+    SetLastError(0xdeadbeef);
+    size = sizeof(buffer);
+    count = GetRawInputBuffer(rawinput, &size, 0);
+    ok(count == ~0U, "GetRawInputBuffer returned %u\n", count);
+    ok(GetLastError() == ERROR_INVALID_PARAMETER, "got error %u\n", GetLastError());
+
+    size = 0xdeadbeef;
+    count = GetRawInputBuffer(NULL, &size, sizeof(RAWINPUTHEADER));
+    ok(count == 0, "GetRawInputBuffer returned %u\n", count);
+    ok(size == 0, "got size %u\n", size);
+
+    for (i = 0; i < 8; i++) mouse_event(MOUSEEVENTF_MOVE, 5, 0, 0, 0);
+
+    size = 0;
+    count = GetRawInputBuffer(NULL, &size, sizeof(RAWINPUTHEADER));
+    ok(count == 0, "GetRawInputBuffer returned %u\n", count);
+    ok(size >= sizeof(RAWINPUTHEADER) + sizeof(RAWMOUSE), "got size %u\n", size);
+
+    size = sizeof(buffer);
+    count = GetRawInputBuffer(rawinput, &size, sizeof(RAWINPUTHEADER));
+    ok(count == 8, "GetRawInputBuffer returned %u\n", count);
+    for (i = 0; i < count; i++)
+    {
+        ok(rawinput->header.dwType == RIM_TYPEMOUSE, "%u: got type %u\n", i, rawinput->header.dwType);
+        rawinput = NEXTRAWINPUTBLOCK(rawinput);
+    }
+
+    /* the messages have been removed */
+    size = sizeof(buffer);
+    count = GetRawInputBuffer(buffer, &size, sizeof(RAWINPUTHEADER));
+    ok(count == 0, "GetRawInputBuffer returned %u\n", count);
+
+    raw_devices[0].dwFlags = RIDEV_REMOVE;
+    raw_devices[0].hwndTarget = 0;
+    ret = RegisterRawInputDevices(raw_devices, 1, sizeof(raw_devices[0]));
+    ok(ret, "RegisterRawInputDevices failed, error %u\n", GetLastError());
+
+    DestroyWindow(hwnd);
+}
+
 static void test_key_map(void)
 {
     HKL kl = GetKeyboardLayout(0);
@@ -1767,6 +1827,26 @@ static void test_get_async_key_state(void)
     ok(0 == GetAsyncKeyState(-1000000), "GetAsyncKeyState did not return 0\n");
 }
 
+static void test_get_async_key_state_repeated(void)
+{
+    SHORT state;
+    int i;
+
+    keybd_event('X', 0, 0, 0);
+    for (i = 0; i < 10; i++)
+    {
+        state = GetAsyncKeyState('X');
+        ok(state & 0x8000, "%d: key should be down, got %x\n", i, state);
+    }
+
+    keybd_event('X', 0, KEYEVENTF_KEYUP, 0);
+    for (i = 0; i < 10; i++)
+    {
+        state = GetAsyncKeyState('X');
+        ok(!(state & 0x8000), "%d: key should be up, got %x\n", i, state);
+    }
+}
+
 static void test_keyboard_layout_name(void)
 {
     BOOL ret;
@@ -2564,10 +2644,12 @@ START_TEST(input)
     test_ToUnicode();
     test_ToAscii();
     test_get_async_key_state();
+    test_get_async_key_state_repeated();
     test_keyboard_layout_name();
     test_key_names();
     test_attach_input();
     test_GetKeyState();
+    test_GetRawInputBuffer();
     test_OemKeyScan();
 
     if(pGetMouseMovePointsEx)
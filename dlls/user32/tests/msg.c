@@ -9672,6 +9672,56 @@ static void test_timers(void)
     ok(DestroyWindow(info.hWnd), "failed to destroy window\n");
 }
 
+static void test_timers_many(void)
+{
+    UINT count = winetest_interactive ? 100000 : 10000, i, set;
+    DWORD start, set_time, kill_time;
+    BOOL got_timer = FALSE;
+    HWND hwnd;
+    MSG msg;
+
+    hwnd = CreateWindowA("TestWindowClass", NULL, WS_OVERLAPPEDWINDOW,
+                         CW_USEDEFAULT, CW_USEDEFAULT, 300, 300, 0, NULL, NULL, 0);
+    ok(hwnd != 0, "failed to create window\n");
+    flush_events();
+
+    /* many long timers with different expirations, they shouldn't fire during the test */
+    start = GetTickCount();
+    for (set = 0; set < count; set++)
+    {
+        if (!SetTimer(hwnd, set + 1, 600000 + (set * 7919) % 60000, NULL))
+        {
+            skip("SetTimer failed after %u timers\n", set);
+            break;
+        }
+    }
+    set_time = GetTickCount() - start;
+
+    /* a short timer is still delivered first */
+    ok(SetTimer(hwnd, count + 1, 10, NULL) == count + 1, "SetTimer failed\n");
+    start = GetTickCount();
+    while (!got_timer && GetTickCount() - start < 1000)
+    {
+        if (!PeekMessageA(&msg, hwnd, WM_TIMER, WM_TIMER, PM_REMOVE))
+        {
+            MsgWaitForMultipleObjects(0, NULL, FALSE, 100, QS_TIMER);
+            continue;
+        }
+        ok(msg.wParam == count + 1, "got timer %lu\n", msg.wParam);
+        got_timer = TRUE;
+    }
+    ok(got_timer, "didn't get the short timer\n");
+    ok(KillTimer(hwnd, count + 1), "KillTimer failed\n");
+
+    start = GetTickCount();
+    for (i = 0; i < set; i++) ok(KillTimer(hwnd, i + 1), "KillTimer %u failed\n", i + 1);
+    kill_time = GetTickCount() - start;
+
+    if (winetest_interactive)
+        trace("%u timers: set in %u ms, killed in %u ms\n", set, set_time, kill_time);
+    ok(DestroyWindow(hwnd), "failed to destroy window\n");
+}
+
 static void test_timers_no_wnd(void)
 {
     static UINT_PTR ids[0xffff];
@@ -11844,6 +11894,55 @@ static void test_PeekMessage3(void)
     flush_events();
 }
 
+static DWORD WINAPI post_message_thread(void *arg)
+{
+    DWORD tid = (DWORD_PTR)arg;
+    BOOL ret;
+
+    ret = PostThreadMessageA(tid, WM_USER + 1, 0, 0);
+    ok(ret, "PostThreadMessage failed, error %u\n", GetLastError());
+    return 0;
+}
+
+/* repeated polls of an idle queue must still notice messages posted from other threads */
+static void test_PeekMessage_idle(void)
+{
+    HANDLE thread;
+    unsigned int i;
+    BOOL ret;
+    MSG msg;
+
+    flush_events();
+
+    for (i = 0; i < 100; i++)
+    {
+        ret = PeekMessageA(&msg, NULL, 0, 0, PM_NOREMOVE);
+        ok(!ret, "%u: got message %04x\n", i, msg.message);
+    }
+
+    thread = CreateThread(NULL, 0, post_message_thread, (void *)(DWORD_PTR)GetCurrentThreadId(), 0, NULL);
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+
+    ret = PeekMessageA(&msg, NULL, WM_USER, WM_USER, PM_REMOVE);
+    ok(!ret, "got message %04x\n", msg.message);
+    ret = PeekMessageA(&msg, NULL, 0, 0, PM_NOREMOVE | PM_QS_PAINT);
+    ok(!ret, "got message %04x\n", msg.message);
+    ret = PeekMessageA(&msg, NULL, 0, 0, PM_REMOVE);
+    ok(ret && msg.message == WM_USER + 1, "got %d message %04x\n", ret, msg.message);
+
+    for (i = 0; i < 100; i++)
+    {
+        ret = PeekMessageA(&msg, NULL, 0, 0, PM_NOREMOVE);
+        ok(!ret, "%u: got message %04x\n", i, msg.message);
+    }
+
+    SetTimer(NULL, 0, 10, NULL);
+    ret = GetMessageA(&msg, NULL, 0, 0);
+    ok(ret && msg.message == WM_TIMER, "got %d message %04x\n", ret, msg.message);
+    KillTimer(NULL, msg.wParam);
+}
+
 static INT_PTR CALLBACK wm_quit_dlg_proc(HWND hwnd, UINT message, WPARAM wp, LPARAM lp)
 {
     struct recvd_message msg;
@@ -16828,6 +16927,7 @@ START_TEST(msg)
     test_PeekMessage();
     test_PeekMessage2();
     test_PeekMessage3();
+    test_PeekMessage_idle();
     test_WaitForInputIdle( test_argv[0] );
     test_scrollwindowex();
     test_messages();
@@ -16846,6 +16946,7 @@ START_TEST(msg)
     test_message_conversion();
     test_accelerators();
     test_timers();
+    test_timers_many();
     test_timers_no_wnd();
     test_timers_exceptions();
     if (hCBT_hook)
@@ -170,6 +170,7 @@ struct wm_char_mapping_data
 struct user_thread_info
 {
     DPI_AWARENESS                 dpi_awareness;          /* DPI awareness */
+    DWORD                         last_get_msg;           /* Time of the last get_message request */
     HANDLE                        server_queue;           /* Handle to server-side queue */
     DWORD                         wake_mask;              /* Current queue wake mask */
     DWORD                         changed_mask;           /* Current queue changed mask */
@@ -177,17 +178,18 @@ struct user_thread_info
     WORD                          message_count;          /* Get/PeekMessage loop counter */
     WORD                          hook_call_depth;        /* Number of recursively called hook procs */
     BOOL                          hook_unicode;           /* Is current hook unicode? */
+    UINT                          active_hooks;           /* Bitmap of active hooks */
     HHOOK                         hook;                   /* Current hook */
     struct received_message_info *receive_info;           /* Message being currently received */
     struct wm_char_mapping_data  *wmchar_data;            /* Data for WM_CHAR mappings */
     DWORD                         GetMessageTimeVal;      /* Value for GetMessageTime */
     DWORD                         GetMessagePosVal;       /* Value for GetMessagePos */
     ULONG_PTR                     GetMessageExtraInfoVal; /* Value for GetMessageExtraInfo */
-    UINT                          active_hooks;           /* Bitmap of active hooks */
     struct user_key_state_info   *key_state;              /* Cache of global key state */
     HWND                          top_window;             /* Desktop window */
     HWND                          msg_window;             /* HWND_MESSAGE parent window */
     RAWINPUT                     *rawinput;
+    const void                   *queue_shm;              /* Shared memory of the server-side queue */
 };
 
 C_ASSERT( sizeof(struct user_thread_info) <= sizeof(((TEB *)0)->Win32ClientInfo) );
@@ -201,6 +203,7 @@ struct user_key_state_info
     UINT                          time;                   /* Time of last key state refresh */
     INT                           counter;                /* Counter to invalidate the key state */
     BYTE                          state[256];             /* State for each key */
+    const void                   *desktop_shm;            /* Shared memory of the thread desktop */
 };
 
 struct hook_extra_info
@@ -214,6 +217,14 @@ static inline struct user_thread_info *get_user_thread_info(void)
     return (struct user_thread_info *)NtCurrentTeb()->Win32ClientInfo;
 }
 
+/* order the reads of data that the server updates in shared memory */
+static inline void shm_read_barrier(void)
+{
+#ifdef __GNUC__
+    __sync_synchronize();
+#endif
+}
+
 /* check if hwnd is a broadcast magic handle */
 static inline BOOL is_broadcast( HWND hwnd )
 {
@@ -245,6 +256,11 @@ extern LRESULT call_current_hook( HHOOK hhook, INT code, WPARAM wparam, LPARAM l
 extern DWORD get_input_codepage( void ) DECLSPEC_HIDDEN;
 extern BOOL map_wparam_AtoW( UINT message, WPARAM *wparam, enum wm_char_mapping mapping ) DECLSPEC_HIDDEN;
 extern NTSTATUS send_hardware_message( HWND hwnd, const INPUT *input, UINT flags ) DECLSPEC_HIDDEN;
+extern NTSTATUS send_hardware_messages( HWND hwnd, const INPUT *inputs, UINT count, UINT flags,
+                                        UINT *sent ) DECLSPEC_HIDDEN;
+struct hardware_msg_data;
+extern BOOL rawinput_from_hardware_message( RAWINPUT *rawinput,
+                                            const struct hardware_msg_data *msg_data ) DECLSPEC_HIDDEN;
 extern LRESULT MSG_SendInternalMessageTimeout( DWORD dest_pid, DWORD dest_tid,
                                                UINT msg, WPARAM wparam, LPARAM lparam,
                                                UINT flags, UINT timeout, PDWORD_PTR res_ptr ) DECLSPEC_HIDDEN;
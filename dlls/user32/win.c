@@ -353,6 +353,126 @@ static HWND *list_window_children( HDESK desktop, HWND hwnd, LPCWSTR class, DWOR
 }
 
 
+/***********************************************************************
+ *           get_window_shm
+ *
+ * Map the window information published by the server.
+ */
+static const volatile window_shm_t *get_window_shm(void)
+{
+    static const volatile window_shm_t *window_shm;
+    void *ptr;
+    HANDLE handle = 0;
+
+    if (window_shm) return window_shm;
+
+    SERVER_START_REQ( get_window_shared_memory )
+    {
+        if (!wine_server_call( req )) handle = wine_server_ptr_handle( reply->handle );
+    }
+    SERVER_END_REQ;
+
+    if (!handle) return NULL;
+    ptr = MapViewOfFile( handle, FILE_MAP_READ, 0, 0, 0 );
+    CloseHandle( handle );
+    if (!ptr) return NULL;
+    if (InterlockedCompareExchangePointer( (void **)&window_shm, ptr, NULL ))
+        UnmapViewOfFile( ptr );  /* another thread got there first */
+    return window_shm;
+}
+
+
+/***********************************************************************
+ *           get_shared_window_info
+ *
+ * Retrieve the server information of a window without a server call.
+ * Return FALSE if it's not available, the caller should then ask the server.
+ */
+static BOOL get_shared_window_info( HWND hwnd, window_shm_t *info )
+{
+    const volatile window_shm_t *shm;
+    WORD index = USER_HANDLE_TO_INDEX( hwnd );
+    unsigned int seq;
+
+    if (index >= NB_USER_HANDLES) return FALSE;
+    if (!(shm = get_window_shm())) return FALSE;
+    shm += index;
+
+    do
+    {
+        while ((seq = shm->seq) & 1) /* the server is updating the entry */;
+        shm_read_barrier();
+        memcpy( info, (const void *)shm, sizeof(*info) );
+        shm_read_barrier();
+    } while (shm->seq != seq);
+
+    if (!info->handle) return FALSE;
+    /* truncated handles match any generation, like on the server side */
+    return !HIWORD(hwnd) || HIWORD(hwnd) == 0xffff || HIWORD(hwnd) == HIWORD(info->handle);
+}
+
+
+/***********************************************************************
+ *           get_shared_window_rectangles
+ *
+ * Same as the get_window_rectangles server request, using the shared window information.
+ */
+static BOOL get_shared_window_rectangles( HWND hwnd, enum coords_relative relative,
+                                          RECT *rectWindow, RECT *rectClient )
+{
+    window_shm_t info, parent;
+    RECT win_rect, client_rect, window_rect, parent_rect;
+    user_handle_t handle;
+
+    if (!get_shared_window_info( hwnd, &info )) return FALSE;
+
+    SetRect( &win_rect, info.window_rect.left, info.window_rect.top,
+             info.window_rect.right, info.window_rect.bottom );
+    SetRect( &client_rect, info.client_rect.left, info.client_rect.top,
+             info.client_rect.right, info.client_rect.bottom );
+    window_rect = win_rect;
+
+    switch (relative)
+    {
+    case COORDS_CLIENT:
+        OffsetRect( &window_rect, -info.client_rect.left, -info.client_rect.top );
+        if (info.ex_style & WS_EX_LAYOUTRTL) mirror_rect( &client_rect, &window_rect );
+        OffsetRect( &client_rect, -info.client_rect.left, -info.client_rect.top );
+        break;
+    case COORDS_WINDOW:
+        OffsetRect( &window_rect, -info.window_rect.left, -info.window_rect.top );
+        OffsetRect( &client_rect, -info.window_rect.left, -info.window_rect.top );
+        if (info.ex_style & WS_EX_LAYOUTRTL) mirror_rect( &win_rect, &client_rect );
+        break;
+    case COORDS_PARENT:
+        if (!info.parent) break;
+        if (!get_shared_window_info( wine_server_ptr_handle( info.parent ), &parent )) return FALSE;
+        if (parent.ex_style & WS_EX_LAYOUTRTL)
+        {
+            SetRect( &parent_rect, parent.client_rect.left, parent.client_rect.top,
+                     parent.client_rect.right, parent.client_rect.bottom );
+            mirror_rect( &parent_rect, &window_rect );
+            mirror_rect( &parent_rect, &client_rect );
+        }
+        break;
+    case COORDS_SCREEN:
+        for (handle = info.parent; handle; handle = parent.parent)
+        {
+            if (!get_shared_window_info( wine_server_ptr_handle( handle ), &parent )) return FALSE;
+            if (parent.flags & WINDOW_SHM_DESKTOP) break;
+            OffsetRect( &window_rect, parent.client_rect.left, parent.client_rect.top );
+            OffsetRect( &client_rect, parent.client_rect.left, parent.client_rect.top );
+        }
+        break;
+    default:
+        return FALSE;
+    }
+    if (rectWindow) *rectWindow = window_rect;
+    if (rectClient) *rectClient = client_rect;
+    return TRUE;
+}
+
+
 /*******************************************************************
  *           list_window_parents
  *
@@ -362,6 +482,7 @@ static HWND *list_window_children( HDESK desktop, HWND hwnd, LPCWSTR class, DWOR
 static HWND *list_window_parents( HWND hwnd )
 {
     WND *win;
+    window_shm_t info;
     HWND current, *list;
     int i, pos = 0, size = 16, count;
 
@@ -391,7 +512,26 @@ static HWND *list_window_parents( HWND hwnd )
         }
     }
 
-    /* at least one parent belongs to another process, have to query the server */
+    /* at least one parent belongs to another process, try the shared information first */
+
+    while (get_shared_window_info( current, &info ))
+    {
+        list[pos] = current = wine_server_ptr_handle( info.parent );
+        if (!current)
+        {
+            if (!pos) goto empty;
+            return list;
+        }
+        if (++pos == size - 1)
+        {
+            HWND *new_list = HeapReAlloc( GetProcessHeap(), 0, list, (size+16) * sizeof(HWND) );
+            if (!new_list) goto empty;
+            list = new_list;
+            size += 16;
+        }
+    }
+
+    /* have to query the server */
 
     for (;;)
     {
@@ -928,6 +1068,8 @@ BOOL WIN_GetRectangles( HWND hwnd, enum coords_relative relative, RECT *rectWind
     }
 
 other_process:
+    if (get_shared_window_rectangles( hwnd, relative, rectWindow, rectClient )) return TRUE;
+
     SERVER_START_REQ( get_window_rectangles )
     {
         req->handle = wine_server_user_handle( hwnd );
@@ -2306,11 +2448,23 @@ static LONG_PTR WIN_GetWindowLong( HWND hwnd, INT offset, UINT size, BOOL unicod
 
     if (wndPtr == WND_OTHER_PROCESS)
     {
+        window_shm_t info;
+
         if (offset == GWLP_WNDPROC)
         {
             SetLastError( ERROR_ACCESS_DENIED );
             return 0;
         }
+        if ((offset == GWL_STYLE || offset == GWL_EXSTYLE || offset == GWLP_ID) &&
+            get_shared_window_info( hwnd, &info ))
+        {
+            switch(offset)
+            {
+            case GWL_STYLE:   return (LONG)info.style;
+            case GWL_EXSTYLE: return (LONG)info.ex_style;
+            default:          return info.id;
+            }
+        }
         SERVER_START_REQ( set_window_info )
         {
             req->handle = wine_server_user_handle( hwnd );
@@ -2907,6 +3061,7 @@ INT WINAPI GetWindowTextLengthW( HWND hwnd )
 BOOL WINAPI IsWindow( HWND hwnd )
 {
     WND *ptr;
+    window_shm_t info;
     BOOL ret;
 
     if (!(ptr = WIN_GetPtr( hwnd ))) return FALSE;
@@ -2919,6 +3074,8 @@ BOOL WINAPI IsWindow( HWND hwnd )
     }
 
     /* check other processes */
+    if (get_shared_window_info( hwnd, &info )) return TRUE;
+
     SERVER_START_REQ( get_window_info )
     {
         req->handle = wine_server_user_handle( hwnd );
@@ -2983,7 +3140,16 @@ HWND WINAPI GetParent( HWND hwnd )
     if (wndPtr == WND_DESKTOP) return 0;
     if (wndPtr == WND_OTHER_PROCESS)
     {
-        LONG style = GetWindowLongW( hwnd, GWL_STYLE );
+        window_shm_t info;
+        LONG style;
+
+        if (get_shared_window_info( hwnd, &info ))
+        {
+            if (info.style & WS_POPUP) retvalue = wine_server_ptr_handle( info.owner );
+            else if (info.style & WS_CHILD) retvalue = wine_server_ptr_handle( info.parent );
+            return retvalue;
+        }
+        style = GetWindowLongW( hwnd, GWL_STYLE );
         if (style & (WS_POPUP | WS_CHILD))
         {
             SERVER_START_REQ( get_window_tree )
@@ -3014,6 +3180,7 @@ HWND WINAPI GetParent( HWND hwnd )
 HWND WINAPI GetAncestor( HWND hwnd, UINT type )
 {
     WND *win;
+    window_shm_t info;
     HWND *list, ret = 0;
 
     switch(type)
@@ -3030,6 +3197,10 @@ HWND WINAPI GetAncestor( HWND hwnd, UINT type )
             ret = win->parent;
             WIN_ReleasePtr( win );
         }
+        else if (get_shared_window_info( hwnd, &info ))
+        {
+            ret = wine_server_ptr_handle( info.parent );
+        }
         else /* need to query the server */
         {
             SERVER_START_REQ( get_window_tree )
@@ -3256,6 +3427,7 @@ HWND WINAPI GetTopWindow( HWND hwnd )
  */
 HWND WINAPI GetWindow( HWND hwnd, UINT rel )
 {
+    window_shm_t info;
     HWND retval = 0;
 
     if (rel == GW_OWNER)  /* this one may be available locally */
@@ -3273,6 +3445,7 @@ HWND WINAPI GetWindow( HWND hwnd, UINT rel )
             WIN_ReleasePtr( wndPtr );
             return retval;
         }
+        if (get_shared_window_info( hwnd, &info )) return wine_server_ptr_handle( info.owner );
         /* else fall through to server call */
     }
 
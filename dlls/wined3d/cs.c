@@ -473,7 +473,7 @@ void wined3d_cs_emit_present(struct wined3d_cs *cs, struct wined3d_swapchain *sw
         unsigned int swap_interval, DWORD flags)
 {
     struct wined3d_cs_present *op;
-    unsigned int i;
+    unsigned int i, spin_count = 0;
     LONG pending;
 
     op = cs->ops->require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
@@ -499,7 +499,7 @@ void wined3d_cs_emit_present(struct wined3d_cs *cs, struct wined3d_swapchain *sw
      * ahead of the worker thread. */
     while (pending >= swapchain->max_frame_latency)
     {
-        wined3d_pause();
+        wined3d_cs_wait_progress(cs, &spin_count);
         pending = InterlockedCompareExchange(&cs->pending_presents, 0, 0);
     }
 }
@@ -2537,6 +2537,42 @@ static void wined3d_cs_queue_submit(struct wined3d_cs_queue *queue, struct wined
         SetEvent(cs->event);
 }
 
+/* Wait for the CS thread to make progress, i.e. to execute at least one more
+ * packet. The caller checks its condition between calls: we spin for a while,
+ * then register as a waiter and return once more so that the condition is
+ * checked again after registering, and only then sleep. */
+void wined3d_cs_wait_progress(struct wined3d_cs *cs, unsigned int *spin_count)
+{
+    if (*spin_count < WINED3D_CS_SPIN_COUNT)
+    {
+        ++*spin_count;
+        wined3d_pause();
+        return;
+    }
+
+    if (*spin_count == WINED3D_CS_SPIN_COUNT)
+    {
+        ++*spin_count;
+        InterlockedIncrement(&cs->waiting_for_progress);
+        return;
+    }
+
+    WaitForSingleObject(cs->progress_semaphore, INFINITE);
+    *spin_count = WINED3D_CS_SPIN_COUNT;
+}
+
+static void wined3d_cs_signal_progress(struct wined3d_cs *cs)
+{
+    LONG count;
+
+    /* Stale wake-ups, from waiters that found their condition satisfied
+     * after registering, are harmless: they just recheck their condition. */
+    if (!*(volatile LONG *)&cs->waiting_for_progress)
+        return;
+    if ((count = InterlockedExchange(&cs->waiting_for_progress, 0)))
+        ReleaseSemaphore(cs->progress_semaphore, count, NULL);
+}
+
 static void wined3d_cs_mt_submit(struct wined3d_cs *cs, enum wined3d_cs_queue_id queue_id)
 {
     if (cs->thread_id == GetCurrentThreadId())
@@ -2550,6 +2586,7 @@ static void *wined3d_cs_queue_require_space(struct wined3d_cs_queue *queue, size
     size_t queue_size = ARRAY_SIZE(queue->data);
     size_t header_size, packet_size, remaining;
     struct wined3d_cs_packet *packet;
+    unsigned int spin_count = 0;
 
     header_size = FIELD_OFFSET(struct wined3d_cs_packet, data[0]);
     size = (size + header_size - 1) & ~(header_size - 1);
@@ -2599,6 +2636,7 @@ static void *wined3d_cs_queue_require_space(struct wined3d_cs_queue *queue, size
 
         TRACE("Waiting for free space. Head %u, tail %u, packet size %lu.\n",
                 head, tail, (unsigned long)packet_size);
+        wined3d_cs_wait_progress(cs, &spin_count);
     }
 
     packet = (struct wined3d_cs_packet *)&queue->data[queue->head];
@@ -2616,11 +2654,13 @@ static void *wined3d_cs_mt_require_space(struct wined3d_cs *cs, size_t size, enu
 
 static void wined3d_cs_mt_finish(struct wined3d_cs *cs, enum wined3d_cs_queue_id queue_id)
 {
+    unsigned int spin_count = 0;
+
     if (cs->thread_id == GetCurrentThreadId())
         return wined3d_cs_st_finish(cs, queue_id);
 
     while (cs->queue[queue_id].head != *(volatile LONG *)&cs->queue[queue_id].tail)
-        wined3d_pause();
+        wined3d_cs_wait_progress(cs, &spin_count);
 }
 
 static const struct wined3d_cs_ops wined3d_cs_mt_ops =
@@ -2646,7 +2686,7 @@ static void poll_queries(struct wined3d_cs *cs)
     }
 }
 
-static void wined3d_cs_wait_event(struct wined3d_cs *cs)
+static void wined3d_cs_wait_event(struct wined3d_cs *cs, DWORD timeout)
 {
     InterlockedExchange(&cs->waiting_for_event, TRUE);
 
@@ -2662,7 +2702,8 @@ static void wined3d_cs_wait_event(struct wined3d_cs *cs)
             && InterlockedCompareExchange(&cs->waiting_for_event, FALSE, TRUE))
         return;
 
-    WaitForSingleObject(cs->event, INFINITE);
+    if (WaitForSingleObject(cs->event, timeout) == WAIT_TIMEOUT)
+        InterlockedExchange(&cs->waiting_for_event, FALSE);
 }
 
 static DWORD WINAPI wined3d_cs_run(void *ctx)
@@ -2698,8 +2739,20 @@ static DWORD WINAPI wined3d_cs_run(void *ctx)
             queue = &cs->queue[WINED3D_CS_QUEUE_DEFAULT];
             if (wined3d_cs_queue_is_empty(cs, queue))
             {
-                if (++spin_count >= WINED3D_CS_SPIN_COUNT && list_empty(&cs->query_poll_list))
-                    wined3d_cs_wait_event(cs);
+                if (++spin_count < WINED3D_CS_SPIN_COUNT)
+                {
+                    wined3d_pause();
+                }
+                else if (list_empty(&cs->query_poll_list))
+                {
+                    wined3d_cs_wait_event(cs, INFINITE);
+                }
+                else
+                {
+                    /* Keep polling the queries, just not continuously. */
+                    wined3d_cs_wait_event(cs, WINED3D_CS_QUERY_POLL_TIMEOUT);
+                    poll = WINED3D_CS_QUERY_POLL_INTERVAL - 1;
+                }
                 continue;
             }
         }
@@ -2724,6 +2777,7 @@ static DWORD WINAPI wined3d_cs_run(void *ctx)
         tail += FIELD_OFFSET(struct wined3d_cs_packet, data[packet->size]);
         tail &= (WINED3D_CS_QUEUE_SIZE - 1);
         InterlockedExchange(&queue->tail, tail);
+        wined3d_cs_signal_progress(cs);
     }
 
     cs->queue[WINED3D_CS_QUEUE_MAP].tail = cs->queue[WINED3D_CS_QUEUE_MAP].head;
@@ -2762,10 +2816,19 @@ struct wined3d_cs *wined3d_cs_create(struct wined3d_device *device)
             goto fail;
         }
 
+        if (!(cs->progress_semaphore = CreateSemaphoreW(NULL, 0, MAXLONG, NULL)))
+        {
+            ERR("Failed to create command stream semaphore.\n");
+            CloseHandle(cs->event);
+            heap_free(cs->data);
+            goto fail;
+        }
+
         if (!(GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS,
                 (const WCHAR *)wined3d_cs_run, &cs->wined3d_module)))
         {
             ERR("Failed to get wined3d module handle.\n");
+            CloseHandle(cs->progress_semaphore);
             CloseHandle(cs->event);
             heap_free(cs->data);
             goto fail;
@@ -2775,6 +2838,7 @@ struct wined3d_cs *wined3d_cs_create(struct wined3d_device *device)
         {
             ERR("Failed to create wined3d command stream thread.\n");
             FreeLibrary(cs->wined3d_module);
+            CloseHandle(cs->progress_semaphore);
             CloseHandle(cs->event);
             heap_free(cs->data);
             goto fail;
@@ -2797,6 +2861,8 @@ void wined3d_cs_destroy(struct wined3d_cs *cs)
         CloseHandle(cs->thread);
         if (!CloseHandle(cs->event))
             ERR("Closing event failed.\n");
+        if (!CloseHandle(cs->progress_semaphore))
+            ERR("Closing semaphore failed.\n");
     }
 
     state_cleanup(&cs->state);
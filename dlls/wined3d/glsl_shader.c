@@ -37,8 +37,16 @@
 #ifdef HAVE_FLOAT_H
 # include <float.h>
 #endif
+#include <fcntl.h>
+#ifdef HAVE_SYS_STAT_H
+# include <sys/stat.h>
+#endif
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>
+#endif
 
 #include "wined3d_private.h"
+#include "wine/library.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(d3d_shader);
 WINE_DECLARE_DEBUG_CHANNEL(d3d);
@@ -131,6 +139,8 @@ struct shader_glsl_priv
     struct wine_rb_tree ffp_fragment_shaders;
     BOOL ffp_proj_control;
     BOOL legacy_lighting;
+    UINT64 program_cache_seed;
+    BOOL program_cache_dir_created;
 };
 
 struct glsl_vs_program
@@ -10204,6 +10214,185 @@ static void set_glsl_compute_shader_program(const struct wined3d_context *contex
     ctx_data->glsl_program = entry;
 }
 
+/* Linked programs are cached on disk as program binaries, keyed by a hash of
+ * the GL implementation and of the GLSL sources of the attached shaders. */
+#define GLSL_PROGRAM_CACHE_MAGIC    0x42534c47u /* "GLSB" */
+#define GLSL_HASH_INIT              0xcbf29ce484222325ull
+
+struct glsl_program_cache_header
+{
+    DWORD magic;
+    DWORD key[2];
+    DWORD format;
+    DWORD size;
+};
+
+static UINT64 glsl_hash(UINT64 hash, const void *data, size_t size)
+{
+    const BYTE *ptr = data;
+
+    while (size--)
+        hash = (hash ^ *ptr++) * 0x100000001b3ull;
+    return hash;
+}
+
+static BOOL shader_glsl_use_program_cache(const struct wined3d_gl_info *gl_info,
+        const struct wined3d_shader *gshader)
+{
+    if (!wined3d_settings.shader_cache || !gl_info->supported[ARB_GET_PROGRAM_BINARY])
+        return FALSE;
+    /* Transform feedback varyings are program state that isn't part of the
+     * shader sources. */
+    return !gshader || !gshader->u.gs.so_desc.element_count;
+}
+
+/* Context activation is done by the caller. */
+static UINT64 shader_glsl_get_program_cache_key(const struct wined3d_gl_info *gl_info,
+        struct shader_glsl_priv *priv, GLuint program_id, WORD attribs_map)
+{
+    static const GLenum driver_strings[] = {GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION_ARB};
+    UINT64 sources = 0;
+    GLuint shaders[8];
+    GLint count, length, i;
+    const char *str;
+    char *source;
+
+    if (!priv->program_cache_seed)
+    {
+        UINT64 hash = GLSL_HASH_INIT;
+
+        for (i = 0; i < ARRAY_SIZE(driver_strings); ++i)
+        {
+            if ((str = (const char *)gl_info->gl_ops.gl.p_glGetString(driver_strings[i])))
+                hash = glsl_hash(hash, str, strlen(str) + 1);
+        }
+        priv->program_cache_seed = hash;
+    }
+
+    GL_EXTCALL(glGetAttachedShaders(program_id, ARRAY_SIZE(shaders), &count, shaders));
+    for (i = 0; i < count; ++i)
+    {
+        GL_EXTCALL(glGetShaderiv(shaders[i], GL_SHADER_SOURCE_LENGTH, &length));
+        if (length <= 0 || !(source = heap_alloc(length)))
+            return 0;
+        GL_EXTCALL(glGetShaderSource(shaders[i], length, NULL, source));
+        /* The order of the attached shaders isn't defined. */
+        sources += glsl_hash(GLSL_HASH_INIT, source, length);
+        heap_free(source);
+    }
+    checkGLcall("get program cache key");
+
+    return glsl_hash(glsl_hash(priv->program_cache_seed, &sources, sizeof(sources)),
+            &attribs_map, sizeof(attribs_map));
+}
+
+/* The cache directory is created the first time a program is saved, priv is NULL otherwise. */
+static char *shader_glsl_get_program_cache_path(struct shader_glsl_priv *priv, UINT64 key)
+{
+    static const char dir_name[] = "/shadercache";
+    const char *config_dir = wine_get_config_dir();
+    size_t len;
+    char *path;
+
+    if (!config_dir)
+        return NULL;
+    len = strlen(config_dir) + strlen(dir_name);
+    if (!(path = heap_alloc(len + 32)))
+        return NULL;
+    sprintf(path, "%s%s", config_dir, dir_name);
+    if (priv && !priv->program_cache_dir_created)
+    {
+        mkdir(path, 0777);
+        priv->program_cache_dir_created = TRUE;
+    }
+    sprintf(path + len, "/%08x%08x", (DWORD)(key >> 32), (DWORD)key);
+    return path;
+}
+
+/* Context activation is done by the caller. */
+static BOOL shader_glsl_load_program_binary(const struct wined3d_gl_info *gl_info, GLuint program_id, UINT64 key)
+{
+    struct glsl_program_cache_header header;
+    GLint status = GL_FALSE;
+    struct stat st;
+    void *binary;
+    char *path;
+    int fd;
+
+    if (!(path = shader_glsl_get_program_cache_path(NULL, key)))
+        return FALSE;
+    fd = open(path, O_RDONLY);
+    heap_free(path);
+    if (fd == -1)
+        return FALSE;
+
+    if (read(fd, &header, sizeof(header)) == sizeof(header) && header.magic == GLSL_PROGRAM_CACHE_MAGIC
+            && header.key[0] == (DWORD)key && header.key[1] == (DWORD)(key >> 32)
+            && !fstat(fd, &st) && st.st_size == sizeof(header) + header.size
+            && (binary = heap_alloc(header.size)))
+    {
+        if (read(fd, binary, header.size) == header.size)
+        {
+            GL_EXTCALL(glProgramBinary(program_id, header.format, binary, header.size));
+            GL_EXTCALL(glGetProgramiv(program_id, GL_LINK_STATUS, &status));
+            checkGLcall("glProgramBinary");
+            if (!status)
+                WARN("Failed to load cached program binary %s.\n", wine_dbgstr_longlong(key));
+        }
+        heap_free(binary);
+    }
+    close(fd);
+
+    return status;
+}
+
+/* Context activation is done by the caller. */
+static void shader_glsl_save_program_binary(const struct wined3d_gl_info *gl_info,
+        struct shader_glsl_priv *priv, GLuint program_id, UINT64 key)
+{
+    struct glsl_program_cache_header header;
+    char *path, *tmp_path = NULL;
+    GLint status, length;
+    GLenum format;
+    void *binary;
+    BOOL ret;
+    int fd;
+
+    GL_EXTCALL(glGetProgramiv(program_id, GL_LINK_STATUS, &status));
+    if (!status)
+        return;
+    GL_EXTCALL(glGetProgramiv(program_id, GL_PROGRAM_BINARY_LENGTH, &length));
+    if (length <= 0 || !(binary = heap_alloc(length)))
+        return;
+    GL_EXTCALL(glGetProgramBinary(program_id, length, &length, &format, binary));
+    checkGLcall("glGetProgramBinary");
+
+    header.magic = GLSL_PROGRAM_CACHE_MAGIC;
+    header.key[0] = key;
+    header.key[1] = key >> 32;
+    header.format = format;
+    header.size = length;
+
+    /* Write to a temporary file first, other processes may be loading the same program. */
+    if ((path = shader_glsl_get_program_cache_path(priv, key)) && (tmp_path = heap_alloc(strlen(path) + 10)))
+    {
+        sprintf(tmp_path, "%s.%04x", path, GetCurrentThreadId());
+        if ((fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0666)) != -1)
+        {
+            ret = write(fd, &header, sizeof(header)) == sizeof(header) && write(fd, binary, length) == length;
+            close(fd);
+            if (!ret || rename(tmp_path, path))
+            {
+                WARN("Failed to save program binary %s.\n", debugstr_a(path));
+                unlink(tmp_path);
+            }
+        }
+    }
+    heap_free(tmp_path);
+    heap_free(path);
+    heap_free(binary);
+}
+
 /* Context activation is done by the caller. */
 static void set_glsl_shader_program(const struct wined3d_context *context, const struct wined3d_state *state,
         struct shader_glsl_priv *priv, struct glsl_context_data *ctx_data)
@@ -10226,8 +10415,9 @@ static void set_glsl_shader_program(const struct wined3d_context *context, const
     GLuint gs_id = 0;
     GLuint ps_id = 0;
     struct list *ps_list, *vs_list;
-    WORD attribs_map;
+    WORD attribs_map, program_attribs;
     struct wined3d_string_buffer *tmp_name;
+    UINT64 cache_key = 0;
 
     if (!(context->shader_update_mask & (1u << WINED3D_SHADER_TYPE_VERTEX)) && ctx_data->glsl_program)
     {
@@ -10390,6 +10580,7 @@ static void set_glsl_shader_program(const struct wined3d_context *context, const
     {
         attribs_map = (1u << WINED3D_FFP_ATTRIBS_COUNT) - 1;
     }
+    program_attribs = attribs_map;
 
     if (!shader_glsl_use_explicit_attrib_location(gl_info))
     {
@@ -10467,10 +10658,24 @@ static void set_glsl_shader_program(const struct wined3d_context *context, const
         list_add_head(ps_list, &entry->ps.shader_entry);
     }
 
-    /* Link the program */
-    TRACE("Linking GLSL shader program %u.\n", program_id);
-    GL_EXTCALL(glLinkProgram(program_id));
-    shader_glsl_validate_link(gl_info, program_id);
+    if (shader_glsl_use_program_cache(gl_info, gshader))
+        cache_key = shader_glsl_get_program_cache_key(gl_info, priv, program_id, program_attribs);
+
+    if (cache_key && shader_glsl_load_program_binary(gl_info, program_id, cache_key))
+    {
+        TRACE("Loaded GLSL shader program %u from the cache.\n", program_id);
+    }
+    else
+    {
+        /* Link the program */
+        TRACE("Linking GLSL shader program %u.\n", program_id);
+        if (cache_key)
+            GL_EXTCALL(glProgramParameteri(program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+        GL_EXTCALL(glLinkProgram(program_id));
+        shader_glsl_validate_link(gl_info, program_id);
+        if (cache_key)
+            shader_glsl_save_program_binary(gl_info, priv, program_id, cache_key);
+    }
 
     shader_glsl_init_vs_uniform_locations(gl_info, priv, program_id, &entry->vs,
             vshader ? vshader->limits->constant_float : 0);
@@ -91,6 +91,7 @@ struct wined3d_settings wined3d_settings =
     ~0U,            /* No PS shader model limit by default. */
     ~0u,            /* No CS shader model limit by default. */
     FALSE,          /* 3D support enabled by default. */
+    FALSE,          /* Don't cache linked GLSL programs on disk by default. */
 };
 
 struct wined3d * CDECL wined3d_create(DWORD flags)
@@ -307,6 +308,12 @@ static BOOL wined3d_dll_init(HINSTANCE hInstDLL)
             TRACE("Limiting PS shader model to %u.\n", wined3d_settings.max_sm_ps);
         if (!get_config_key_dword(hkey, appkey, "MaxShaderModelCS", &wined3d_settings.max_sm_cs))
             TRACE("Limiting CS shader model to %u.\n", wined3d_settings.max_sm_cs);
+        if (!get_config_key(hkey, appkey, "ShaderCache", buffer, size)
+                && !strcmp(buffer, "enabled"))
+        {
+            TRACE("Enabling the shader cache.\n");
+            wined3d_settings.shader_cache = TRUE;
+        }
         if (!get_config_key(hkey, appkey, "DirectDrawRenderer", buffer, size)
                 && !strcmp(buffer, "gdi"))
         {
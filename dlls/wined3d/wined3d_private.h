@@ -402,6 +402,7 @@ struct wined3d_settings
     unsigned int max_sm_ps;
     unsigned int max_sm_cs;
     BOOL no_3d;
+    BOOL shader_cache;
 };
 
 extern struct wined3d_settings wined3d_settings DECLSPEC_HIDDEN;
@@ -3504,7 +3505,8 @@ enum wined3d_push_constants
 
 #define WINED3D_CS_QUERY_POLL_INTERVAL  10u
 #define WINED3D_CS_QUEUE_SIZE           0x100000u
-#define WINED3D_CS_SPIN_COUNT           10000000u
+#define WINED3D_CS_SPIN_COUNT           10000u
+#define WINED3D_CS_QUERY_POLL_TIMEOUT   1u
 
 struct wined3d_cs_queue
 {
@@ -3540,9 +3542,13 @@ struct wined3d_cs
     HANDLE event;
     BOOL waiting_for_event;
     LONG pending_presents;
+
+    HANDLE progress_semaphore;
+    LONG waiting_for_progress;
 };
 
 struct wined3d_cs *wined3d_cs_create(struct wined3d_device *device) DECLSPEC_HIDDEN;
+void wined3d_cs_wait_progress(struct wined3d_cs *cs, unsigned int *spin_count) DECLSPEC_HIDDEN;
 void wined3d_cs_destroy(struct wined3d_cs *cs) DECLSPEC_HIDDEN;
 void wined3d_cs_destroy_object(struct wined3d_cs *cs,
         void (*callback)(void *object), void *object) DECLSPEC_HIDDEN;
@@ -3643,13 +3649,14 @@ static inline void wined3d_cs_push_constants(struct wined3d_cs *cs, enum wined3d
 
 static inline void wined3d_resource_wait_idle(struct wined3d_resource *resource)
 {
-    const struct wined3d_cs *cs = resource->device->cs;
+    struct wined3d_cs *cs = resource->device->cs;
+    unsigned int spin_count = 0;
 
     if (!cs->thread || cs->thread_id == GetCurrentThreadId())
         return;
 
     while (InterlockedCompareExchange(&resource->access_count, 0, 0))
-        wined3d_pause();
+        wined3d_cs_wait_progress(cs, &spin_count);
 }
 
 /* TODO: Add tests and support for FLOAT16_4 POSITIONT, D3DCOLOR position, other
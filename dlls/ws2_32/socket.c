@@ -128,6 +128,15 @@
 #ifdef HAVE_SYS_POLL_H
 # include <sys/poll.h>
 #endif
+#ifdef HAVE_SYS_EPOLL_H
+# include <sys/epoll.h>
+#endif
+#ifdef HAVE_SYS_SENDFILE_H
+# include <sys/sendfile.h>
+#endif
+#ifdef HAVE_SYS_STAT_H
+# include <sys/stat.h>
+#endif
 #ifdef HAVE_SYS_TIME_H
 # include <sys/time.h>
 #endif
@@ -152,12 +161,15 @@
 #include "mstcpip.h"
 #include "af_irda.h"
 #include "winnt.h"
+#include "winreg.h"
 #define USE_WC_PREFIX   /* For CMSG_DATA */
 #include "iphlpapi.h"
 #include "wine/server.h"
 #include "wine/debug.h"
 #include "wine/exception.h"
 #include "wine/unicode.h"
+#include "wine/list.h"
+#include "wine/rbtree.h"
 
 #if defined(linux) && !defined(IP_UNICAST_IF)
 #define IP_UNICAST_IF 50
@@ -243,6 +255,9 @@ static struct interface_filter generic_interface_filter = {
 
 extern ssize_t CDECL __wine_locked_recvmsg( int fd, struct msghdr *hdr, int flags );
 
+typedef BOOL (CDECL *wine_cancel_io_callback)( HANDLE handle, IO_STATUS_BLOCK *iosb, BOOL only_thread );
+extern void CDECL __wine_set_cancel_io_callback( wine_cancel_io_callback callback );
+
 /*
  * The actual definition of WSASendTo, wrapped in a different function name
  * so that internal calls from ws2_32 itself will not trigger programs like
@@ -265,6 +280,12 @@ static int WS2_recv_base( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
                           LPWSAOVERLAPPED_COMPLETION_ROUTINE lpCompletionRoutine,
                           LPWSABUF lpControlBuffer );
 
+static BOOL CDECL socket_cancel_io( HANDLE handle, IO_STATUS_BLOCK *iosb, BOOL only_thread );
+static BOOL reactor_cancel_io( HANDLE handle, IO_STATUS_BLOCK *iosb, BOOL only_thread );
+struct poll_cache;
+static void poll_cache_invalidate(void);
+static void poll_cache_free( struct poll_cache *cache );
+
 /* critical section to protect some non-reentrant net function */
 static CRITICAL_SECTION csWSgetXXXbyYYY;
 static CRITICAL_SECTION_DEBUG critsect_debug =
@@ -534,6 +555,8 @@ struct ws2_transmitfile_async
     TRANSMIT_FILE_BUFFERS buffers;
     DWORD                 flags;
     LARGE_INTEGER         offset;
+    BOOL                  use_sendfile;  /* send the file data directly with sendfile() */
+    BOOL                  corked;        /* TCP_CORK is set on the socket */
     struct ws2_async      write;
 };
 
@@ -616,6 +639,7 @@ struct per_thread_data
     struct WS_protoent *pe_buffer;
     struct pollfd *fd_cache;
     unsigned int fd_count;
+    struct poll_cache *poll_cache;
     int he_len;
     int se_len;
     int pe_len;
@@ -1304,6 +1328,7 @@ static void free_per_thread_data(void)
     HeapFree( GetProcessHeap(), 0, ptb->se_buffer );
     HeapFree( GetProcessHeap(), 0, ptb->pe_buffer );
     HeapFree( GetProcessHeap(), 0, ptb->fd_cache );
+    poll_cache_free( ptb->poll_cache );
 
     HeapFree( GetProcessHeap(), 0, ptb );
     NtCurrentTeb()->WinSockData = NULL;
@@ -1317,8 +1342,10 @@ BOOL WINAPI DllMain(HINSTANCE hInstDLL, DWORD fdwReason, LPVOID fImpLoad)
     TRACE("%p 0x%x %p\n", hInstDLL, fdwReason, fImpLoad);
     switch (fdwReason) {
     case DLL_PROCESS_ATTACH:
+        __wine_set_cancel_io_callback( socket_cancel_io );
         break;
     case DLL_PROCESS_DETACH:
+        __wine_set_cancel_io_callback( NULL );
         if (fImpLoad) break;
         free_per_thread_data();
         DeleteCriticalSection(&csWSgetXXXbyYYY);
@@ -2327,8 +2354,9 @@ static void WINAPI ws2_async_apc( void *arg, IO_STATUS_BLOCK *iosb, ULONG reserv
  *              WS2_recv                (INTERNAL)
  *
  * Workhorse for both synchronous and asynchronous recv() operations.
+ * Sets *truncated if the datagram didn't fit in the buffers.
  */
-static int WS2_recv( int fd, struct ws2_async *wsa, int flags )
+static int WS2_recv( int fd, struct ws2_async *wsa, int flags, BOOL *truncated )
 {
 #ifndef HAVE_STRUCT_MSGHDR_MSG_ACCRIGHTS
     char pktbuf[512];
@@ -2337,6 +2365,7 @@ static int WS2_recv( int fd, struct ws2_async *wsa, int flags )
     union generic_unix_sockaddr unix_sockaddr;
     int n;
 
+    *truncated = FALSE;
     hdr.msg_name = NULL;
 
     if (wsa->addr)
@@ -2378,6 +2407,7 @@ static int WS2_recv( int fd, struct ws2_async *wsa, int flags )
         errno = EMSGSIZE;
         return -1;
     }
+    if (hdr.msg_flags & MSG_TRUNC) *truncated = TRUE;
 #endif
 
     /* if this socket is connected and lpFrom is not NULL, Linux doesn't give us
@@ -2405,6 +2435,7 @@ static NTSTATUS WS2_async_recv( void *user, IO_STATUS_BLOCK *iosb, NTSTATUS stat
 {
     struct ws2_async *wsa = user;
     int result = 0, fd;
+    BOOL truncated;
 
     switch (status)
     {
@@ -2412,11 +2443,11 @@ static NTSTATUS WS2_async_recv( void *user, IO_STATUS_BLOCK *iosb, NTSTATUS stat
         if ((status = wine_server_handle_to_fd( wsa->hSocket, FILE_READ_DATA, &fd, NULL ) ))
             break;
 
-        result = WS2_recv( fd, wsa, convert_flags(wsa->flags) );
+        result = WS2_recv( fd, wsa, convert_flags(wsa->flags), &truncated );
         wine_server_release_fd( wsa->hSocket, fd );
         if (result >= 0)
         {
-            status = STATUS_SUCCESS;
+            status = truncated ? STATUS_BUFFER_OVERFLOW : STATUS_SUCCESS;
             _enable_event( wsa->hSocket, FD_READ, 0, 0 );
         }
         else
@@ -2951,6 +2982,16 @@ static NTSTATUS WS2_transmitfile_getbuffer( int fd, struct ws2_transmitfile_asyn
         IO_STATUS_BLOCK iosb;
         NTSTATUS status;
 
+#ifdef HAVE_SYS_SENDFILE_H
+        if (wsa->use_sendfile)
+        {
+            /* the data is sent without going through the buffer, see WS2_transmitfile_sendfile */
+            wsa->write.first_iovec = 0;
+            wsa->write.n_iovecs    = 0;
+            return STATUS_PENDING;
+        }
+#endif
+
         iosb.Information = 0;
         /* when the size of the transfer is limited ensure that we don't go past that limit */
         if (wsa->file_bytes != 0)
@@ -2994,6 +3035,78 @@ static NTSTATUS WS2_transmitfile_getbuffer( int fd, struct ws2_transmitfile_asyn
     return STATUS_SUCCESS;
 }
 
+/***********************************************************************
+ *     WS2_transmitfile_cork            (INTERNAL)
+ *
+ * Hold back partial frames while the header, file and footer are sent,
+ * so that they are coalesced into full packets.
+ */
+static void WS2_transmitfile_cork( int fd, struct ws2_transmitfile_async *wsa, BOOL cork )
+{
+#ifdef TCP_CORK
+    int value = cork;
+
+    if (wsa->corked == cork) return;
+    if (!setsockopt( fd, IPPROTO_TCP, TCP_CORK, &value, sizeof(value) )) wsa->corked = cork;
+#endif
+}
+
+#ifdef HAVE_SYS_SENDFILE_H
+/***********************************************************************
+ *     WS2_transmitfile_sendfile        (INTERNAL)
+ *
+ * Send the next part of the file directly from the page cache.
+ */
+static NTSTATUS WS2_transmitfile_sendfile( int fd, struct ws2_transmitfile_async *wsa, ULONG *sent )
+{
+    size_t count = wsa->file_bytes ? wsa->file_bytes - wsa->file_read : 0x7ffff000;
+    NTSTATUS status;
+    off_t offset;
+    ssize_t n;
+    int file_fd;
+
+    *sent = 0;
+    if ((status = wine_server_handle_to_fd( wsa->file, FILE_READ_DATA, &file_fd, NULL )))
+        return status;
+
+    do
+    {
+        if (wsa->offset.QuadPart != FILE_USE_FILE_POINTER_POSITION)
+        {
+            offset = wsa->offset.QuadPart;
+            n = sendfile( fd, file_fd, &offset, count );
+        }
+        else
+            n = sendfile( fd, file_fd, NULL, count );
+    }
+    while (n == -1 && errno == EINTR);
+    wine_server_release_fd( wsa->file, file_fd );
+
+    if (n == -1)
+    {
+        if (errno == EAGAIN) return STATUS_PENDING;
+        if (errno != EINVAL && errno != ENOSYS) return wsaErrStatus();
+        /* the file doesn't support sendfile, read it into the buffer instead */
+        TRACE( "sendfile not supported, falling back to buffered reads\n" );
+        wsa->use_sendfile = FALSE;
+        return STATUS_PENDING;
+    }
+
+    if (!n)  /* end of file, continue on to the footer */
+    {
+        wsa->file = NULL;
+        return STATUS_PENDING;
+    }
+    if (wsa->offset.QuadPart != FILE_USE_FILE_POINTER_POSITION)
+        wsa->offset.QuadPart += n;
+    wsa->file_read += n;
+    if (wsa->file_bytes != 0 && wsa->file_read >= wsa->file_bytes)
+        wsa->file = NULL;
+    *sent = n;
+    return STATUS_PENDING;
+}
+#endif
+
 /***********************************************************************
  *     WS2_transmitfile_base            (INTERNAL)
  *
@@ -3007,17 +3120,25 @@ static NTSTATUS WS2_transmitfile_base( int fd, struct ws2_transmitfile_async *ws
     if (status == STATUS_PENDING)
     {
         IO_STATUS_BLOCK *iosb = (IO_STATUS_BLOCK *)wsa->write.user_overlapped;
+        ULONG sent = 0;
         int n;
 
-        n = WS2_send( fd, &wsa->write, convert_flags(wsa->write.flags) );
-        if (n >= 0)
+        if (wsa->write.first_iovec < wsa->write.n_iovecs)
         {
-            if (iosb) iosb->Information += n;
+            n = WS2_send( fd, &wsa->write, convert_flags(wsa->write.flags) );
+            if (n >= 0)
+                sent = n;
+            else if (errno != EAGAIN)
+                status = wsaErrStatus();
         }
-        else if (errno != EAGAIN)
-            return wsaErrStatus();
+#ifdef HAVE_SYS_SENDFILE_H
+        else if (wsa->file)
+            status = WS2_transmitfile_sendfile( fd, wsa, &sent );
+#endif
+        if (iosb) iosb->Information += sent;
     }
 
+    if (status != STATUS_PENDING) WS2_transmitfile_cork( fd, wsa, FALSE );
     return status;
 }
 
@@ -3041,6 +3162,12 @@ static NTSTATUS WS2_async_transmitfile( void *user, IO_STATUS_BLOCK *iosb, NTSTA
         if (status == STATUS_PENDING)
             return status;
     }
+    else if (wsa->corked && !wine_server_handle_to_fd( wsa->write.hSocket, 0, &fd, NULL ))
+    {
+        /* don't leave the socket corked if the transfer is aborted */
+        WS2_transmitfile_cork( fd, wsa, FALSE );
+        wine_server_release_fd( wsa->write.hSocket, fd );
+    }
 
     iosb->u.Status = status;
     release_async_io( &wsa->io );
@@ -3108,6 +3235,8 @@ static BOOL WINAPI WS2_TransmitFile( SOCKET s, HANDLE h, DWORD file_bytes, DWORD
     wsa->bytes_per_send        = bytes_per_send;
     wsa->flags                 = flags;
     wsa->offset.QuadPart       = FILE_USE_FILE_POINTER_POSITION;
+    wsa->use_sendfile          = TRUE;
+    wsa->corked                = FALSE;
     wsa->write.hSocket         = SOCKET2HANDLE(s);
     wsa->write.addr            = NULL;
     wsa->write.addrlen.val     = 0;
@@ -3117,6 +3246,8 @@ static BOOL WINAPI WS2_TransmitFile( SOCKET s, HANDLE h, DWORD file_bytes, DWORD
     wsa->write.n_iovecs        = 0;
     wsa->write.first_iovec     = 0;
     wsa->write.user_overlapped = overlapped;
+    if (wsa->buffers.Head || wsa->buffers.Tail)
+        WS2_transmitfile_cork( fd, wsa, TRUE );
     if (overlapped)
     {
         IO_STATUS_BLOCK *iosb = (IO_STATUS_BLOCK *)overlapped;
@@ -3128,7 +3259,11 @@ static BOOL WINAPI WS2_TransmitFile( SOCKET s, HANDLE h, DWORD file_bytes, DWORD
         iosb->Information = 0;
         status = register_async( ASYNC_TYPE_WRITE, SOCKET2HANDLE(s), &wsa->io,
                                  overlapped->hEvent, NULL, NULL, iosb );
-        if(status != STATUS_PENDING) HeapFree( GetProcessHeap(), 0, wsa );
+        if(status != STATUS_PENDING)
+        {
+            WS2_transmitfile_cork( fd, wsa, FALSE );
+            HeapFree( GetProcessHeap(), 0, wsa );
+        }
         release_sock_fd( s, fd );
         WSASetLastError( NtStatusToWSAError(status) );
         return FALSE;
@@ -3384,6 +3519,9 @@ int WINAPI WS_closesocket(SOCKET s)
         if (fd >= 0)
         {
             release_sock_fd(s, fd);
+            /* the client-side operations still need the handle to report their completion */
+            reactor_cancel_io(SOCKET2HANDLE(s), NULL, FALSE);
+            poll_cache_invalidate();
             if (CloseHandle(SOCKET2HANDLE(s)))
                 res = 0;
         }
@@ -5171,12 +5309,284 @@ int WINAPI WS_recvfrom(SOCKET s, char *buf, INT len, int flags,
         return n;
 }
 
+/***********************************************************************
+ * Poll cache
+ *
+ * Applications often call select() or WSAPoll() in a loop on the same large
+ * set of sockets. Once a thread has polled the same set twice in a row, it is
+ * registered with an epoll instance, so that polling it again only requires
+ * checking that the sockets still map to the same unix sockets, instead of
+ * querying the state of every socket and passing the whole set to the kernel.
+ * closesocket() invalidates the registered sets, and each entry is checked
+ * against the device and inode of its unix socket in case a handle was closed
+ * with CloseHandle() and reused.
+ */
+
+#if defined(HAVE_SYS_EPOLL_H) && defined(HAVE_EPOLL_CREATE)
+
+#define POLL_CACHE_MIN_COUNT 32
+
+struct poll_cache_entry
+{
+    SOCKET s;       /* socket handle */
+    DWORD  access;  /* access used to retrieve the unix fd */
+    int    key;     /* fd set index for select(), requested events for WSAPoll() */
+    int    fd;      /* unix fd of the socket */
+    dev_t  dev;     /* device and inode of the unix socket, in case the fd is reused */
+    ino_t  ino;
+    short  events;  /* unix poll events */
+    int    next;    /* next entry using the same unix fd, or -1 */
+};
+
+struct poll_cache
+{
+    int                      epoll_fd;
+    LONG                     generation;  /* value of poll_cache_generation when the set was registered */
+    unsigned int             count;       /* number of entries, 0 if no set is registered */
+    unsigned int             recorded;    /* number of entries of the last recorded set */
+    BOOL                     repeated;    /* the set being recorded is the same as the previous one */
+    unsigned int             size;        /* allocated size of the arrays */
+    struct poll_cache_entry *entries;
+    struct epoll_event      *events;
+};
+
+/* incremented when a socket is closed, or when the events polled for a socket may change */
+static LONG poll_cache_generation;
+
+static void poll_cache_invalidate(void)
+{
+    InterlockedIncrement( &poll_cache_generation );
+}
+
+static void poll_cache_free( struct poll_cache *cache )
+{
+    if (!cache) return;
+    if (cache->epoll_fd != -1) close( cache->epoll_fd );
+    HeapFree( GetProcessHeap(), 0, cache->entries );
+    HeapFree( GetProcessHeap(), 0, cache->events );
+    HeapFree( GetProcessHeap(), 0, cache );
+}
+
+/* check if the set registered by the thread can be used for a poll of count sockets */
+static struct poll_cache *poll_cache_lookup( unsigned int count )
+{
+    struct poll_cache *cache = get_per_thread_data()->poll_cache;
+
+    if (!cache || cache->count != count || cache->generation != poll_cache_generation) return NULL;
+    return cache;
+}
+
+/* retrieve the unix fd of an entry of the registered set, fails if it doesn't match the socket */
+static BOOL poll_cache_get_fd( struct poll_cache *cache, unsigned int index, SOCKET s,
+                               DWORD access, int key, struct pollfd *pfd )
+{
+    const struct poll_cache_entry *entry = &cache->entries[index];
+    struct stat st;
+
+    if (entry->s != s || entry->access != access || entry->key != key) return FALSE;
+    if ((pfd->fd = get_sock_fd( s, access, NULL )) == -1) return FALSE;
+    if (pfd->fd != entry->fd || fstat( pfd->fd, &st ) ||
+        st.st_dev != entry->dev || st.st_ino != entry->ino)
+    {
+        release_sock_fd( s, pfd->fd );
+        pfd->fd = -1;
+        return FALSE;
+    }
+    pfd->events  = entry->events;
+    pfd->revents = 0;
+    return TRUE;
+}
+
+/* release the fds retrieved by poll_cache_get_fd after a mismatch, and drop the registered set */
+static void poll_cache_release_fds( struct poll_cache *cache, const struct pollfd *fds, unsigned int count )
+{
+    unsigned int i;
+
+    for (i = 0; i < count; i++) release_sock_fd( cache->entries[i].s, fds[i].fd );
+    cache->count = 0;
+}
+
+/* start recording a new set of count sockets, returns NULL if it isn't worth caching */
+static struct poll_cache *poll_cache_prepare( unsigned int count )
+{
+    struct per_thread_data *ptb = get_per_thread_data();
+    struct poll_cache *cache = ptb->poll_cache;
+
+    if (count < POLL_CACHE_MIN_COUNT) return NULL;
+
+    if (!cache)
+    {
+        if (!(cache = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*cache) ))) return NULL;
+        cache->epoll_fd = -1;
+        ptb->poll_cache = cache;
+    }
+    cache->count = 0;
+    cache->repeated = (cache->recorded == count);
+    cache->recorded = 0;  /* until the set is completely recorded */
+
+    if (cache->size < count)
+    {
+        struct poll_cache_entry *entries;
+        struct epoll_event *events;
+
+        if (!(entries = HeapAlloc( GetProcessHeap(), 0, count * sizeof(*entries) ))) return NULL;
+        if (!(events = HeapAlloc( GetProcessHeap(), 0, count * sizeof(*events) )))
+        {
+            HeapFree( GetProcessHeap(), 0, entries );
+            return NULL;
+        }
+        HeapFree( GetProcessHeap(), 0, cache->entries );
+        HeapFree( GetProcessHeap(), 0, cache->events );
+        cache->entries  = entries;
+        cache->events   = events;
+        cache->size     = count;
+        cache->repeated = FALSE;
+    }
+    /* handles closed from now on invalidate the set */
+    cache->generation = poll_cache_generation;
+    return cache;
+}
+
+static inline void poll_cache_set_entry( struct poll_cache *cache, unsigned int index, SOCKET s,
+                                         DWORD access, int key )
+{
+    if (!cache) return;
+    if (cache->entries[index].s != s || cache->entries[index].access != access ||
+        cache->entries[index].key != key)
+        cache->repeated = FALSE;
+    cache->entries[index].s      = s;
+    cache->entries[index].access = access;
+    cache->entries[index].key    = key;
+}
+
+/* register the fds of a recorded set with the epoll instance, if it was also the previous set */
+static struct poll_cache *poll_cache_register( struct poll_cache *cache, const struct pollfd *fds,
+                                               unsigned int count )
+{
+    struct epoll_event ev;
+    struct stat st;
+    unsigned int i, j;
+
+    if (!cache) return NULL;
+
+    cache->recorded = count;
+    if (!cache->repeated) return NULL;
+
+    /* start from an empty instance, it is cheaper than removing the previous fds */
+    if (cache->epoll_fd != -1) close( cache->epoll_fd );
+    if ((cache->epoll_fd = epoll_create( count )) == -1) return NULL;
+
+    for (i = 0; i < count; i++)
+    {
+        struct poll_cache_entry *entry = &cache->entries[i];
+
+        /* sockets that aren't polled need to be checked again on every call */
+        if (fds[i].fd == -1 || fstat( fds[i].fd, &st )) return NULL;
+
+        entry->fd     = fds[i].fd;
+        entry->dev    = st.st_dev;
+        entry->ino    = st.st_ino;
+        entry->events = fds[i].events;
+        entry->next   = -1;
+
+        ev.events   = fds[i].events;
+        ev.data.u64 = i;
+        if (!epoll_ctl( cache->epoll_fd, EPOLL_CTL_ADD, fds[i].fd, &ev )) continue;
+        if (errno != EEXIST) return NULL;
+
+        /* the socket is present in several sets, chain the entries */
+        for (j = 0; cache->entries[j].fd != fds[i].fd; j++) ;
+        ev.data.u64 = j;
+        ev.events   = fds[i].events;
+        for (;;)
+        {
+            ev.events |= cache->entries[j].events;
+            if (cache->entries[j].next == -1) break;
+            j = cache->entries[j].next;
+        }
+        cache->entries[j].next = i;
+        if (epoll_ctl( cache->epoll_fd, EPOLL_CTL_MOD, fds[i].fd, &ev )) return NULL;
+    }
+    TRACE( "registered %u sockets with epoll fd %d\n", count, cache->epoll_fd );
+    cache->count = count;
+    return cache;
+}
+
+/* poll the fds, using the epoll instance if they are the registered set */
+static int poll_cache_wait( struct poll_cache *cache, struct pollfd *fds, int count, int timeout )
+{
+    int i, j, ret;
+
+    if (!cache) return poll( fds, count, timeout );
+
+    if ((ret = epoll_wait( cache->epoll_fd, cache->events, count, timeout )) <= 0) return ret;
+
+    for (i = 0; i < ret; i++)
+        for (j = cache->events[i].data.u64; j != -1; j = cache->entries[j].next)
+            fds[j].revents = cache->events[i].events & (fds[j].events | POLLERR | POLLHUP);
+
+    /* return the number of entries with events, like poll() */
+    for (i = ret = 0; i < count; i++) if (fds[i].revents) ret++;
+    return ret;
+}
+
+#else  /* HAVE_SYS_EPOLL_H && HAVE_EPOLL_CREATE */
+
+static void poll_cache_invalidate(void)
+{
+}
+
+static void poll_cache_free( struct poll_cache *cache )
+{
+}
+
+static struct poll_cache *poll_cache_lookup( unsigned int count )
+{
+    return NULL;
+}
+
+static BOOL poll_cache_get_fd( struct poll_cache *cache, unsigned int index, SOCKET s,
+                               DWORD access, int key, struct pollfd *pfd )
+{
+    return FALSE;
+}
+
+static void poll_cache_release_fds( struct poll_cache *cache, const struct pollfd *fds, unsigned int count )
+{
+}
+
+static struct poll_cache *poll_cache_prepare( unsigned int count )
+{
+    return NULL;
+}
+
+static inline void poll_cache_set_entry( struct poll_cache *cache, unsigned int index, SOCKET s,
+                                         DWORD access, int key )
+{
+}
+
+static struct poll_cache *poll_cache_register( struct poll_cache *cache, const struct pollfd *fds,
+                                               unsigned int count )
+{
+    return NULL;
+}
+
+static int poll_cache_wait( struct poll_cache *cache, struct pollfd *fds, int count, int timeout )
+{
+    return poll( fds, count, timeout );
+}
+
+#endif  /* HAVE_SYS_EPOLL_H && HAVE_EPOLL_CREATE */
+
 /* allocate a poll array for the corresponding fd sets */
+/* the set is registered with the poll cache when cache_ret is set on return */
 static struct pollfd *fd_sets_to_poll( const WS_fd_set *readfds, const WS_fd_set *writefds,
-                                       const WS_fd_set *exceptfds, int *count_ptr )
+                                       const WS_fd_set *exceptfds, int *count_ptr,
+                                       struct poll_cache **cache_ret )
 {
     unsigned int i, j = 0, count = 0;
     struct pollfd *fds;
+    struct poll_cache *cache;
     struct per_thread_data *ptb = get_per_thread_data();
 
     if (readfds) count += readfds->fd_count;
@@ -5204,9 +5614,33 @@ static struct pollfd *fd_sets_to_poll( const WS_fd_set *readfds, const WS_fd_set
     else
         fds = ptb->fd_cache;
 
+    if ((cache = poll_cache_lookup( count )))
+    {
+        if (readfds)
+            for (i = 0; i < readfds->fd_count; i++, j++)
+                if (!poll_cache_get_fd( cache, j, readfds->fd_array[i], FILE_READ_DATA, 0, &fds[j] ))
+                    goto mismatch;
+        if (writefds)
+            for (i = 0; i < writefds->fd_count; i++, j++)
+                if (!poll_cache_get_fd( cache, j, writefds->fd_array[i], FILE_WRITE_DATA, 1, &fds[j] ))
+                    goto mismatch;
+        if (exceptfds)
+            for (i = 0; i < exceptfds->fd_count; i++, j++)
+                if (!poll_cache_get_fd( cache, j, exceptfds->fd_array[i], 0, 2, &fds[j] ))
+                    goto mismatch;
+        *cache_ret = cache;
+        return fds;
+
+    mismatch:
+        poll_cache_release_fds( cache, fds, j );
+        j = 0;
+    }
+
+    cache = poll_cache_prepare( count );
     if (readfds)
         for (i = 0; i < readfds->fd_count; i++, j++)
         {
+            poll_cache_set_entry( cache, j, readfds->fd_array[i], FILE_READ_DATA, 0 );
             fds[j].fd = get_sock_fd( readfds->fd_array[i], FILE_READ_DATA, NULL );
             if (fds[j].fd == -1) goto failed;
             fds[j].revents = 0;
@@ -5224,6 +5658,7 @@ static struct pollfd *fd_sets_to_poll( const WS_fd_set *readfds, const WS_fd_set
     if (writefds)
         for (i = 0; i < writefds->fd_count; i++, j++)
         {
+            poll_cache_set_entry( cache, j, writefds->fd_array[i], FILE_WRITE_DATA, 1 );
             fds[j].fd = get_sock_fd( writefds->fd_array[i], FILE_WRITE_DATA, NULL );
             if (fds[j].fd == -1) goto failed;
             fds[j].revents = 0;
@@ -5242,6 +5677,7 @@ static struct pollfd *fd_sets_to_poll( const WS_fd_set *readfds, const WS_fd_set
     if (exceptfds)
         for (i = 0; i < exceptfds->fd_count; i++, j++)
         {
+            poll_cache_set_entry( cache, j, exceptfds->fd_array[i], 0, 2 );
             fds[j].fd = get_sock_fd( exceptfds->fd_array[i], 0, NULL );
             if (fds[j].fd == -1) goto failed;
             fds[j].revents = 0;
@@ -5264,6 +5700,7 @@ static struct pollfd *fd_sets_to_poll( const WS_fd_set *readfds, const WS_fd_set
                 fds[j].events = 0;
             }
         }
+    *cache_ret = poll_cache_register( cache, fds, count );
     return fds;
 
 failed:
@@ -5316,14 +5753,14 @@ static void release_poll_fds( const WS_fd_set *readfds, const WS_fd_set *writefd
     }
 }
 
-static int do_poll(struct pollfd *pollfds, int count, int timeout)
+static int do_poll(struct pollfd *pollfds, int count, int timeout, struct poll_cache *cache)
 {
     struct timeval tv1, tv2;
     int ret, torig = timeout;
 
     if (timeout > 0) gettimeofday( &tv1, 0 );
 
-    while ((ret = poll( pollfds, count, timeout )) < 0)
+    while ((ret = poll_cache_wait( cache, pollfds, count, timeout )) < 0)
     {
         if (errno != EINTR) break;
         if (timeout < 0) continue;
@@ -5393,19 +5830,20 @@ int WINAPI WS_select(int nfds, WS_fd_set *ws_readfds,
                      WS_fd_set *ws_writefds, WS_fd_set *ws_exceptfds,
                      const struct WS_timeval* ws_timeout)
 {
+    struct poll_cache *cache = NULL;
     struct pollfd *pollfds;
     int count, ret, timeout = -1;
 
     TRACE("read %p, write %p, excp %p timeout %p\n",
           ws_readfds, ws_writefds, ws_exceptfds, ws_timeout);
 
-    if (!(pollfds = fd_sets_to_poll( ws_readfds, ws_writefds, ws_exceptfds, &count )))
+    if (!(pollfds = fd_sets_to_poll( ws_readfds, ws_writefds, ws_exceptfds, &count, &cache )))
         return SOCKET_ERROR;
 
     if (ws_timeout)
         timeout = (ws_timeout->tv_sec * 1000) + (ws_timeout->tv_usec + 999) / 1000;
 
-    ret = do_poll(pollfds, count, timeout);
+    ret = do_poll(pollfds, count, timeout, cache);
     release_poll_fds( ws_readfds, ws_writefds, ws_exceptfds, pollfds );
 
     if (ret == -1) SetLastError(wsaErrno());
@@ -5420,6 +5858,7 @@ int WINAPI WSAPoll(WSAPOLLFD *wfds, ULONG count, int timeout)
 {
     int i, ret;
     struct pollfd *ufds;
+    struct poll_cache *cache;
 
     if (!count)
     {
@@ -5438,14 +5877,31 @@ int WINAPI WSAPoll(WSAPOLLFD *wfds, ULONG count, int timeout)
         return SOCKET_ERROR;
     }
 
-    for (i = 0; i < count; i++)
+    if ((cache = poll_cache_lookup( count )))
     {
-        ufds[i].fd = get_sock_fd(wfds[i].fd, 0, NULL);
-        ufds[i].events = convert_poll_w2u(wfds[i].events);
-        ufds[i].revents = 0;
+        for (i = 0; i < count; i++)
+            if (!poll_cache_get_fd( cache, i, wfds[i].fd, 0, wfds[i].events, &ufds[i] )) break;
+        if (i < count)
+        {
+            poll_cache_release_fds( cache, ufds, i );
+            cache = NULL;
+        }
     }
 
-    ret = do_poll(ufds, count, timeout);
+    if (!cache)
+    {
+        cache = poll_cache_prepare( count );
+        for (i = 0; i < count; i++)
+        {
+            poll_cache_set_entry( cache, i, wfds[i].fd, 0, wfds[i].events );
+            ufds[i].fd = get_sock_fd(wfds[i].fd, 0, NULL);
+            ufds[i].events = convert_poll_w2u(wfds[i].events);
+            ufds[i].revents = 0;
+        }
+        cache = poll_cache_register( cache, ufds, count );
+    }
+
+    ret = do_poll(ufds, count, timeout, cache);
 
     for (i = 0; i < count; i++)
     {
@@ -5491,6 +5947,493 @@ static void WS_AddCompletion( SOCKET sock, ULONG_PTR CompletionValue, NTSTATUS C
 }
 
 
+/***********************************************************************
+ * Client-side reactor for overlapped socket I/O
+ *
+ * When enabled in the registry, pending overlapped operations that don't
+ * use a completion routine are not registered with the server. A dedicated
+ * thread waits for the sockets to become ready with epoll, performs the I/O
+ * itself and signals the event and completion port of the operation.
+ *
+ * The reactor only keeps a socket fd while operations are pending on it.
+ * closesocket() cancels them, and ntdll calls back into the reactor when
+ * CancelIo is called. A socket closed with CloseHandle() is shut down by the
+ * server, which wakes up the reactor so that its operations complete.
+ */
+
+enum reactor_op_type
+{
+    REACTOR_READ,
+    REACTOR_WRITE
+};
+
+#if defined(HAVE_SYS_EPOLL_H) && defined(HAVE_EPOLL_CREATE)
+
+struct reactor_op
+{
+    struct list       entry;
+    struct ws2_async *wsa;
+    IO_STATUS_BLOCK  *iosb;
+    ULONG_PTR         cvalue;
+    HANDLE            event;
+    SOCKET            s;        /* socket to report the completion to, 0 if it's gone */
+    DWORD             thread;   /* thread that started the operation */
+    NTSTATUS          status;   /* final status, once the operation is done */
+    enum reactor_op_type type;
+};
+
+struct reactor_socket
+{
+    struct wine_rb_entry entry;
+    SOCKET               s;
+    int                  fd;        /* socket fd, kept while operations are pending, registered with epoll */
+    dev_t                dev;       /* device and inode of the socket, to identify it if the handle is reused */
+    ino_t                ino;
+    BOOL                 datagram;  /* datagram socket, operations can be batched */
+    struct list          ops[2];    /* pending operations, indexed by enum reactor_op_type */
+};
+
+static int reactor_compare( const void *key, const struct wine_rb_entry *entry )
+{
+    const struct reactor_socket *sock = WINE_RB_ENTRY_VALUE( entry, const struct reactor_socket, entry );
+    SOCKET s = *(const SOCKET *)key;
+
+    return s < sock->s ? -1 : s > sock->s;
+}
+
+static struct wine_rb_tree reactor_sockets = { reactor_compare };
+static LONG reactor_socket_count;
+static int reactor_epoll_fd = -1;
+static INIT_ONCE reactor_once = INIT_ONCE_STATIC_INIT;
+
+static CRITICAL_SECTION reactor_cs;
+static CRITICAL_SECTION_DEBUG reactor_cs_debug =
+{
+    0, 0, &reactor_cs,
+    { &reactor_cs_debug.ProcessLocksList, &reactor_cs_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": reactor_cs") }
+};
+static CRITICAL_SECTION reactor_cs = { &reactor_cs_debug, -1, 0, 0, 0, 0 };
+
+/* re-arm the one-shot epoll registration of a socket for its pending operations */
+static void reactor_arm( struct reactor_socket *sock )
+{
+    struct epoll_event ev;
+
+    ev.events = EPOLLONESHOT;
+    if (!list_empty( &sock->ops[REACTOR_READ] )) ev.events |= EPOLLIN;
+    if (!list_empty( &sock->ops[REACTOR_WRITE] )) ev.events |= EPOLLOUT;
+    ev.data.u64 = sock->s;
+    if (epoll_ctl( reactor_epoll_fd, EPOLL_CTL_MOD, sock->fd, &ev ) == -1)
+        ERR( "failed to arm socket %04lx: %s\n", sock->s, strerror(errno) );
+}
+
+/* remove a socket from the reactor once it has no pending operations, the reactor_cs must be held */
+static void reactor_release_socket( struct reactor_socket *sock )
+{
+    epoll_ctl( reactor_epoll_fd, EPOLL_CTL_DEL, sock->fd, NULL );
+    close( sock->fd );
+    wine_rb_remove( &reactor_sockets, &sock->entry );
+    interlocked_xchg_add( &reactor_socket_count, -1 );
+    HeapFree( GetProcessHeap(), 0, sock );
+}
+
+/* move a finished operation to the list of operations to complete, the reactor_cs must be held */
+static void reactor_finish_op( struct reactor_op *op, NTSTATUS status, struct list *done )
+{
+    op->status = status;
+    list_remove( &op->entry );
+    list_add_tail( done, &op->entry );
+}
+
+/* report the completion of finished operations, without holding the reactor_cs */
+static void reactor_complete( struct list *done )
+{
+    struct reactor_op *op, *next;
+
+    LIST_FOR_EACH_ENTRY_SAFE( op, next, done, struct reactor_op, entry )
+    {
+        TRACE( "socket %04lx iosb %p status %08x info %lu\n", op->s, op->iosb, op->status, op->iosb->Information );
+
+        op->iosb->u.Status = op->status;
+        if (op->s && op->cvalue) WS_AddCompletion( op->s, op->cvalue, op->status, op->iosb->Information );
+        if (op->event) SetEvent( op->event );
+        if (op->s && op->type == REACTOR_READ && op->status == STATUS_SUCCESS)
+            _enable_event( SOCKET2HANDLE(op->s), FD_READ, 0, 0 );
+        HeapFree( GetProcessHeap(), 0, op->wsa );
+        HeapFree( GetProcessHeap(), 0, op );
+    }
+}
+
+/* cancel the matching pending operations of a socket, the reactor_cs must be held */
+static BOOL reactor_cancel_ops( struct reactor_socket *sock, IO_STATUS_BLOCK *iosb, DWORD thread,
+                                BOOL gone, struct list *done )
+{
+    struct reactor_op *op, *next;
+    BOOL ret = FALSE;
+    int type;
+
+    for (type = REACTOR_READ; type <= REACTOR_WRITE; type++)
+    {
+        LIST_FOR_EACH_ENTRY_SAFE( op, next, &sock->ops[type], struct reactor_op, entry )
+        {
+            if (iosb && op->iosb != iosb) continue;
+            if (thread && op->thread != thread) continue;
+            if (gone) op->s = 0;
+            reactor_finish_op( op, STATUS_CANCELLED, done );
+            ret = TRUE;
+        }
+    }
+    if (list_empty( &sock->ops[REACTOR_READ] ) && list_empty( &sock->ops[REACTOR_WRITE] ))
+        reactor_release_socket( sock );
+    else
+        reactor_arm( sock );
+    return ret;
+}
+
+#if defined(HAVE_RECVMMSG) && defined(HAVE_SENDMMSG)
+
+#define REACTOR_BATCH_SIZE 16
+
+extern int CDECL __wine_locked_recvmmsg( int fd, struct mmsghdr *hdrs, unsigned int count, int flags );
+
+/***********************************************************************
+ *		reactor_do_batch
+ *
+ * Perform several pending datagram operations with a single recvmmsg or
+ * sendmmsg call. Returns the number of completed operations, 0 if the
+ * socket is not ready, or -1 if the first operation has to be performed
+ * on its own.
+ * The reactor_cs must be held.
+ */
+static int reactor_do_batch( struct reactor_socket *sock, enum reactor_op_type type, struct list *done )
+{
+    struct mmsghdr hdrs[REACTOR_BATCH_SIZE];
+    union generic_unix_sockaddr addrs[REACTOR_BATCH_SIZE];
+    struct reactor_op *ops[REACTOR_BATCH_SIZE], *op;
+    int i, ret, count = 0, flags = 0;
+
+    LIST_FOR_EACH_ENTRY( op, &sock->ops[type], struct reactor_op, entry )
+    {
+        struct ws2_async *wsa = op->wsa;
+        struct msghdr *hdr = &hdrs[count].msg_hdr;
+        int op_flags = convert_flags( wsa->flags );
+
+        /* all the messages are processed with the same flags, and control data isn't supported */
+        if ((count && op_flags != flags) || wsa->control) break;
+
+        memset( hdr, 0, sizeof(*hdr) );
+        hdr->msg_iov    = wsa->iovec + wsa->first_iovec;
+        hdr->msg_iovlen = wsa->n_iovecs - wsa->first_iovec;
+        if (wsa->addr)
+        {
+            hdr->msg_name = &addrs[count];
+            if (type == REACTOR_READ)
+                hdr->msg_namelen = sizeof(addrs[count]);
+            else if (wsa->addr->sa_family == WS_AF_IPX ||
+                     !(hdr->msg_namelen = ws_sockaddr_ws2u( wsa->addr, wsa->addrlen.val, &addrs[count] )))
+                break;
+        }
+        flags = op_flags;
+        ops[count++] = op;
+        if (count == REACTOR_BATCH_SIZE) break;
+    }
+    if (count < 2) return -1;
+
+    do
+    {
+        if (type == REACTOR_READ)
+            ret = __wine_locked_recvmmsg( sock->fd, hdrs, count, flags );
+        else
+            ret = sendmmsg( sock->fd, hdrs, count, flags );
+    }
+    while (ret == -1 && errno == EINTR);
+
+    if (ret == -1) return errno == EAGAIN ? 0 : -1;
+
+    TRACE( "socket %04lx: %s %d/%d messages\n", sock->s,
+           type == REACTOR_READ ? "received" : "sent", ret, count );
+
+    for (i = 0; i < ret; i++)
+    {
+        struct ws2_async *wsa = ops[i]->wsa;
+        NTSTATUS status = STATUS_SUCCESS;
+
+        if (type == REACTOR_READ)
+        {
+            if (wsa->addr && hdrs[i].msg_hdr.msg_namelen)
+                ws_sockaddr_u2ws( &addrs[i].addr, wsa->addr, wsa->addrlen.ptr );
+            ops[i]->iosb->Information = hdrs[i].msg_len;
+            if (hdrs[i].msg_hdr.msg_flags & MSG_TRUNC) status = STATUS_BUFFER_OVERFLOW;
+        }
+        else
+        {
+            /* datagrams are always sent as a whole */
+            ops[i]->iosb->Information += hdrs[i].msg_len;
+            wsa->first_iovec = wsa->n_iovecs;
+        }
+        reactor_finish_op( ops[i], status, done );
+    }
+    return ret;
+}
+
+#endif  /* HAVE_RECVMMSG && HAVE_SENDMMSG */
+
+/* perform as many pending operations of the given type as possible, the reactor_cs must be held */
+static void reactor_do_io( struct reactor_socket *sock, enum reactor_op_type type, struct list *done )
+{
+    struct list *ptr;
+
+    while ((ptr = list_head( &sock->ops[type] )))
+    {
+        struct reactor_op *op = LIST_ENTRY( ptr, struct reactor_op, entry );
+        struct ws2_async *wsa = op->wsa;
+        NTSTATUS status = STATUS_SUCCESS;
+        BOOL truncated = FALSE;
+        int n;
+
+#if defined(HAVE_RECVMMSG) && defined(HAVE_SENDMMSG)
+        if (sock->datagram && list_next( &sock->ops[type], ptr ))
+        {
+            if ((n = reactor_do_batch( sock, type, done )) > 0) continue;
+            if (!n) break;
+        }
+#endif
+        if (type == REACTOR_READ)
+            n = WS2_recv( sock->fd, wsa, convert_flags( wsa->flags ), &truncated );
+        else
+            n = WS2_send( sock->fd, wsa, convert_flags( wsa->flags ));
+
+        if (n == -1)
+        {
+            if (errno == EAGAIN) break;
+            status = wsaErrStatus();
+            if (type == REACTOR_READ) op->iosb->Information = 0;
+        }
+        else if (type == REACTOR_READ)
+        {
+            op->iosb->Information = n;
+            if (truncated) status = STATUS_BUFFER_OVERFLOW;
+        }
+        else
+        {
+            op->iosb->Information += n;
+            if (wsa->first_iovec < wsa->n_iovecs) continue;
+        }
+
+        reactor_finish_op( op, status, done );
+    }
+}
+
+static DWORD WINAPI reactor_thread( void *arg )
+{
+    struct epoll_event events[64];
+    struct list done;
+    int i, count;
+
+    for (;;)
+    {
+        if ((count = epoll_wait( reactor_epoll_fd, events, sizeof(events) / sizeof(events[0]), -1 )) == -1)
+        {
+            if (errno == EINTR) continue;
+            ERR( "epoll_wait failed: %s\n", strerror(errno) );
+            return 1;
+        }
+
+        list_init( &done );
+        EnterCriticalSection( &reactor_cs );
+        for (i = 0; i < count; i++)
+        {
+            SOCKET s = events[i].data.u64;
+            struct wine_rb_entry *entry;
+            struct reactor_socket *sock;
+
+            /* the socket may have been closed in the meantime */
+            if (!(entry = wine_rb_get( &reactor_sockets, &s ))) continue;
+            sock = WINE_RB_ENTRY_VALUE( entry, struct reactor_socket, entry );
+
+            if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) reactor_do_io( sock, REACTOR_READ, &done );
+            if (events[i].events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) reactor_do_io( sock, REACTOR_WRITE, &done );
+            if (list_empty( &sock->ops[REACTOR_READ] ) && list_empty( &sock->ops[REACTOR_WRITE] ))
+                reactor_release_socket( sock );
+            else
+                reactor_arm( sock );
+        }
+        LeaveCriticalSection( &reactor_cs );
+        reactor_complete( &done );
+    }
+}
+
+/* cancel the pending operations of a socket, when CancelIo is called on it or when it's closed */
+static BOOL reactor_cancel_io( HANDLE handle, IO_STATUS_BLOCK *iosb, BOOL only_thread )
+{
+    SOCKET s = HANDLE2SOCKET(handle);
+    struct wine_rb_entry *entry;
+    struct list done;
+    BOOL ret = FALSE;
+
+    if (!reactor_socket_count) return FALSE;
+
+    list_init( &done );
+    EnterCriticalSection( &reactor_cs );
+    if ((entry = wine_rb_get( &reactor_sockets, &s )))
+        ret = reactor_cancel_ops( WINE_RB_ENTRY_VALUE( entry, struct reactor_socket, entry ), iosb,
+                                  only_thread ? GetCurrentThreadId() : 0, FALSE, &done );
+    LeaveCriticalSection( &reactor_cs );
+    reactor_complete( &done );
+    return ret;
+}
+
+static BOOL reactor_enabled(void)
+{
+    char buffer[16];
+    DWORD type, size = sizeof(buffer);
+    BOOL ret = FALSE;
+    HKEY hkey;
+
+    /* @@ Wine registry key: HKCU\Software\Wine\WinSock */
+    if (!RegOpenKeyA( HKEY_CURRENT_USER, "Software\\Wine\\WinSock", &hkey ))
+    {
+        if (!RegQueryValueExA( hkey, "SocketReactor", NULL, &type, (BYTE *)buffer, &size ) &&
+            type == REG_SZ)
+            ret = !strcmp( buffer, "enabled" );
+        RegCloseKey( hkey );
+    }
+    return ret;
+}
+
+static BOOL WINAPI reactor_init( INIT_ONCE *once, void *param, void **context )
+{
+    HANDLE thread;
+
+    if (!reactor_enabled()) return TRUE;
+
+    if ((reactor_epoll_fd = epoll_create( 64 )) == -1)
+    {
+        WARN( "epoll_create failed: %s\n", strerror(errno) );
+        return TRUE;
+    }
+    fcntl( reactor_epoll_fd, F_SETFD, FD_CLOEXEC );
+
+    if (!(thread = CreateThread( NULL, 0, reactor_thread, NULL, 0, NULL )))
+    {
+        close( reactor_epoll_fd );
+        reactor_epoll_fd = -1;
+        return TRUE;
+    }
+    CloseHandle( thread );
+    TRACE( "socket reactor enabled\n" );
+    return TRUE;
+}
+
+/***********************************************************************
+ *		reactor_queue_async
+ *
+ * Hand a pending overlapped operation over to the reactor thread. The fd
+ * of the socket must still be held by the caller.
+ * Returns FALSE if the operation has to be registered with the server instead.
+ */
+static BOOL reactor_queue_async( SOCKET s, int fd, enum reactor_op_type type, struct ws2_async *wsa,
+                                 IO_STATUS_BLOCK *iosb, ULONG_PTR cvalue, HANDLE event )
+{
+    struct wine_rb_entry *entry;
+    struct reactor_socket *sock = NULL;
+    struct reactor_op *op;
+    struct list done;
+    struct stat st;
+
+    InitOnceExecuteOnce( &reactor_once, reactor_init, NULL, NULL );
+    if (reactor_epoll_fd == -1) return FALSE;
+    if (fstat( fd, &st ) == -1) return FALSE;
+
+    if (!(op = HeapAlloc( GetProcessHeap(), 0, sizeof(*op) ))) return FALSE;
+    op->wsa    = wsa;
+    op->iosb   = iosb;
+    op->cvalue = cvalue;
+    op->event  = (HANDLE)((ULONG_PTR)event & ~1);  /* the low bit only disables the completion port */
+    op->s      = s;
+    op->thread = GetCurrentThreadId();
+    op->type   = type;
+    if (op->event) ResetEvent( op->event );
+
+    list_init( &done );
+    EnterCriticalSection( &reactor_cs );
+
+    if ((entry = wine_rb_get( &reactor_sockets, &s )))
+    {
+        sock = WINE_RB_ENTRY_VALUE( entry, struct reactor_socket, entry );
+        if (sock->dev != st.st_dev || sock->ino != st.st_ino)
+        {
+            /* the handle was closed without us noticing, and now refers to another socket */
+            reactor_cancel_ops( sock, NULL, 0, TRUE, &done );
+            sock = NULL;
+        }
+    }
+    if (!sock)
+    {
+        struct epoll_event ev;
+        socklen_t len = sizeof(int);
+        int sock_type;
+
+        if (!(sock = HeapAlloc( GetProcessHeap(), 0, sizeof(*sock) ))) goto failed;
+        ev.events = EPOLLONESHOT;
+        ev.data.u64 = s;
+        if ((sock->fd = dup( fd )) == -1 || epoll_ctl( reactor_epoll_fd, EPOLL_CTL_ADD, sock->fd, &ev ) == -1)
+        {
+            if (sock->fd != -1) close( sock->fd );
+            HeapFree( GetProcessHeap(), 0, sock );
+            goto failed;
+        }
+        fcntl( sock->fd, F_SETFD, FD_CLOEXEC );
+        sock->s = s;
+        sock->dev = st.st_dev;
+        sock->ino = st.st_ino;
+        sock->datagram = !getsockopt( fd, SOL_SOCKET, SO_TYPE, &sock_type, &len ) && sock_type == SOCK_DGRAM;
+        list_init( &sock->ops[REACTOR_READ] );
+        list_init( &sock->ops[REACTOR_WRITE] );
+        wine_rb_put( &reactor_sockets, &s, &sock->entry );
+        interlocked_xchg_add( &reactor_socket_count, 1 );
+    }
+
+    list_add_tail( &sock->ops[type], &op->entry );
+    reactor_arm( sock );
+    LeaveCriticalSection( &reactor_cs );
+    reactor_complete( &done );
+    return TRUE;
+
+failed:
+    LeaveCriticalSection( &reactor_cs );
+    reactor_complete( &done );
+    HeapFree( GetProcessHeap(), 0, op );
+    return FALSE;
+}
+
+#else  /* HAVE_SYS_EPOLL_H */
+
+static BOOL reactor_queue_async( SOCKET s, int fd, enum reactor_op_type type, struct ws2_async *wsa,
+                                 IO_STATUS_BLOCK *iosb, ULONG_PTR cvalue, HANDLE event )
+{
+    return FALSE;
+}
+
+static BOOL reactor_cancel_io( HANDLE handle, IO_STATUS_BLOCK *iosb, BOOL only_thread )
+{
+    return FALSE;
+}
+
+#endif  /* HAVE_SYS_EPOLL_H */
+
+/***********************************************************************
+ *		socket_cancel_io
+ *
+ * Called by ntdll when CancelIo is called on a handle.
+ */
+static BOOL CDECL socket_cancel_io( HANDLE handle, IO_STATUS_BLOCK *iosb, BOOL only_thread )
+{
+    return reactor_cancel_io( handle, iosb, only_thread );
+}
+
+
 /***********************************************************************
  *		send			(WS2_32.19)
  */
@@ -5601,7 +6544,6 @@ static int WS2_sendto( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
 
         wsa->user_overlapped = lpOverlapped;
         wsa->completion_func = lpCompletionRoutine;
-        release_sock_fd( s, fd );
 
         if (n == -1 || n < totalLength)
         {
@@ -5611,9 +6553,12 @@ static int WS2_sendto( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
             if (wsa->completion_func)
                 err = register_async( ASYNC_TYPE_WRITE, wsa->hSocket, &wsa->io, NULL,
                                       ws2_async_apc, wsa, iosb );
+            else if (reactor_queue_async( s, fd, REACTOR_WRITE, wsa, iosb, cvalue, lpOverlapped->hEvent ))
+                err = STATUS_PENDING;
             else
                 err = register_async( ASYNC_TYPE_WRITE, wsa->hSocket, &wsa->io, lpOverlapped->hEvent,
                                       NULL, (void *)cvalue, iosb );
+            release_sock_fd( s, fd );
 
             /* Enable the event only after starting the async. The server will deliver it as soon as
                the async is done. */
@@ -5623,6 +6568,7 @@ static int WS2_sendto( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
             SetLastError(NtStatusToWSAError( err ));
             return SOCKET_ERROR;
         }
+        release_sock_fd( s, fd );
 
         iosb->u.Status = STATUS_SUCCESS;
         iosb->Information = n;
@@ -5822,7 +6768,6 @@ int WINAPI WS_setsockopt(SOCKET s, int level, int optname,
         case WS_SO_BROADCAST:
         case WS_SO_ERROR:
         case WS_SO_KEEPALIVE:
-        case WS_SO_OOBINLINE:
         /* BSD socket SO_REUSEADDR is not 100% compatible to winsock semantics.
          * however, using it the BSD way fixes bug 8513 and seems to be what
          * most programmers assume, anyway */
@@ -5832,6 +6777,12 @@ int WINAPI WS_setsockopt(SOCKET s, int level, int optname,
             convert_sockopt(&level, &optname);
             break;
 
+        /* the events polled by select() depend on this option */
+        case WS_SO_OOBINLINE:
+            poll_cache_invalidate();
+            convert_sockopt(&level, &optname);
+            break;
+
         /* SO_DEBUG is a privileged operation, ignore it. */
         case WS_SO_DEBUG:
             TRACE("Ignoring SO_DEBUG\n");
@@ -7938,7 +8889,7 @@ static int WS2_recv_base( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
     unsigned int i, options;
     int n, fd, err, overlapped, flags;
     struct ws2_async *wsa = NULL, localwsa;
-    BOOL is_blocking;
+    BOOL is_blocking, truncated;
     DWORD timeout_start = GetTickCount();
     ULONG_PTR cvalue = (lpOverlapped && ((ULONG_PTR)lpOverlapped->hEvent & 1) == 0) ? (ULONG_PTR)lpOverlapped : 0;
 
@@ -8001,7 +8952,7 @@ static int WS2_recv_base( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
     flags = convert_flags(wsa->flags);
     for (;;)
     {
-        n = WS2_recv( fd, wsa, flags );
+        n = WS2_recv( fd, wsa, flags, &truncated );
         if (n == -1)
         {
             /* Unix-like systems return EINVAL when attempting to read OOB data from
@@ -8023,7 +8974,6 @@ static int WS2_recv_base( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
 
             wsa->user_overlapped = lpOverlapped;
             wsa->completion_func = lpCompletionRoutine;
-            release_sock_fd( s, fd );
 
             if (n == -1)
             {
@@ -8033,26 +8983,36 @@ static int WS2_recv_base( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
                 if (wsa->completion_func)
                     err = register_async( ASYNC_TYPE_READ, wsa->hSocket, &wsa->io, NULL,
                                           ws2_async_apc, wsa, iosb );
+                else if (!(wsa->flags & WS_MSG_OOB) &&
+                         reactor_queue_async( s, fd, REACTOR_READ, wsa, iosb, cvalue, lpOverlapped->hEvent ))
+                    err = STATUS_PENDING;
                 else
                     err = register_async( ASYNC_TYPE_READ, wsa->hSocket, &wsa->io, lpOverlapped->hEvent,
                                           NULL, (void *)cvalue, iosb );
+                release_sock_fd( s, fd );
 
                 if (err != STATUS_PENDING) HeapFree( GetProcessHeap(), 0, wsa );
                 SetLastError(NtStatusToWSAError( err ));
                 return SOCKET_ERROR;
             }
+            release_sock_fd( s, fd );
 
-            iosb->u.Status = STATUS_SUCCESS;
+            iosb->u.Status = truncated ? STATUS_BUFFER_OVERFLOW : STATUS_SUCCESS;
             iosb->Information = n;
             if (!wsa->completion_func)
             {
-                if (cvalue) WS_AddCompletion( s, cvalue, STATUS_SUCCESS, n );
+                if (cvalue) WS_AddCompletion( s, cvalue, iosb->u.Status, n );
                 if (lpOverlapped->hEvent) SetEvent( lpOverlapped->hEvent );
                 HeapFree( GetProcessHeap(), 0, wsa );
             }
             else NtQueueApcThread( GetCurrentThread(), (PNTAPCFUNC)ws2_async_apc,
                                    (ULONG_PTR)wsa, (ULONG_PTR)iosb, 0 );
             _enable_event(SOCKET2HANDLE(s), FD_READ, 0, 0);
+            if (truncated)
+            {
+                SetLastError( WSAEMSGSIZE );
+                return SOCKET_ERROR;
+            }
             return 0;
         }
 
@@ -8097,6 +9057,14 @@ static int WS2_recv_base( SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount,
         }
     }
 
+    if (truncated)
+    {
+        /* the data that fit in the buffers is still returned */
+        _enable_event(SOCKET2HANDLE(s), FD_READ, 0, 0);
+        err = WSAEMSGSIZE;
+        goto error;
+    }
+
     TRACE(" -> %i bytes\n", n);
     if (wsa != &localwsa) HeapFree( GetProcessHeap(), 0, wsa );
     release_sock_fd( s, fd );
@@ -4186,6 +4186,70 @@ todo_wine
     ok(FD_ISSET(fdWrite, &writefds), "fdWrite socket is not in the set\n");
     closesocket(fdWrite);
 }
+
+/* repeated polls of the same large set of sockets */
+static void test_select_many(void)
+{
+    static const struct timeval zero_timeout;
+    SOCKET sockets[40], src;
+    struct sockaddr_in addr;
+    fd_set readfds;
+    unsigned int i, j;
+    int ret, len;
+
+    for (i = 0; i < sizeof(sockets) / sizeof(sockets[0]); i++)
+    {
+        sockets[i] = socket(AF_INET, SOCK_DGRAM, 0);
+        ok(sockets[i] != INVALID_SOCKET, "socket failed, error %d\n", WSAGetLastError());
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+        ret = bind(sockets[i], (struct sockaddr *)&addr, sizeof(addr));
+        ok(!ret, "bind failed, error %d\n", WSAGetLastError());
+    }
+    src = socket(AF_INET, SOCK_DGRAM, 0);
+    ok(src != INVALID_SOCKET, "socket failed, error %d\n", WSAGetLastError());
+
+    for (j = 0; j < 3; j++)
+    {
+        FD_ZERO(&readfds);
+        for (i = 0; i < sizeof(sockets) / sizeof(sockets[0]); i++) FD_SET(sockets[i], &readfds);
+        ret = select(0, &readfds, NULL, NULL, &zero_timeout);
+        ok(!ret, "%u: got %d\n", j, ret);
+        ok(!readfds.fd_count, "%u: got %u sockets\n", j, readfds.fd_count);
+    }
+
+    for (j = 0; j < 3; j++)
+    {
+        len = sizeof(addr);
+        ret = getsockname(sockets[j * 7], (struct sockaddr *)&addr, &len);
+        ok(!ret, "getsockname failed, error %d\n", WSAGetLastError());
+        ret = sendto(src, "x", 1, 0, (struct sockaddr *)&addr, sizeof(addr));
+        ok(ret == 1, "sendto returned %d, error %d\n", ret, WSAGetLastError());
+
+        FD_ZERO(&readfds);
+        for (i = 0; i < sizeof(sockets) / sizeof(sockets[0]); i++) FD_SET(sockets[i], &readfds);
+        ret = select(0, &readfds, NULL, NULL, NULL);
+        ok(ret == 1, "%u: got %d\n", j, ret);
+        ok(readfds.fd_count == 1 && readfds.fd_array[0] == sockets[j * 7],
+           "%u: got %u sockets\n", j, readfds.fd_count);
+
+        ret = recv(sockets[j * 7], (char *)&i, sizeof(i), 0);
+        ok(ret == 1, "recv returned %d, error %d\n", ret, WSAGetLastError());
+    }
+
+    closesocket(sockets[3]);
+    FD_ZERO(&readfds);
+    for (i = 0; i < sizeof(sockets) / sizeof(sockets[0]); i++) FD_SET(sockets[i], &readfds);
+    WSASetLastError(0xdeadbeef);
+    ret = select(0, &readfds, NULL, NULL, &zero_timeout);
+    ok(ret == SOCKET_ERROR, "got %d\n", ret);
+    ok(WSAGetLastError() == WSAENOTSOCK, "got error %d\n", WSAGetLastError());
+
+    for (i = 0; i < sizeof(sockets) / sizeof(sockets[0]); i++)
+        if (i != 3) closesocket(sockets[i]);
+    closesocket(src);
+}
 #undef FD_SET_ALL
 #undef FD_ZERO_ALL
 
@@ -11486,6 +11550,114 @@ static void test_iocp(void)
     closesocket(dst);
 }
 
+static void test_udp_overlapped_recv(void)
+{
+    enum { WINDOW = 16 };
+    char data[WINDOW][64], packet[64], small[16];
+    OVERLAPPED ov[WINDOW], *povl;
+    struct sockaddr_in addr;
+    WSABUF bufs[WINDOW];
+    DWORD flags, size;
+    SOCKET src, dst;
+    ULONG_PTR key;
+    HANDLE port;
+    unsigned int i;
+    int ret, len;
+
+    dst = socket(AF_INET, SOCK_DGRAM, 0);
+    ok(dst != INVALID_SOCKET, "socket failed, error %d\n", WSAGetLastError());
+    src = socket(AF_INET, SOCK_DGRAM, 0);
+    ok(src != INVALID_SOCKET, "socket failed, error %d\n", WSAGetLastError());
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    ret = bind(dst, (struct sockaddr *)&addr, sizeof(addr));
+    ok(!ret, "bind failed, error %d\n", WSAGetLastError());
+    len = sizeof(addr);
+    ret = getsockname(dst, (struct sockaddr *)&addr, &len);
+    ok(!ret, "getsockname failed, error %d\n", WSAGetLastError());
+
+    port = CreateIoCompletionPort((HANDLE)dst, NULL, 125, 0);
+    ok(port != NULL, "CreateIoCompletionPort failed, error %u\n", GetLastError());
+
+    /* several pending receives complete in the order they were queued */
+    for (i = 0; i < WINDOW; i++)
+    {
+        memset(&ov[i], 0, sizeof(ov[i]));
+        memset(data[i], 0xcc, sizeof(data[i]));
+        bufs[i].buf = data[i];
+        bufs[i].len = sizeof(data[i]);
+        flags = 0;
+        ret = WSARecvFrom(dst, &bufs[i], 1, NULL, &flags, NULL, NULL, &ov[i], NULL);
+        ok(ret == SOCKET_ERROR && WSAGetLastError() == ERROR_IO_PENDING,
+           "%u: WSARecvFrom returned %d, error %d\n", i, ret, WSAGetLastError());
+    }
+
+    for (i = 0; i < WINDOW; i++)
+    {
+        memset(packet, i, sizeof(packet));
+        ret = sendto(src, packet, sizeof(packet), 0, (struct sockaddr *)&addr, sizeof(addr));
+        ok(ret == sizeof(packet), "%u: sendto returned %d, error %d\n", i, ret, WSAGetLastError());
+    }
+
+    for (i = 0; i < WINDOW; i++)
+    {
+        size = 0xdeadbeef;
+        key = 0xdeadbeef;
+        povl = NULL;
+        ret = GetQueuedCompletionStatus(port, &size, &key, &povl, 1000);
+        ok(ret, "%u: GetQueuedCompletionStatus failed, error %u\n", i, GetLastError());
+        ok(size == sizeof(packet), "%u: got size %u\n", i, size);
+        ok(key == 125, "%u: got key %lu\n", i, key);
+        ok(povl == &ov[i], "%u: got overlapped %p, expected %p\n", i, povl, &ov[i]);
+    }
+
+    for (i = 0; i < WINDOW; i++)
+    {
+        memset(packet, i, sizeof(packet));
+        ok(!memcmp(data[i], packet, sizeof(packet)), "%u: got wrong data\n", i);
+    }
+
+    /* a datagram that doesn't fit in the buffer is truncated */
+    memset(&ov[0], 0, sizeof(ov[0]));
+    memset(small, 0xcc, sizeof(small));
+    bufs[0].buf = small;
+    bufs[0].len = sizeof(small);
+    flags = 0;
+    ret = WSARecvFrom(dst, &bufs[0], 1, NULL, &flags, NULL, NULL, &ov[0], NULL);
+    ok(ret == SOCKET_ERROR && WSAGetLastError() == ERROR_IO_PENDING,
+       "WSARecvFrom returned %d, error %d\n", ret, WSAGetLastError());
+
+    memset(packet, 0x55, sizeof(packet));
+    ret = sendto(src, packet, sizeof(packet), 0, (struct sockaddr *)&addr, sizeof(addr));
+    ok(ret == sizeof(packet), "sendto returned %d, error %d\n", ret, WSAGetLastError());
+
+    size = 0xdeadbeef;
+    povl = NULL;
+    SetLastError(0xdeadbeef);
+    ret = GetQueuedCompletionStatus(port, &size, &key, &povl, 1000);
+    ok(!ret, "GetQueuedCompletionStatus succeeded\n");
+    ok(GetLastError() == ERROR_MORE_DATA, "got error %u\n", GetLastError());
+    ok(size == sizeof(small), "got size %u\n", size);
+    ok(povl == &ov[0], "got overlapped %p, expected %p\n", povl, &ov[0]);
+    ok(!memcmp(small, packet, sizeof(small)), "got wrong data\n");
+
+    ret = sendto(src, packet, sizeof(packet), 0, (struct sockaddr *)&addr, sizeof(addr));
+    ok(ret == sizeof(packet), "sendto returned %d, error %d\n", ret, WSAGetLastError());
+
+    memset(small, 0xcc, sizeof(small));
+    WSASetLastError(0xdeadbeef);
+    ret = recv(dst, small, sizeof(small), 0);
+    ok(ret == SOCKET_ERROR, "recv returned %d\n", ret);
+    ok(WSAGetLastError() == WSAEMSGSIZE, "got error %d\n", WSAGetLastError());
+    ok(!memcmp(small, packet, sizeof(small)), "got wrong data\n");
+
+    closesocket(src);
+    closesocket(dst);
+    CloseHandle(port);
+}
+
 START_TEST( sock )
 {
     int i;
@@ -11527,6 +11699,7 @@ START_TEST( sock )
     test_errors();
     test_listen();
     test_select();
+    test_select_many();
     test_accept();
     test_getpeername();
     test_getsockname();
@@ -11573,6 +11746,7 @@ START_TEST( sock )
     /* this is an io heavy test, do it at the end so the kernel doesn't start dropping packets */
     test_send();
     test_synchronous_WSAIoctl();
+    test_udp_overlapped_recv();
 
     Exit();
 }
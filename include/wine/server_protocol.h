@@ -707,6 +707,52 @@ typedef struct
 #define IMAGE_FLAGS_ImageMappedFlat           0x08
 #define IMAGE_FLAGS_BaseBelow4gb              0x10
 
+
+typedef struct
+{
+    unsigned int   seq;
+    unsigned int   wake_bits;
+    unsigned int   changed_bits;
+    unsigned int   wake_mask;
+    unsigned int   changed_mask;
+    unsigned int   idle;
+} queue_shm_t;
+
+
+typedef struct
+{
+    unsigned int   seq;
+    int            cursor_x;
+    int            cursor_y;
+    unsigned int   cursor_last_change;
+    unsigned char  keystate[256];
+} desktop_shm_t;
+
+
+typedef struct
+{
+    unsigned int   seq;
+    user_handle_t  handle;
+    user_handle_t  parent;
+    user_handle_t  owner;
+    unsigned int   style;
+    unsigned int   ex_style;
+    unsigned int   id;
+    unsigned int   flags;
+    rectangle_t    window_rect;
+    rectangle_t    client_rect;
+} window_shm_t;
+#define WINDOW_SHM_DESKTOP  0x01
+
+struct completion_msg
+{
+    apc_param_t   ckey;
+    apc_param_t   cvalue;
+    apc_param_t   information;
+    unsigned int  status;
+    unsigned int  __pad;
+};
+
 struct rawinput_device
 {
     unsigned short usage_page;
@@ -2277,6 +2323,36 @@ struct map_view_reply
 
 
 
+struct get_image_relocation_request
+{
+    struct request_header __header;
+    obj_handle_t mapping;
+    client_ptr_t base;
+};
+struct get_image_relocation_reply
+{
+    struct reply_header __header;
+    obj_handle_t file;
+    int          wanted;
+};
+
+
+
+struct publish_image_relocation_request
+{
+    struct request_header __header;
+    obj_handle_t mapping;
+    client_ptr_t base;
+    obj_handle_t copy;
+    char __pad_28[4];
+};
+struct publish_image_relocation_reply
+{
+    struct reply_header __header;
+};
+
+
+
 struct unmap_view_request
 {
     struct request_header __header;
@@ -2984,6 +3060,20 @@ struct get_msg_queue_reply
 
 
 
+struct get_queue_shared_memory_request
+{
+    struct request_header __header;
+    char __pad_12[4];
+};
+struct get_queue_shared_memory_reply
+{
+    struct reply_header __header;
+    obj_handle_t handle;
+    char __pad_12[4];
+};
+
+
+
 struct set_queue_fd_request
 {
     struct request_header __header;
@@ -3108,6 +3198,28 @@ struct send_hardware_message_reply
 
 
 
+struct send_hardware_messages_request
+{
+    struct request_header __header;
+    user_handle_t   win;
+    unsigned int    flags;
+    /* VARARG(inputs,hw_inputs); */
+    char __pad_20[4];
+};
+struct send_hardware_messages_reply
+{
+    struct reply_header __header;
+    unsigned int    count;
+    int             wait;
+    int             prev_x;
+    int             prev_y;
+    int             new_x;
+    int             new_y;
+    /* VARARG(keystate,bytes); */
+};
+
+
+
 struct get_message_request
 {
     struct request_header __header;
@@ -3694,6 +3806,20 @@ enum coords_relative
 
 
 
+struct get_window_shared_memory_request
+{
+    struct request_header __header;
+    char __pad_12[4];
+};
+struct get_window_shared_memory_reply
+{
+    struct reply_header __header;
+    obj_handle_t   handle;
+    char __pad_12[4];
+};
+
+
+
 struct get_window_text_request
 {
     struct request_header __header;
@@ -4105,6 +4231,20 @@ struct set_thread_desktop_reply
 
 
 
+struct get_desktop_shared_memory_request
+{
+    struct request_header __header;
+    char __pad_12[4];
+};
+struct get_desktop_shared_memory_reply
+{
+    struct reply_header __header;
+    obj_handle_t handle;
+    char __pad_12[4];
+};
+
+
+
 struct enum_desktop_request
 {
     struct request_header __header;
@@ -5321,6 +5461,19 @@ struct remove_completion_reply
 
 
 
+struct remove_completions_request
+{
+    struct request_header __header;
+    obj_handle_t handle;
+};
+struct remove_completions_reply
+{
+    struct reply_header __header;
+    /* VARARG(msgs,completion_msgs); */
+};
+
+
+
 struct query_completion_request
 {
     struct request_header __header;
@@ -5499,6 +5652,21 @@ struct update_rawinput_devices_reply
 
 
 
+struct get_rawinput_buffer_request
+{
+    struct request_header __header;
+    int             remove;
+};
+struct get_rawinput_buffer_reply
+{
+    struct reply_header __header;
+    unsigned int    count;
+    /* VARARG(data,hw_msg_data); */
+    char __pad_12[4];
+};
+
+
+
 struct get_suspend_context_request
 {
     struct request_header __header;
@@ -5716,6 +5884,8 @@ enum request
     REQ_open_mapping,
     REQ_get_mapping_info,
     REQ_map_view,
+    REQ_get_image_relocation,
+    REQ_publish_image_relocation,
     REQ_unmap_view,
     REQ_get_mapping_committed_range,
     REQ_add_mapping_committed_range,
@@ -5761,6 +5931,7 @@ enum request
     REQ_empty_atom_table,
     REQ_init_atom_table,
     REQ_get_msg_queue,
+    REQ_get_queue_shared_memory,
     REQ_set_queue_fd,
     REQ_set_queue_mask,
     REQ_get_queue_status,
@@ -5768,6 +5939,7 @@ enum request
     REQ_send_message,
     REQ_post_quit_message,
     REQ_send_hardware_message,
+    REQ_send_hardware_messages,
     REQ_get_message,
     REQ_reply_message,
     REQ_accept_hardware_message,
@@ -5800,6 +5972,7 @@ enum request
     REQ_get_window_tree,
     REQ_set_window_pos,
     REQ_get_window_rectangles,
+    REQ_get_window_shared_memory,
     REQ_get_window_text,
     REQ_set_window_text,
     REQ_get_windows_offset,
@@ -5826,6 +5999,7 @@ enum request
     REQ_close_desktop,
     REQ_get_thread_desktop,
     REQ_set_thread_desktop,
+    REQ_get_desktop_shared_memory,
     REQ_enum_desktop,
     REQ_set_user_object_info,
     REQ_register_hotkey,
@@ -5898,6 +6072,7 @@ enum request
     REQ_open_completion,
     REQ_add_completion,
     REQ_remove_completion,
+    REQ_remove_completions,
     REQ_query_completion,
     REQ_set_completion_info,
     REQ_add_fd_completion,
@@ -5909,6 +6084,7 @@ enum request
     REQ_free_user_handle,
     REQ_set_cursor,
     REQ_update_rawinput_devices,
+    REQ_get_rawinput_buffer,
     REQ_get_suspend_context,
     REQ_set_suspend_context,
     REQ_create_job,
@@ -6012,6 +6188,8 @@ union generic_request
     struct open_mapping_request open_mapping_request;
     struct get_mapping_info_request get_mapping_info_request;
     struct map_view_request map_view_request;
+    struct get_image_relocation_request get_image_relocation_request;
+    struct publish_image_relocation_request publish_image_relocation_request;
     struct unmap_view_request unmap_view_request;
     struct get_mapping_committed_range_request get_mapping_committed_range_request;
     struct add_mapping_committed_range_request add_mapping_committed_range_request;
@@ -6057,6 +6235,7 @@ union generic_request
     struct empty_atom_table_request empty_atom_table_request;
     struct init_atom_table_request init_atom_table_request;
     struct get_msg_queue_request get_msg_queue_request;
+    struct get_queue_shared_memory_request get_queue_shared_memory_request;
     struct set_queue_fd_request set_queue_fd_request;
     struct set_queue_mask_request set_queue_mask_request;
     struct get_queue_status_request get_queue_status_request;
@@ -6064,6 +6243,7 @@ union generic_request
     struct send_message_request send_message_request;
     struct post_quit_message_request post_quit_message_request;
     struct send_hardware_message_request send_hardware_message_request;
+    struct send_hardware_messages_request send_hardware_messages_request;
     struct get_message_request get_message_request;
     struct reply_message_request reply_message_request;
     struct accept_hardware_message_request accept_hardware_message_request;
@@ -6096,6 +6276,7 @@ union generic_request
     struct get_window_tree_request get_window_tree_request;
     struct set_window_pos_request set_window_pos_request;
     struct get_window_rectangles_request get_window_rectangles_request;
+    struct get_window_shared_memory_request get_window_shared_memory_request;
     struct get_window_text_request get_window_text_request;
     struct set_window_text_request set_window_text_request;
     struct get_windows_offset_request get_windows_offset_request;
@@ -6122,6 +6303,7 @@ union generic_request
     struct close_desktop_request close_desktop_request;
     struct get_thread_desktop_request get_thread_desktop_request;
     struct set_thread_desktop_request set_thread_desktop_request;
+    struct get_desktop_shared_memory_request get_desktop_shared_memory_request;
     struct enum_desktop_request enum_desktop_request;
     struct set_user_object_info_request set_user_object_info_request;
     struct register_hotkey_request register_hotkey_request;
@@ -6194,6 +6376,7 @@ union generic_request
     struct open_completion_request open_completion_request;
     struct add_completion_request add_completion_request;
     struct remove_completion_request remove_completion_request;
+    struct remove_completions_request remove_completions_request;
     struct query_completion_request query_completion_request;
     struct set_completion_info_request set_completion_info_request;
     struct add_fd_completion_request add_fd_completion_request;
@@ -6205,6 +6388,7 @@ union generic_request
     struct free_user_handle_request free_user_handle_request;
     struct set_cursor_request set_cursor_request;
     struct update_rawinput_devices_request update_rawinput_devices_request;
+    struct get_rawinput_buffer_request get_rawinput_buffer_request;
     struct get_suspend_context_request get_suspend_context_request;
     struct set_suspend_context_request set_suspend_context_request;
     struct create_job_request create_job_request;
@@ -6306,6 +6490,8 @@ union generic_reply
     struct open_mapping_reply open_mapping_reply;
     struct get_mapping_info_reply get_mapping_info_reply;
     struct map_view_reply map_view_reply;
+    struct get_image_relocation_reply get_image_relocation_reply;
+    struct publish_image_relocation_reply publish_image_relocation_reply;
     struct unmap_view_reply unmap_view_reply;
     struct get_mapping_committed_range_reply get_mapping_committed_range_reply;
     struct add_mapping_committed_range_reply add_mapping_committed_range_reply;
@@ -6351,6 +6537,7 @@ union generic_reply
     struct empty_atom_table_reply empty_atom_table_reply;
     struct init_atom_table_reply init_atom_table_reply;
     struct get_msg_queue_reply get_msg_queue_reply;
+    struct get_queue_shared_memory_reply get_queue_shared_memory_reply;
     struct set_queue_fd_reply set_queue_fd_reply;
     struct set_queue_mask_reply set_queue_mask_reply;
     struct get_queue_status_reply get_queue_status_reply;
@@ -6358,6 +6545,7 @@ union generic_reply
     struct send_message_reply send_message_reply;
     struct post_quit_message_reply post_quit_message_reply;
     struct send_hardware_message_reply send_hardware_message_reply;
+    struct send_hardware_messages_reply send_hardware_messages_reply;
     struct get_message_reply get_message_reply;
     struct reply_message_reply reply_message_reply;
     struct accept_hardware_message_reply accept_hardware_message_reply;
@@ -6390,6 +6578,7 @@ union generic_reply
     struct get_window_tree_reply get_window_tree_reply;
     struct set_window_pos_reply set_window_pos_reply;
     struct get_window_rectangles_reply get_window_rectangles_reply;
+    struct get_window_shared_memory_reply get_window_shared_memory_reply;
     struct get_window_text_reply get_window_text_reply;
     struct set_window_text_reply set_window_text_reply;
     struct get_windows_offset_reply get_windows_offset_reply;
@@ -6416,6 +6605,7 @@ union generic_reply
     struct close_desktop_reply close_desktop_reply;
     struct get_thread_desktop_reply get_thread_desktop_reply;
     struct set_thread_desktop_reply set_thread_desktop_reply;
+    struct get_desktop_shared_memory_reply get_desktop_shared_memory_reply;
     struct enum_desktop_reply enum_desktop_reply;
     struct set_user_object_info_reply set_user_object_info_reply;
     struct register_hotkey_reply register_hotkey_reply;
@@ -6488,6 +6678,7 @@ union generic_reply
     struct open_completion_reply open_completion_reply;
     struct add_completion_reply add_completion_reply;
     struct remove_completion_reply remove_completion_reply;
+    struct remove_completions_reply remove_completions_reply;
     struct query_completion_reply query_completion_reply;
     struct set_completion_info_reply set_completion_info_reply;
     struct add_fd_completion_reply add_fd_completion_reply;
@@ -6499,6 +6690,7 @@ union generic_reply
     struct free_user_handle_reply free_user_handle_reply;
     struct set_cursor_reply set_cursor_reply;
     struct update_rawinput_devices_reply update_rawinput_devices_reply;
+    struct get_rawinput_buffer_reply get_rawinput_buffer_reply;
     struct get_suspend_context_reply get_suspend_context_reply;
     struct set_suspend_context_reply set_suspend_context_reply;
     struct create_job_reply create_job_reply;
@@ -6510,6 +6702,6 @@ union generic_reply
     struct terminate_job_reply terminate_job_reply;
 };
 
-#define SERVER_PROTOCOL_VERSION 553
+#define SERVER_PROTOCOL_VERSION 562
 
 #endif /* __WINE_WINE_SERVER_PROTOCOL_H */
@@ -104,6 +104,7 @@
 
 #include "winternl.h"
 #include "winioctl.h"
+#include "wine/rbtree.h"
 
 #if defined(HAVE_SYS_EPOLL_H) && defined(HAVE_EPOLL_CREATE)
 # include <sys/epoll.h>
@@ -358,13 +359,28 @@ static file_pos_t max_unix_offset = OFF_T_MAX;
 
 struct timeout_user
 {
-    struct list           entry;      /* entry in sorted timeout list */
+    struct wine_rb_entry  entry;      /* entry in sorted timeouts tree */
+    struct list           expired;    /* entry in expired list while the callbacks are called */
+    int                   is_expired; /* has it been moved to the expired list? */
     timeout_t             when;       /* timeout expiry (absolute time) */
+    unsigned int          seq;        /* insertion sequence number */
     timeout_callback      callback;   /* callback function */
     void                 *private;    /* callback private data */
 };
 
-static struct list timeout_list = LIST_INIT(timeout_list);   /* sorted timeouts list */
+/* sort timeouts by expiry, and the most recently added first for the same expiry */
+static int compare_timeouts( const void *key, const struct wine_rb_entry *entry )
+{
+    const struct timeout_user *timeout = key;
+    const struct timeout_user *other = WINE_RB_ENTRY_VALUE( entry, const struct timeout_user, entry );
+
+    if (timeout->when != other->when) return timeout->when < other->when ? -1 : 1;
+    if (timeout->seq != other->seq) return timeout->seq > other->seq ? -1 : 1;
+    return 0;
+}
+
+static struct wine_rb_tree timeout_tree = { compare_timeouts };   /* sorted timeouts tree */
+static unsigned int timeout_seq;
 timeout_t current_time;
 
 static inline void set_current_time(void)
@@ -379,28 +395,23 @@ static inline void set_current_time(void)
 struct timeout_user *add_timeout_user( timeout_t when, timeout_callback func, void *private )
 {
     struct timeout_user *user;
-    struct list *ptr;
 
     if (!(user = mem_alloc( sizeof(*user) ))) return NULL;
-    user->when     = (when > 0) ? when : current_time - when;
-    user->callback = func;
-    user->private  = private;
-
-    /* Now insert it in the linked list */
+    user->when       = (when > 0) ? when : current_time - when;
+    user->seq        = timeout_seq++;
+    user->is_expired = 0;
+    user->callback   = func;
+    user->private    = private;
 
-    LIST_FOR_EACH( ptr, &timeout_list )
-    {
-        struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
-        if (timeout->when >= user->when) break;
-    }
-    list_add_before( ptr, &user->entry );
+    wine_rb_put( &timeout_tree, user, &user->entry );
     return user;
 }
 
 /* remove a timeout user */
 void remove_timeout_user( struct timeout_user *user )
 {
-    list_remove( &user->entry );
+    if (user->is_expired) list_remove( &user->expired );
+    else wine_rb_remove( &timeout_tree, &user->entry );
     free( user );
 }
 
@@ -846,21 +857,23 @@ static void remove_poll_user( struct fd *fd, int user )
 /* process pending timeouts and return the time until the next timeout, in milliseconds */
 static int get_next_timeout(void)
 {
-    if (!list_empty( &timeout_list ))
+    if (timeout_tree.root)
     {
         struct list expired_list, *ptr;
+        struct wine_rb_entry *entry;
 
-        /* first remove all expired timers from the list */
+        /* first remove all expired timers from the tree */
 
         list_init( &expired_list );
-        while ((ptr = list_head( &timeout_list )) != NULL)
+        while ((entry = wine_rb_head( timeout_tree.root )) != NULL)
         {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
+            struct timeout_user *timeout = WINE_RB_ENTRY_VALUE( entry, struct timeout_user, entry );
 
             if (timeout->when <= current_time)
             {
-                list_remove( &timeout->entry );
-                list_add_tail( &expired_list, &timeout->entry );
+                wine_rb_remove( &timeout_tree, &timeout->entry );
+                timeout->is_expired = 1;
+                list_add_tail( &expired_list, &timeout->expired );
             }
             else break;
         }
@@ -869,15 +882,15 @@ static int get_next_timeout(void)
 
         while ((ptr = list_head( &expired_list )) != NULL)
         {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
-            list_remove( &timeout->entry );
+            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, expired );
+            list_remove( &timeout->expired );
             timeout->callback( timeout->private );
             free( timeout );
         }
 
-        if ((ptr = list_head( &timeout_list )) != NULL)
+        if ((entry = wine_rb_head( timeout_tree.root )) != NULL)
         {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
+            struct timeout_user *timeout = WINE_RB_ENTRY_VALUE( entry, struct timeout_user, entry );
             int diff = (timeout->when - current_time + 9999) / 10000;
             if (diff < 0) diff = 0;
             return diff;
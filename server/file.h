@@ -156,6 +156,7 @@ extern struct file *get_mapping_file( struct process *process, client_ptr_t base
                                       unsigned int access, unsigned int sharing );
 extern void free_mapped_views( struct process *process );
 extern int get_page_size(void);
+extern struct object *create_shared_mapping( mem_size_t size, void **ptr );
 
 /* device functions */
 
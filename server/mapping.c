@@ -81,12 +81,13 @@ static const struct object_ops ranges_ops =
     ranges_destroy             /* destroy */
 };
 
-/* file backing the shared sections of a PE image mapping */
+/* file backing the shared sections, or the relocated copy, of a PE image mapping */
 struct shared_map
 {
     struct object   obj;             /* object header */
     struct fd      *fd;              /* file descriptor of the mapped PE file */
-    struct file    *file;            /* temp file holding the shared data */
+    struct file    *file;            /* temp file holding the shared data, NULL if not published yet */
+    client_ptr_t    base;            /* base address of the relocated image, 0 for shared sections */
     struct list     entry;           /* entry in global shared maps list */
 };
 
@@ -124,6 +125,7 @@ struct memory_view
     struct fd      *fd;              /* fd for mapped file */
     struct ranges  *committed;       /* list of committed ranges in this mapping */
     struct shared_map *shared;       /* temp file for shared PE mapping */
+    struct shared_map *reloc;        /* relocated copy of the PE image, or demand for one */
     unsigned int    flags;           /* SEC_* flags */
     client_ptr_t    base;            /* view base address (in process addr space) */
     mem_size_t      size;            /* view size */
@@ -139,6 +141,8 @@ struct mapping
     pe_image_info_t image;           /* image info (for PE image mapping) */
     struct ranges  *committed;       /* list of committed ranges in this mapping */
     struct shared_map *shared;       /* temp file for shared PE mapping */
+    struct shared_map *reloc;        /* last relocated copy of the PE image, or demand for one */
+    IMAGE_DATA_DIRECTORY relocs;     /* base relocations directory (for PE image mapping) */
 };
 
 static void mapping_dump( struct object *obj, int verbose );
@@ -205,7 +209,8 @@ static void ranges_destroy( struct object *obj )
 static void shared_map_dump( struct object *obj, int verbose )
 {
     struct shared_map *shared = (struct shared_map *)obj;
-    fprintf( stderr, "Shared mapping fd=%p file=%p\n", shared->fd, shared->file );
+    fprintf( stderr, "Shared mapping fd=%p file=%p base=%08x%08x\n", shared->fd, shared->file,
+             (unsigned int)(shared->base >> 32), (unsigned int)shared->base );
 }
 
 static void shared_map_destroy( struct object *obj )
@@ -213,7 +218,7 @@ static void shared_map_destroy( struct object *obj )
     struct shared_map *shared = (struct shared_map *)obj;
 
     release_object( shared->fd );
-    release_object( shared->file );
+    if (shared->file) release_object( shared->file );
     list_remove( &shared->entry );
 }
 
@@ -313,6 +318,7 @@ static void free_memory_view( struct memory_view *view )
     if (view->fd) release_object( view->fd );
     if (view->committed) release_object( view->committed );
     if (view->shared) release_object( view->shared );
+    if (view->reloc) release_object( view->reloc );
     list_remove( &view->entry );
     free( view );
 }
@@ -332,7 +338,18 @@ static struct shared_map *get_shared_file( struct fd *fd )
     struct shared_map *ptr;
 
     LIST_FOR_EACH_ENTRY( ptr, &shared_map_list, struct shared_map, entry )
-        if (is_same_file_fd( ptr->fd, fd ))
+        if (!ptr->base && is_same_file_fd( ptr->fd, fd ))
+            return (struct shared_map *)grab_object( ptr );
+    return NULL;
+}
+
+/* find the relocated copy of a PE image for a given base address */
+static struct shared_map *get_relocated_file( struct fd *fd, client_ptr_t base )
+{
+    struct shared_map *ptr;
+
+    LIST_FOR_EACH_ENTRY( ptr, &shared_map_list, struct shared_map, entry )
+        if (ptr->base == base && is_same_file_fd( ptr->fd, fd ))
             return (struct shared_map *)grab_object( ptr );
     return NULL;
 }
@@ -511,6 +528,7 @@ static int build_shared_mapping( struct mapping *mapping, int fd,
     if (!(shared = alloc_object( &shared_map_ops ))) goto error;
     shared->fd = (struct fd *)grab_object( mapping->fd );
     shared->file = file;
+    shared->base = 0;
     list_add_head( &shared_map_list, &shared->entry );
     mapping->shared = shared;
     free( buffer );
@@ -612,6 +630,7 @@ static unsigned int get_image_params( struct mapping *mapping, file_pos_t file_s
         }
         clr_va = nt.opt.hdr32.DataDirectory[IMAGE_DIRECTORY_ENTRY_COM_DESCRIPTOR].VirtualAddress;
         clr_size = nt.opt.hdr32.DataDirectory[IMAGE_DIRECTORY_ENTRY_COM_DESCRIPTOR].Size;
+        mapping->relocs = nt.opt.hdr32.DataDirectory[IMAGE_DIRECTORY_ENTRY_BASERELOC];
 
         mapping->image.base           = nt.opt.hdr32.ImageBase;
         mapping->image.entry_point    = nt.opt.hdr32.ImageBase + nt.opt.hdr32.AddressOfEntryPoint;
@@ -650,6 +669,7 @@ static unsigned int get_image_params( struct mapping *mapping, file_pos_t file_s
         }
         clr_va = nt.opt.hdr64.DataDirectory[IMAGE_DIRECTORY_ENTRY_COM_DESCRIPTOR].VirtualAddress;
         clr_size = nt.opt.hdr64.DataDirectory[IMAGE_DIRECTORY_ENTRY_COM_DESCRIPTOR].Size;
+        mapping->relocs = nt.opt.hdr64.DataDirectory[IMAGE_DIRECTORY_ENTRY_BASERELOC];
 
         mapping->image.base           = nt.opt.hdr64.ImageBase;
         mapping->image.entry_point    = nt.opt.hdr64.ImageBase + nt.opt.hdr64.AddressOfEntryPoint;
@@ -771,6 +791,7 @@ static struct object *create_mapping( struct object *root, const struct unicode_
     mapping->size        = size;
     mapping->fd          = NULL;
     mapping->shared      = NULL;
+    mapping->reloc       = NULL;
     mapping->committed   = NULL;
 
     if (!(mapping->flags = get_mapping_flags( handle, flags ))) goto error;
@@ -848,6 +869,26 @@ static struct object *create_mapping( struct object *root, const struct unicode_
     return NULL;
 }
 
+/* create an anonymous mapping shared with the clients, and map it writable in the server */
+struct object *create_shared_mapping( mem_size_t size, void **ptr )
+{
+    static const struct unicode_str empty_str;
+    struct mapping *mapping;
+    int unix_fd;
+
+    if (!(mapping = (struct mapping *)create_mapping( NULL, &empty_str, 0, size, SEC_COMMIT, 0, 0, NULL )))
+        return NULL;
+
+    if ((unix_fd = get_unix_fd( mapping->fd )) != -1)
+    {
+        *ptr = mmap( NULL, mapping->size, PROT_READ | PROT_WRITE, MAP_SHARED, unix_fd, 0 );
+        if (*ptr != MAP_FAILED) return &mapping->obj;
+        file_set_error();
+    }
+    release_object( mapping );
+    return NULL;
+}
+
 struct mapping *get_mapping_obj( struct process *process, obj_handle_t handle, unsigned int access )
 {
     return (struct mapping *)get_handle_obj( process, handle, access, &mapping_ops );
@@ -901,6 +942,7 @@ static void mapping_destroy( struct object *obj )
     if (mapping->fd) release_object( mapping->fd );
     if (mapping->committed) release_object( mapping->committed );
     if (mapping->shared) release_object( mapping->shared );
+    if (mapping->reloc) release_object( mapping->reloc );
 }
 
 static enum server_fd_type mapping_get_fd_type( struct fd *fd )
@@ -1020,6 +1062,8 @@ DECL_HANDLER(map_view)
         view->fd        = !is_fd_removable( mapping->fd ) ? (struct fd *)grab_object( mapping->fd ) : NULL;
         view->committed = mapping->committed ? (struct ranges *)grab_object( mapping->committed ) : NULL;
         view->shared    = mapping->shared ? (struct shared_map *)grab_object( mapping->shared ) : NULL;
+        view->reloc     = (mapping->reloc && mapping->reloc->base == req->base) ?
+                          (struct shared_map *)grab_object( mapping->reloc ) : NULL;
         list_add_tail( &current->process->views, &view->entry );
     }
 
@@ -1027,6 +1071,106 @@ done:
     release_object( mapping );
 }
 
+/* check if the relocated copies of an image mapping can be shared between processes */
+static int is_relocation_shareable( struct mapping *mapping, client_ptr_t base )
+{
+    if (!(mapping->flags & SEC_IMAGE) || (base & page_mask) || base == mapping->image.base)
+    {
+        set_error( STATUS_INVALID_PARAMETER );
+        return 0;
+    }
+    if (mapping->shared || is_fd_removable( mapping->fd ) ||
+        (mapping->image.image_flags & IMAGE_FLAGS_ImageMappedFlat) ||
+        !(mapping->image.image_charact & IMAGE_FILE_DLL) ||
+        (mapping->image.image_charact & IMAGE_FILE_RELOCS_STRIPPED) ||
+        !mapping->relocs.VirtualAddress || !mapping->relocs.Size)
+    {
+        set_error( STATUS_NOT_SUPPORTED );  /* the loader has to handle it */
+        return 0;
+    }
+    return 1;
+}
+
+/* get the copy of an image mapping relocated to a given base, if another process published it */
+DECL_HANDLER(get_image_relocation)
+{
+    struct mapping *mapping;
+    struct shared_map *reloc;
+
+    if (!(mapping = get_mapping_obj( current->process, req->mapping, SECTION_MAP_READ ))) return;
+    if (!is_relocation_shareable( mapping, req->base )) goto done;
+
+    if ((reloc = get_relocated_file( mapping->fd, req->base )))
+    {
+        if (reloc->file) reply->file = alloc_handle( current->process, reloc->file, GENERIC_READ, 0 );
+        else
+        {
+            /* another process asked for it first, this one should publish its copy */
+            reply->wanted = 1;
+            set_error( STATUS_NOT_FOUND );
+        }
+    }
+    else
+    {
+        /* record the demand, copies are only published once a second process needs one */
+        if (!(reloc = alloc_object( &shared_map_ops ))) goto done;
+        reloc->fd   = (struct fd *)grab_object( mapping->fd );
+        reloc->file = NULL;
+        reloc->base = req->base;
+        list_add_head( &shared_map_list, &reloc->entry );
+        set_error( STATUS_NOT_FOUND );
+    }
+    /* the views of this mapping at that base keep the copy, or the demand, alive */
+    if (mapping->reloc) release_object( mapping->reloc );
+    mapping->reloc = reloc;
+
+done:
+    release_object( mapping );
+}
+
+/* publish the copy of an image mapping relocated by the current process */
+DECL_HANDLER(publish_image_relocation)
+{
+    struct mapping *mapping, *copy = NULL;
+    struct memory_view *view;
+    struct shared_map *reloc;
+
+    if (!(mapping = get_mapping_obj( current->process, req->mapping, SECTION_MAP_READ ))) return;
+    if (!(copy = get_mapping_obj( current->process, req->copy, SECTION_MAP_READ ))) goto done;
+    if (!is_relocation_shareable( mapping, req->base )) goto done;
+    if (!(view = find_mapped_view( current->process, req->base ))) goto done;
+
+    if (!view->fd || (view->reloc && view->reloc->file) || !is_same_file_fd( view->fd, mapping->fd ) ||
+        view->size != mapping->image.map_size ||
+        (copy->flags & SEC_IMAGE) || !copy->fd || copy->size < view->size)
+    {
+        set_error( STATUS_INVALID_PARAMETER );
+        goto done;
+    }
+
+    if (!(reloc = get_relocated_file( mapping->fd, req->base )))
+    {
+        if (!(reloc = alloc_object( &shared_map_ops ))) goto done;
+        reloc->fd = (struct fd *)grab_object( mapping->fd );
+        reloc->file = NULL;
+        reloc->base = req->base;
+        list_add_head( &shared_map_list, &reloc->entry );
+    }
+    /* another process may have published it in the meantime */
+    if (!reloc->file && !(reloc->file = create_file_for_fd_obj( copy->fd, FILE_GENERIC_READ, 0 )))
+    {
+        release_object( reloc );
+        goto done;
+    }
+    /* the copy is kept as long as views are using it */
+    if (view->reloc) release_object( view->reloc );
+    view->reloc = reloc;
+
+done:
+    if (copy) release_object( copy );
+    release_object( mapping );
+}
+
 /* unmap a memory view from the current process */
 DECL_HANDLER(unmap_view)
 {
@@ -25,6 +25,9 @@
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
+#ifdef HAVE_SYS_MMAN_H
+# include <sys/mman.h>
+#endif
 #ifdef HAVE_POLL_H
 # include <poll.h>
 #endif
@@ -43,6 +46,7 @@
 #include "process.h"
 #include "request.h"
 #include "user.h"
+#include "wine/rbtree.h"
 
 #define WM_NCMOUSEFIRST WM_NCMOUSEMOVE
 #define WM_NCMOUSELAST  (WM_NCMOUSEFIRST+(WM_MOUSELAST-WM_MOUSEFIRST))
@@ -88,7 +92,11 @@ struct message
 
 struct timer
 {
-    struct list     entry;     /* entry in timer list */
+    struct wine_rb_entry entry;    /* entry in pending timers tree, sorted by expiration */
+    struct wine_rb_entry id_entry; /* entry in timers tree, sorted by window, message and id */
+    struct list     expired;   /* entry in expired timers list */
+    int             is_expired; /* is it on the expired timers list? */
+    unsigned int    seq;       /* sequence number, to sort timers with the same expiration */
     timeout_t       when;      /* next expiration */
     unsigned int    rate;      /* timer rate in ms */
     user_handle_t   win;       /* window handle */
@@ -97,6 +105,29 @@ struct timer
     lparam_t        lparam;    /* lparam for message */
 };
 
+/* sort pending timers by expiration, and the most recently set first for the same expiration */
+static int compare_pending_timers( const void *key, const struct wine_rb_entry *entry )
+{
+    const struct timer *timer = key;
+    const struct timer *other = WINE_RB_ENTRY_VALUE( entry, const struct timer, entry );
+
+    if (timer->when != other->when) return timer->when < other->when ? -1 : 1;
+    if (timer->seq != other->seq) return timer->seq > other->seq ? -1 : 1;
+    return 0;
+}
+
+/* sort timers by window, message and id */
+static int compare_timer_ids( const void *key, const struct wine_rb_entry *entry )
+{
+    const struct timer *timer = key;
+    const struct timer *other = WINE_RB_ENTRY_VALUE( entry, const struct timer, id_entry );
+
+    if (timer->win != other->win) return timer->win < other->win ? -1 : 1;
+    if (timer->msg != other->msg) return timer->msg < other->msg ? -1 : 1;
+    if (timer->id != other->id) return timer->id < other->id ? -1 : 1;
+    return 0;
+}
+
 struct thread_input
 {
     struct object          obj;           /* object header */
@@ -133,13 +164,17 @@ struct msg_queue
     struct list            send_result;     /* stack of sent messages waiting for result */
     struct list            callback_result; /* list of callback messages waiting for result */
     struct message_result *recv_result;     /* stack of received messages waiting for result */
-    struct list            pending_timers;  /* list of pending timers */
+    struct wine_rb_tree    pending_timers;  /* tree of pending timers, sorted by expiration */
     struct list            expired_timers;  /* list of expired timers */
+    struct wine_rb_tree    timers;          /* tree of all timers, sorted by window, message and id */
     lparam_t               next_timer_id;   /* id for the next timer with a 0 window */
     struct timeout_user   *timeout;         /* timeout for next timer to expire */
     struct thread_input   *input;           /* thread input descriptor */
     struct hook_table     *hooks;           /* hook table */
     timeout_t              last_get_msg;    /* time of last get message call */
+    int                    idle_signaled;   /* has signaled the process idle event */
+    struct object         *shm_mapping;     /* mapping for the shared memory */
+    volatile queue_shm_t  *shm;             /* state published in shared memory */
 };
 
 struct hotkey
@@ -298,10 +333,14 @@ static struct msg_queue *create_msg_queue( struct thread *thread, struct thread_
         queue->input           = (struct thread_input *)grab_object( input );
         queue->hooks           = NULL;
         queue->last_get_msg    = current_time;
+        queue->idle_signaled   = 0;
+        queue->shm_mapping     = NULL;
+        queue->shm             = NULL;
         list_init( &queue->send_result );
         list_init( &queue->callback_result );
-        list_init( &queue->pending_timers );
+        wine_rb_init( &queue->pending_timers, compare_pending_timers );
         list_init( &queue->expired_timers );
+        wine_rb_init( &queue->timers, compare_timer_ids );
         for (i = 0; i < NB_MSG_KINDS; i++) list_init( &queue->msg_list[i] );
 
         thread->queue = queue;
@@ -367,6 +406,19 @@ static void set_cursor_pos( struct desktop *desktop, int x, int y )
     queue_hardware_message( desktop, msg, 1 );
 }
 
+/* publish the cursor position in the desktop shared memory */
+static void update_shared_cursor( struct desktop *desktop )
+{
+    volatile desktop_shm_t *shm = desktop->shm;
+
+    /* the client retries reading while the sequence number is odd or has changed */
+    interlocked_xchg_add( (int *)&shm->seq, 1 );
+    shm->cursor_x           = desktop->cursor.x;
+    shm->cursor_y           = desktop->cursor.y;
+    shm->cursor_last_change = desktop->cursor.last_change;
+    interlocked_xchg_add( (int *)&shm->seq, 1 );
+}
+
 /* retrieve default position and time for synthesized messages */
 static void get_message_defaults( struct msg_queue *queue, int *x, int *y, unsigned int *time )
 {
@@ -435,11 +487,42 @@ static inline int is_signaled( struct msg_queue *queue )
     return ((queue->wake_bits & queue->wake_mask) || (queue->changed_bits & queue->changed_mask));
 }
 
+/* publish the queue bits and masks in the shared memory */
+static void update_shared_queue( struct msg_queue *queue )
+{
+    volatile queue_shm_t *shm = queue->shm;
+
+    if (!shm) return;
+    if (shm->wake_bits == queue->wake_bits && shm->changed_bits == queue->changed_bits &&
+        shm->wake_mask == queue->wake_mask && shm->changed_mask == queue->changed_mask &&
+        shm->idle == queue->idle_signaled)
+        return;
+
+    /* the client retries reading while the sequence number is odd or has changed */
+    interlocked_xchg_add( (int *)&shm->seq, 1 );
+    shm->wake_bits    = queue->wake_bits;
+    shm->changed_bits = queue->changed_bits;
+    shm->wake_mask    = queue->wake_mask;
+    shm->changed_mask = queue->changed_mask;
+    shm->idle         = queue->idle_signaled;
+    interlocked_xchg_add( (int *)&shm->seq, 1 );
+}
+
+/* signal the process idle event, the client keeps sending get_message requests until it is done */
+static void set_idle_event( struct msg_queue *queue, struct process *process )
+{
+    if (process->idle_event) set_event( process->idle_event );
+    if (queue->idle_signaled) return;
+    queue->idle_signaled = 1;
+    update_shared_queue( queue );
+}
+
 /* set some queue bits */
 static inline void set_queue_bits( struct msg_queue *queue, unsigned int bits )
 {
     queue->wake_bits |= bits;
     queue->changed_bits |= bits;
+    update_shared_queue( queue );
     if (is_signaled( queue )) wake_up( &queue->obj, 0 );
 }
 
@@ -448,6 +531,7 @@ static inline void clear_queue_bits( struct msg_queue *queue, unsigned int bits
 {
     queue->wake_bits &= ~bits;
     queue->changed_bits &= ~bits;
+    update_shared_queue( queue );
 }
 
 /* check whether msg is a keyboard message */
@@ -911,7 +995,7 @@ static int msg_queue_add_queue( struct object *obj, struct wait_queue_entry *ent
         set_error( STATUS_ACCESS_DENIED );
         return 0;
     }
-    if (process->idle_event && !(queue->wake_mask & QS_SMRESULT)) set_event( process->idle_event );
+    if (!(queue->wake_mask & QS_SMRESULT)) set_idle_event( queue, process );
 
     if (queue->fd && list_empty( &obj->wait_queue ))  /* first on the queue */
         set_fd_events( queue->fd, POLLIN );
@@ -957,13 +1041,14 @@ static void msg_queue_satisfied( struct object *obj, struct wait_queue_entry *en
     struct msg_queue *queue = (struct msg_queue *)obj;
     queue->wake_mask = 0;
     queue->changed_mask = 0;
+    update_shared_queue( queue );
 }
 
 static void msg_queue_destroy( struct object *obj )
 {
     struct msg_queue *queue = (struct msg_queue *)obj;
-    struct list *ptr;
     struct hotkey *hotkey, *hotkey2;
+    struct timer *timer, *next_timer;
     int i;
 
     cleanup_results( queue );
@@ -978,23 +1063,15 @@ static void msg_queue_destroy( struct object *obj )
         }
     }
 
-    while ((ptr = list_head( &queue->pending_timers )))
-    {
-        struct timer *timer = LIST_ENTRY( ptr, struct timer, entry );
-        list_remove( &timer->entry );
-        free( timer );
-    }
-    while ((ptr = list_head( &queue->expired_timers )))
-    {
-        struct timer *timer = LIST_ENTRY( ptr, struct timer, entry );
-        list_remove( &timer->entry );
+    WINE_RB_FOR_EACH_ENTRY_DESTRUCTOR( timer, next_timer, &queue->timers, struct timer, id_entry )
         free( timer );
-    }
     if (queue->timeout) remove_timeout_user( queue->timeout );
     queue->input->cursor_count -= queue->cursor_count;
     release_object( queue->input );
     if (queue->hooks) release_object( queue->hooks );
     if (queue->fd) release_object( queue->fd );
+    if (queue->shm) munmap( (void *)queue->shm, sizeof(*queue->shm) );
+    if (queue->shm_mapping) release_object( queue->shm_mapping );
 }
 
 static void msg_queue_poll_event( struct fd *fd, int event )
@@ -1131,16 +1208,16 @@ void detach_thread_input( struct thread *thread_from )
 /* set the next timer to expire */
 static void set_next_timer( struct msg_queue *queue )
 {
-    struct list *ptr;
+    struct wine_rb_entry *entry;
 
     if (queue->timeout)
     {
         remove_timeout_user( queue->timeout );
         queue->timeout = NULL;
     }
-    if ((ptr = list_head( &queue->pending_timers )))
+    if ((entry = wine_rb_head( queue->pending_timers.root )))
     {
-        struct timer *timer = LIST_ENTRY( ptr, struct timer, entry );
+        struct timer *timer = WINE_RB_ENTRY_VALUE( entry, struct timer, entry );
         queue->timeout = add_timeout_user( timer->when, timer_callback, queue );
     }
     /* set/clear QS_TIMER bit */
@@ -1154,54 +1231,47 @@ static void set_next_timer( struct msg_queue *queue )
 static struct timer *find_timer( struct msg_queue *queue, user_handle_t win,
                                  unsigned int msg, lparam_t id )
 {
-    struct list *ptr;
+    struct wine_rb_entry *entry;
+    struct timer key;
 
-    /* we need to search both lists */
-
-    LIST_FOR_EACH( ptr, &queue->pending_timers )
-    {
-        struct timer *timer = LIST_ENTRY( ptr, struct timer, entry );
-        if (timer->win == win && timer->msg == msg && timer->id == id) return timer;
-    }
-    LIST_FOR_EACH( ptr, &queue->expired_timers )
-    {
-        struct timer *timer = LIST_ENTRY( ptr, struct timer, entry );
-        if (timer->win == win && timer->msg == msg && timer->id == id) return timer;
-    }
-    return NULL;
+    key.win = win;
+    key.msg = msg;
+    key.id  = id;
+    if (!(entry = wine_rb_get( &queue->timers, &key ))) return NULL;
+    return WINE_RB_ENTRY_VALUE( entry, struct timer, id_entry );
 }
 
 /* callback for the next timer expiration */
 static void timer_callback( void *private )
 {
     struct msg_queue *queue = private;
-    struct list *ptr;
+    struct timer *timer;
 
     queue->timeout = NULL;
     /* move on to the next timer */
-    ptr = list_head( &queue->pending_timers );
-    list_remove( ptr );
-    list_add_tail( &queue->expired_timers, ptr );
+    timer = WINE_RB_ENTRY_VALUE( wine_rb_head( queue->pending_timers.root ), struct timer, entry );
+    wine_rb_remove( &queue->pending_timers, &timer->entry );
+    timer->is_expired = 1;
+    list_add_tail( &queue->expired_timers, &timer->expired );
     set_next_timer( queue );
 }
 
-/* link a timer at its rightful place in the queue list */
+/* link a timer at its rightful place in the queue pending timers */
 static void link_timer( struct msg_queue *queue, struct timer *timer )
 {
-    struct list *ptr;
+    static unsigned int timer_seq;
 
-    for (ptr = queue->pending_timers.next; ptr != &queue->pending_timers; ptr = ptr->next)
-    {
-        struct timer *t = LIST_ENTRY( ptr, struct timer, entry );
-        if (t->when >= timer->when) break;
-    }
-    list_add_before( ptr, &timer->entry );
+    timer->seq = timer_seq++;
+    timer->is_expired = 0;
+    wine_rb_put( &queue->pending_timers, timer, &timer->entry );
 }
 
-/* remove a timer from the queue timer list and free it */
+/* remove a timer from the queue timer lists and free it */
 static void free_timer( struct msg_queue *queue, struct timer *timer )
 {
-    list_remove( &timer->entry );
+    if (timer->is_expired) list_remove( &timer->expired );
+    else wine_rb_remove( &queue->pending_timers, &timer->entry );
+    wine_rb_remove( &queue->timers, &timer->id_entry );
     free( timer );
     set_next_timer( queue );
 }
@@ -1209,7 +1279,7 @@ static void free_timer( struct msg_queue *queue, struct timer *timer )
 /* restart an expired timer */
 static void restart_timer( struct msg_queue *queue, struct timer *timer )
 {
-    list_remove( &timer->entry );
+    list_remove( &timer->expired );
     while (timer->when <= current_time) timer->when += (timeout_t)timer->rate * 10000;
     link_timer( queue, timer );
     set_next_timer( queue );
@@ -1220,11 +1290,10 @@ static struct timer *find_expired_timer( struct msg_queue *queue, user_handle_t
                                          unsigned int get_first, unsigned int get_last,
                                          int remove )
 {
-    struct list *ptr;
+    struct timer *timer;
 
-    LIST_FOR_EACH( ptr, &queue->expired_timers )
+    LIST_FOR_EACH_ENTRY( timer, &queue->expired_timers, struct timer, expired )
     {
-        struct timer *timer = LIST_ENTRY( ptr, struct timer, entry );
         if (win && timer->win != win) continue;
         if (check_msg_filter( timer->msg, get_first, get_last ))
         {
@@ -1236,16 +1305,22 @@ static struct timer *find_expired_timer( struct msg_queue *queue, user_handle_t
 }
 
 /* add a timer */
-static struct timer *set_timer( struct msg_queue *queue, unsigned int rate )
+static struct timer *set_timer( struct msg_queue *queue, unsigned int rate, user_handle_t win,
+                                unsigned int msg, lparam_t id, lparam_t lparam )
 {
     struct timer *timer = mem_alloc( sizeof(*timer) );
     if (timer)
     {
-        timer->rate = max( rate, 1 );
-        timer->when = current_time + (timeout_t)timer->rate * 10000;
+        timer->rate   = max( rate, 1 );
+        timer->when   = current_time + (timeout_t)timer->rate * 10000;
+        timer->win    = win;
+        timer->msg    = msg;
+        timer->id     = id;
+        timer->lparam = lparam;
+        wine_rb_put( &queue->timers, timer, &timer->id_entry );
         link_timer( queue, timer );
         /* check if we replaced the next timer */
-        if (list_head( &queue->pending_timers ) == &timer->entry) set_next_timer( queue );
+        if (wine_rb_head( queue->pending_timers.root ) == &timer->entry) set_next_timer( queue );
     }
     return timer;
 }
@@ -1495,6 +1570,7 @@ static void queue_hardware_message( struct desktop *desktop, struct message *msg
             desktop->cursor.x = x;
             desktop->cursor.y = y;
             desktop->cursor.last_change = get_tick_count();
+            update_shared_cursor( desktop );
         }
         if (desktop->keystate[VK_LBUTTON] & 0x80)  msg->wparam |= MK_LBUTTON;
         if (desktop->keystate[VK_MBUTTON] & 0x80)  msg->wparam |= MK_MBUTTON;
@@ -1611,6 +1687,7 @@ static int queue_mouse_message( struct desktop *desktop, user_handle_t win, cons
     };
 
     desktop->cursor.last_change = get_tick_count();
+    update_shared_cursor( desktop );
     flags = input->mouse.flags;
     time  = input->mouse.time;
     if (!time) time = desktop->cursor.last_change;
@@ -2033,28 +2110,20 @@ void inc_queue_paint_count( struct thread *thread, int incr )
 void queue_cleanup_window( struct thread *thread, user_handle_t win )
 {
     struct msg_queue *queue = thread->queue;
-    struct list *ptr;
+    struct wine_rb_entry *entry;
     int i;
 
     if (!queue) return;
 
     /* remove timers */
 
-    ptr = list_head( &queue->pending_timers );
-    while (ptr)
+    entry = wine_rb_head( queue->timers.root );
+    while (entry)
     {
-        struct list *next = list_next( &queue->pending_timers, ptr );
-        struct timer *timer = LIST_ENTRY( ptr, struct timer, entry );
+        struct wine_rb_entry *next = wine_rb_next( entry );
+        struct timer *timer = WINE_RB_ENTRY_VALUE( entry, struct timer, id_entry );
         if (timer->win == win) free_timer( queue, timer );
-        ptr = next;
-    }
-    ptr = list_head( &queue->expired_timers );
-    while (ptr)
-    {
-        struct list *next = list_next( &queue->expired_timers, ptr );
-        struct timer *timer = LIST_ENTRY( ptr, struct timer, entry );
-        if (timer->win == win) free_timer( queue, timer );
-        ptr = next;
+        entry = next;
     }
 
     /* remove messages */
@@ -2247,6 +2316,24 @@ DECL_HANDLER(set_queue_fd)
 }
 
 
+/* get a handle to the shared memory of the current message queue */
+DECL_HANDLER(get_queue_shared_memory)
+{
+    struct msg_queue *queue = get_current_queue();
+    void *ptr;
+
+    if (!queue) return;
+
+    if (!queue->shm_mapping)
+    {
+        if (!(queue->shm_mapping = create_shared_mapping( sizeof(*queue->shm), &ptr ))) return;
+        queue->shm = ptr;
+        update_shared_queue( queue );
+    }
+    reply->handle = alloc_handle( current->process, queue->shm_mapping, SECTION_MAP_READ | SECTION_QUERY, 0 );
+}
+
+
 /* set the current message queue wakeup mask */
 DECL_HANDLER(set_queue_mask)
 {
@@ -2264,6 +2351,7 @@ DECL_HANDLER(set_queue_mask)
             if (req->skip_wait) queue->wake_mask = queue->changed_mask = 0;
             else wake_up( &queue->obj, 0 );
         }
+        update_shared_queue( queue );
     }
 }
 
@@ -2277,6 +2365,7 @@ DECL_HANDLER(get_queue_status)
         reply->wake_bits    = queue->wake_bits;
         reply->changed_bits = queue->changed_bits;
         queue->changed_bits &= ~req->clear_bits;
+        update_shared_queue( queue );
     }
     else reply->wake_bits = reply->changed_bits = 0;
 }
@@ -2362,45 +2451,92 @@ DECL_HANDLER(send_message)
     release_object( thread );
 }
 
-/* send a hardware message to a thread queue */
-DECL_HANDLER(send_hardware_message)
+/* queue a hardware input; return 1 if the sender needs to wait for a reply */
+static int queue_hardware_input( struct desktop *desktop, user_handle_t win, const hw_input_t *input,
+                                 unsigned int flags, struct msg_queue *sender )
 {
-    struct thread *thread = NULL;
+    switch (input->type)
+    {
+    case INPUT_MOUSE:
+        return queue_mouse_message( desktop, win, input, flags, sender );
+    case INPUT_KEYBOARD:
+        return queue_keyboard_message( desktop, win, input, flags, sender );
+    case INPUT_HARDWARE:
+        queue_custom_hardware_message( desktop, win, input );
+        return 0;
+    default:
+        set_error( STATUS_INVALID_PARAMETER );
+        return 0;
+    }
+}
+
+/* get the desktop to send hardware input to, checking the destination window */
+static struct desktop *get_hardware_input_desktop( user_handle_t win )
+{
+    struct thread *thread;
     struct desktop *desktop;
-    struct msg_queue *sender = get_current_queue();
-    data_size_t size = min( 256, get_reply_max_size() );
 
-    if (!(desktop = get_thread_desktop( current, 0 ))) return;
+    if (!(desktop = get_thread_desktop( current, 0 ))) return NULL;
 
-    if (req->win)
+    if (win)
     {
-        if (!(thread = get_window_thread( req->win ))) return;
+        if (!(thread = get_window_thread( win )))
+        {
+            release_object( desktop );
+            return NULL;
+        }
         if (desktop != thread->queue->input->desktop)
         {
             /* don't allow queuing events to a different desktop */
+            release_object( thread );
             release_object( desktop );
-            return;
+            return NULL;
         }
+        release_object( thread );
     }
+    return desktop;
+}
+
+/* send a hardware message to a thread queue */
+DECL_HANDLER(send_hardware_message)
+{
+    struct desktop *desktop;
+    struct msg_queue *sender = get_current_queue();
+    data_size_t size = min( 256, get_reply_max_size() );
+
+    if (!(desktop = get_hardware_input_desktop( req->win ))) return;
+
+    reply->prev_x = desktop->cursor.x;
+    reply->prev_y = desktop->cursor.y;
+    reply->wait = queue_hardware_input( desktop, req->win, &req->input, req->flags, sender );
+    reply->new_x = desktop->cursor.x;
+    reply->new_y = desktop->cursor.y;
+    set_reply_data( desktop->keystate, size );
+    release_object( desktop );
+}
+
+/* send a batch of hardware messages */
+DECL_HANDLER(send_hardware_messages)
+{
+    struct desktop *desktop;
+    struct msg_queue *sender = get_current_queue();
+    const hw_input_t *input = get_req_data();
+    unsigned int i, count = get_req_data_size() / sizeof(*input);
+    data_size_t size = min( 256, get_reply_max_size() );
+
+    if (!(desktop = get_hardware_input_desktop( req->win ))) return;
 
     reply->prev_x = desktop->cursor.x;
     reply->prev_y = desktop->cursor.y;
 
-    switch (req->input.type)
+    /* stop at the first one that needs a reply, the client resends the rest after waiting */
+    for (i = 0; i < count; i++)
     {
-    case INPUT_MOUSE:
-        reply->wait = queue_mouse_message( desktop, req->win, &req->input, req->flags, sender );
-        break;
-    case INPUT_KEYBOARD:
-        reply->wait = queue_keyboard_message( desktop, req->win, &req->input, req->flags, sender );
-        break;
-    case INPUT_HARDWARE:
-        queue_custom_hardware_message( desktop, req->win, &req->input );
-        break;
-    default:
-        set_error( STATUS_INVALID_PARAMETER );
+        reply->wait = queue_hardware_input( desktop, req->win, &input[i], req->flags, sender );
+        if (get_error()) break;
+        reply->count = i + 1;
+        if (reply->wait) break;
     }
-    if (thread) release_object( thread );
 
     reply->new_x = desktop->cursor.x;
     reply->new_y = desktop->cursor.y;
@@ -2452,6 +2588,7 @@ DECL_HANDLER(get_message)
     }
     if (filter & QS_INPUT) queue->changed_bits &= ~QS_INPUT;
     if (filter & QS_PAINT) queue->changed_bits &= ~QS_PAINT;
+    update_shared_queue( queue );
 
     /* then check for posted messages */
     if ((filter & QS_POSTMESSAGE) &&
@@ -2498,14 +2635,14 @@ DECL_HANDLER(get_message)
         reply->wparam = timer->id;
         reply->lparam = timer->lparam;
         get_message_defaults( queue, &reply->x, &reply->y, &reply->time );
-        if (!(req->flags & PM_NOYIELD) && current->process->idle_event)
-            set_event( current->process->idle_event );
+        if (!(req->flags & PM_NOYIELD)) set_idle_event( queue, current->process );
         return;
     }
 
-    if (get_win == -1 && current->process->idle_event) set_event( current->process->idle_event );
+    if (get_win == -1) set_idle_event( queue, current->process );
     queue->wake_mask = req->wake_mask;
     queue->changed_mask = req->changed_mask;
+    update_shared_queue( queue );
     set_error( STATUS_PENDING );  /* FIXME */
 }
 
@@ -2630,14 +2767,7 @@ DECL_HANDLER(set_win_timer)
         }
     }
 
-    if ((timer = set_timer( queue, req->rate )))
-    {
-        timer->win    = win;
-        timer->msg    = req->msg;
-        timer->id     = id;
-        timer->lparam = req->lparam;
-        reply->id     = id;
-    }
+    if (set_timer( queue, req->rate, win, req->msg, id, req->lparam )) reply->id = id;
     if (thread) release_object( thread );
 }
 
@@ -3144,6 +3274,54 @@ DECL_HANDLER(set_cursor)
     reply->last_change = input->desktop->cursor.last_change;
 }
 
+/* retrieve the pending rawinput messages of the current thread */
+DECL_HANDLER(get_rawinput_buffer)
+{
+    struct msg_queue *queue = get_current_queue();
+    struct thread_input *input;
+    struct message *msg, *next;
+    struct hardware_msg_data *data = NULL;
+    unsigned int count = 0, max_count = get_reply_max_size() / sizeof(*data);
+    int remaining = 0;
+
+    if (!queue) return;
+    input = queue->input;
+    if (max_count && !(data = mem_alloc( max_count * sizeof(*data) ))) return;
+
+    LIST_FOR_EACH_ENTRY_SAFE( msg, next, &input->msg_list, struct message, entry )
+    {
+        struct thread *win_thread;
+        unsigned int msg_code;
+
+        if (msg->msg != WM_INPUT) continue;
+
+        /* with attached inputs, leave the messages of other threads to them */
+        find_hardware_message_window( input->desktop, input, msg, &msg_code, &win_thread );
+        if (win_thread != current)
+        {
+            if (win_thread) release_object( win_thread );
+            continue;
+        }
+        release_object( win_thread );
+
+        if (count == max_count)
+        {
+            remaining = 1;
+            break;
+        }
+        memcpy( &data[count++], msg->data, sizeof(*data) );
+        if (!req->remove) continue;
+        list_remove( &msg->entry );
+        free_message( msg );
+    }
+
+    /* only the current queue has been drained */
+    if (req->remove && !remaining) clear_queue_bits( queue, QS_RAWINPUT );
+    reply->count = count;
+    if (count) set_reply_data_ptr( data, count * sizeof(*data) );
+    else free( data );
+}
+
 DECL_HANDLER(update_rawinput_devices)
 {
     const struct rawinput_device *devices = get_req_data();
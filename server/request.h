@@ -199,6 +199,8 @@ DECL_HANDLER(create_mapping);
 DECL_HANDLER(open_mapping);
 DECL_HANDLER(get_mapping_info);
 DECL_HANDLER(map_view);
+DECL_HANDLER(get_image_relocation);
+DECL_HANDLER(publish_image_relocation);
 DECL_HANDLER(unmap_view);
 DECL_HANDLER(get_mapping_committed_range);
 DECL_HANDLER(add_mapping_committed_range);
@@ -244,6 +246,7 @@ DECL_HANDLER(set_atom_information);
 DECL_HANDLER(empty_atom_table);
 DECL_HANDLER(init_atom_table);
 DECL_HANDLER(get_msg_queue);
+DECL_HANDLER(get_queue_shared_memory);
 DECL_HANDLER(set_queue_fd);
 DECL_HANDLER(set_queue_mask);
 DECL_HANDLER(get_queue_status);
@@ -251,6 +254,7 @@ DECL_HANDLER(get_process_idle_event);
 DECL_HANDLER(send_message);
 DECL_HANDLER(post_quit_message);
 DECL_HANDLER(send_hardware_message);
+DECL_HANDLER(send_hardware_messages);
 DECL_HANDLER(get_message);
 DECL_HANDLER(reply_message);
 DECL_HANDLER(accept_hardware_message);
@@ -283,6 +287,7 @@ DECL_HANDLER(get_window_children_from_point);
 DECL_HANDLER(get_window_tree);
 DECL_HANDLER(set_window_pos);
 DECL_HANDLER(get_window_rectangles);
+DECL_HANDLER(get_window_shared_memory);
 DECL_HANDLER(get_window_text);
 DECL_HANDLER(set_window_text);
 DECL_HANDLER(get_windows_offset);
@@ -309,6 +314,7 @@ DECL_HANDLER(open_input_desktop);
 DECL_HANDLER(close_desktop);
 DECL_HANDLER(get_thread_desktop);
 DECL_HANDLER(set_thread_desktop);
+DECL_HANDLER(get_desktop_shared_memory);
 DECL_HANDLER(enum_desktop);
 DECL_HANDLER(set_user_object_info);
 DECL_HANDLER(register_hotkey);
@@ -381,6 +387,7 @@ DECL_HANDLER(create_completion);
 DECL_HANDLER(open_completion);
 DECL_HANDLER(add_completion);
 DECL_HANDLER(remove_completion);
+DECL_HANDLER(remove_completions);
 DECL_HANDLER(query_completion);
 DECL_HANDLER(set_completion_info);
 DECL_HANDLER(add_fd_completion);
@@ -392,6 +399,7 @@ DECL_HANDLER(alloc_user_handle);
 DECL_HANDLER(free_user_handle);
 DECL_HANDLER(set_cursor);
 DECL_HANDLER(update_rawinput_devices);
+DECL_HANDLER(get_rawinput_buffer);
 DECL_HANDLER(get_suspend_context);
 DECL_HANDLER(set_suspend_context);
 DECL_HANDLER(create_job);
@@ -494,6 +502,8 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_open_mapping,
     (req_handler)req_get_mapping_info,
     (req_handler)req_map_view,
+    (req_handler)req_get_image_relocation,
+    (req_handler)req_publish_image_relocation,
     (req_handler)req_unmap_view,
     (req_handler)req_get_mapping_committed_range,
     (req_handler)req_add_mapping_committed_range,
@@ -539,6 +549,7 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_empty_atom_table,
     (req_handler)req_init_atom_table,
     (req_handler)req_get_msg_queue,
+    (req_handler)req_get_queue_shared_memory,
     (req_handler)req_set_queue_fd,
     (req_handler)req_set_queue_mask,
     (req_handler)req_get_queue_status,
@@ -546,6 +557,7 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_send_message,
     (req_handler)req_post_quit_message,
     (req_handler)req_send_hardware_message,
+    (req_handler)req_send_hardware_messages,
     (req_handler)req_get_message,
     (req_handler)req_reply_message,
     (req_handler)req_accept_hardware_message,
@@ -578,6 +590,7 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_get_window_tree,
     (req_handler)req_set_window_pos,
     (req_handler)req_get_window_rectangles,
+    (req_handler)req_get_window_shared_memory,
     (req_handler)req_get_window_text,
     (req_handler)req_set_window_text,
     (req_handler)req_get_windows_offset,
@@ -604,6 +617,7 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_close_desktop,
     (req_handler)req_get_thread_desktop,
     (req_handler)req_set_thread_desktop,
+    (req_handler)req_get_desktop_shared_memory,
     (req_handler)req_enum_desktop,
     (req_handler)req_set_user_object_info,
     (req_handler)req_register_hotkey,
@@ -676,6 +690,7 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_open_completion,
     (req_handler)req_add_completion,
     (req_handler)req_remove_completion,
+    (req_handler)req_remove_completions,
     (req_handler)req_query_completion,
     (req_handler)req_set_completion_info,
     (req_handler)req_add_fd_completion,
@@ -687,6 +702,7 @@ static const req_handler req_handlers[REQ_NB_REQUESTS] =
     (req_handler)req_free_user_handle,
     (req_handler)req_set_cursor,
     (req_handler)req_update_rawinput_devices,
+    (req_handler)req_get_rawinput_buffer,
     (req_handler)req_get_suspend_context,
     (req_handler)req_set_suspend_context,
     (req_handler)req_create_job,
@@ -1287,6 +1303,16 @@ C_ASSERT( FIELD_OFFSET(struct map_view_request, base) == 24 );
 C_ASSERT( FIELD_OFFSET(struct map_view_request, size) == 32 );
 C_ASSERT( FIELD_OFFSET(struct map_view_request, start) == 40 );
 C_ASSERT( sizeof(struct map_view_request) == 48 );
+C_ASSERT( FIELD_OFFSET(struct get_image_relocation_request, mapping) == 12 );
+C_ASSERT( FIELD_OFFSET(struct get_image_relocation_request, base) == 16 );
+C_ASSERT( sizeof(struct get_image_relocation_request) == 24 );
+C_ASSERT( FIELD_OFFSET(struct get_image_relocation_reply, file) == 8 );
+C_ASSERT( FIELD_OFFSET(struct get_image_relocation_reply, wanted) == 12 );
+C_ASSERT( sizeof(struct get_image_relocation_reply) == 16 );
+C_ASSERT( FIELD_OFFSET(struct publish_image_relocation_request, mapping) == 12 );
+C_ASSERT( FIELD_OFFSET(struct publish_image_relocation_request, base) == 16 );
+C_ASSERT( FIELD_OFFSET(struct publish_image_relocation_request, copy) == 24 );
+C_ASSERT( sizeof(struct publish_image_relocation_request) == 32 );
 C_ASSERT( FIELD_OFFSET(struct unmap_view_request, base) == 16 );
 C_ASSERT( sizeof(struct unmap_view_request) == 24 );
 C_ASSERT( FIELD_OFFSET(struct get_mapping_committed_range_request, base) == 16 );
@@ -1504,6 +1530,9 @@ C_ASSERT( sizeof(struct init_atom_table_reply) == 16 );
 C_ASSERT( sizeof(struct get_msg_queue_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct get_msg_queue_reply, handle) == 8 );
 C_ASSERT( sizeof(struct get_msg_queue_reply) == 16 );
+C_ASSERT( sizeof(struct get_queue_shared_memory_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_queue_shared_memory_reply, handle) == 8 );
+C_ASSERT( sizeof(struct get_queue_shared_memory_reply) == 16 );
 C_ASSERT( FIELD_OFFSET(struct set_queue_fd_request, handle) == 12 );
 C_ASSERT( sizeof(struct set_queue_fd_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct set_queue_mask_request, wake_mask) == 12 );
@@ -1543,6 +1572,16 @@ C_ASSERT( FIELD_OFFSET(struct send_hardware_message_reply, prev_y) == 16 );
 C_ASSERT( FIELD_OFFSET(struct send_hardware_message_reply, new_x) == 20 );
 C_ASSERT( FIELD_OFFSET(struct send_hardware_message_reply, new_y) == 24 );
 C_ASSERT( sizeof(struct send_hardware_message_reply) == 32 );
+C_ASSERT( FIELD_OFFSET(struct send_hardware_messages_request, win) == 12 );
+C_ASSERT( FIELD_OFFSET(struct send_hardware_messages_request, flags) == 16 );
+C_ASSERT( sizeof(struct send_hardware_messages_request) == 24 );
+C_ASSERT( FIELD_OFFSET(struct send_hardware_messages_reply, count) == 8 );
+C_ASSERT( FIELD_OFFSET(struct send_hardware_messages_reply, wait) == 12 );
+C_ASSERT( FIELD_OFFSET(struct send_hardware_messages_reply, prev_x) == 16 );
+C_ASSERT( FIELD_OFFSET(struct send_hardware_messages_reply, prev_y) == 20 );
+C_ASSERT( FIELD_OFFSET(struct send_hardware_messages_reply, new_x) == 24 );
+C_ASSERT( FIELD_OFFSET(struct send_hardware_messages_reply, new_y) == 28 );
+C_ASSERT( sizeof(struct send_hardware_messages_reply) == 32 );
 C_ASSERT( FIELD_OFFSET(struct get_message_request, flags) == 12 );
 C_ASSERT( FIELD_OFFSET(struct get_message_request, get_win) == 16 );
 C_ASSERT( FIELD_OFFSET(struct get_message_request, get_first) == 20 );
@@ -1769,6 +1808,9 @@ C_ASSERT( sizeof(struct get_window_rectangles_request) == 24 );
 C_ASSERT( FIELD_OFFSET(struct get_window_rectangles_reply, window) == 8 );
 C_ASSERT( FIELD_OFFSET(struct get_window_rectangles_reply, client) == 24 );
 C_ASSERT( sizeof(struct get_window_rectangles_reply) == 40 );
+C_ASSERT( sizeof(struct get_window_shared_memory_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_window_shared_memory_reply, handle) == 8 );
+C_ASSERT( sizeof(struct get_window_shared_memory_reply) == 16 );
 C_ASSERT( FIELD_OFFSET(struct get_window_text_request, handle) == 12 );
 C_ASSERT( sizeof(struct get_window_text_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct get_window_text_reply, length) == 8 );
@@ -1886,6 +1928,9 @@ C_ASSERT( FIELD_OFFSET(struct get_thread_desktop_reply, handle) == 8 );
 C_ASSERT( sizeof(struct get_thread_desktop_reply) == 16 );
 C_ASSERT( FIELD_OFFSET(struct set_thread_desktop_request, handle) == 12 );
 C_ASSERT( sizeof(struct set_thread_desktop_request) == 16 );
+C_ASSERT( sizeof(struct get_desktop_shared_memory_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_desktop_shared_memory_reply, handle) == 8 );
+C_ASSERT( sizeof(struct get_desktop_shared_memory_reply) == 16 );
 C_ASSERT( FIELD_OFFSET(struct enum_desktop_request, winstation) == 12 );
 C_ASSERT( FIELD_OFFSET(struct enum_desktop_request, index) == 16 );
 C_ASSERT( sizeof(struct enum_desktop_request) == 24 );
@@ -2315,6 +2360,9 @@ C_ASSERT( FIELD_OFFSET(struct remove_completion_reply, cvalue) == 16 );
 C_ASSERT( FIELD_OFFSET(struct remove_completion_reply, information) == 24 );
 C_ASSERT( FIELD_OFFSET(struct remove_completion_reply, status) == 32 );
 C_ASSERT( sizeof(struct remove_completion_reply) == 40 );
+C_ASSERT( FIELD_OFFSET(struct remove_completions_request, handle) == 12 );
+C_ASSERT( sizeof(struct remove_completions_request) == 16 );
+C_ASSERT( sizeof(struct remove_completions_reply) == 8 );
 C_ASSERT( FIELD_OFFSET(struct query_completion_request, handle) == 12 );
 C_ASSERT( sizeof(struct query_completion_request) == 16 );
 C_ASSERT( FIELD_OFFSET(struct query_completion_reply, depth) == 8 );
@@ -2369,6 +2417,10 @@ C_ASSERT( FIELD_OFFSET(struct set_cursor_reply, new_clip) == 32 );
 C_ASSERT( FIELD_OFFSET(struct set_cursor_reply, last_change) == 48 );
 C_ASSERT( sizeof(struct set_cursor_reply) == 56 );
 C_ASSERT( sizeof(struct update_rawinput_devices_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_rawinput_buffer_request, remove) == 12 );
+C_ASSERT( sizeof(struct get_rawinput_buffer_request) == 16 );
+C_ASSERT( FIELD_OFFSET(struct get_rawinput_buffer_reply, count) == 8 );
+C_ASSERT( sizeof(struct get_rawinput_buffer_reply) == 16 );
 C_ASSERT( sizeof(struct get_suspend_context_request) == 16 );
 C_ASSERT( sizeof(struct get_suspend_context_reply) == 8 );
 C_ASSERT( sizeof(struct set_suspend_context_request) == 16 );
@@ -102,6 +102,7 @@ struct sock
     unsigned int        pmask;       /* pending events */
     unsigned int        flags;       /* socket flags */
     int                 polling;     /* is socket being polled? */
+    int                 fd_cached;   /* has the client been allowed to cache the fd? */
     unsigned short      proto;       /* socket protocol */
     unsigned short      type;        /* socket type */
     unsigned short      family;      /* socket family */
@@ -604,6 +605,15 @@ static void sock_reselect_async( struct fd *fd, struct async_queue *queue )
 static struct fd *sock_get_fd( struct object *obj )
 {
     struct sock *sock = (struct sock *)obj;
+
+    /* the fd is only replaced when the socket is the target of accept_into_socket, which
+     * isn't allowed once it is connected or listening, so the client can cache it from then */
+    if (!sock->fd_cached &&
+        (sock->type != SOCK_STREAM || (sock->state & (FD_WINE_CONNECTED|FD_WINE_LISTENING))))
+    {
+        allow_fd_caching( sock->fd );
+        sock->fd_cached = 1;
+    }
     return (struct fd *)grab_object( sock->fd );
 }
 
@@ -638,6 +648,7 @@ static void init_sock(struct sock *sock)
     sock->hmask   = 0;
     sock->pmask   = 0;
     sock->polling = 0;
+    sock->fd_cached = 0;
     sock->flags   = 0;
     sock->type    = 0;
     sock->family  = 0;
@@ -778,6 +789,13 @@ static int accept_into_socket( struct sock *sock, struct sock *acceptsock )
 {
     int acceptfd;
     struct fd *newfd;
+
+    if (acceptsock->fd_cached || (acceptsock->state & (FD_WINE_CONNECTED|FD_WINE_LISTENING)))
+    {
+        set_error( STATUS_INVALID_PARAMETER );
+        return FALSE;
+    }
+
     if ( sock->deferred )
     {
         newfd = dup_fd_object( sock->deferred->fd, 0, 0,
@@ -1185,6 +1185,25 @@ static void dump_varargs_pe_image_info( const char *prefix, data_size_t size )
     remove_data( size );
 }
 
+static void dump_varargs_completion_msgs( const char *prefix, data_size_t size )
+{
+    const struct completion_msg *msg;
+
+    fprintf( stderr, "%s{", prefix );
+    while (size >= sizeof(*msg))
+    {
+        msg = cur_data;
+        dump_uint64( "{ckey=", &msg->ckey );
+        dump_uint64( ",cvalue=", &msg->cvalue );
+        dump_uint64( ",information=", &msg->information );
+        fprintf( stderr, ",status=%08x}", msg->status );
+        size -= sizeof(*msg);
+        remove_data( sizeof(*msg) );
+        if (size) fputc( ',', stderr );
+    }
+    fputc( '}', stderr );
+}
+
 static void dump_varargs_rawinput_devices(const char *prefix, data_size_t size )
 {
     const struct rawinput_device *device;
@@ -1202,6 +1221,40 @@ static void dump_varargs_rawinput_devices(const char *prefix, data_size_t size )
     fputc( '}', stderr );
 }
 
+static void dump_varargs_hw_inputs( const char *prefix, data_size_t size )
+{
+    const hw_input_t *input;
+
+    fprintf( stderr, "%s{", prefix );
+    while (size >= sizeof(*input))
+    {
+        input = cur_data;
+        dump_hw_input( "", input );
+        size -= sizeof(*input);
+        remove_data( sizeof(*input) );
+        if (size) fputc( ',', stderr );
+    }
+    fputc( '}', stderr );
+}
+
+static void dump_varargs_hw_msg_data( const char *prefix, data_size_t size )
+{
+    const struct hardware_msg_data *data;
+
+    fprintf( stderr, "%s{", prefix );
+    while (size >= sizeof(*data))
+    {
+        data = cur_data;
+        fprintf( stderr, "{hw_id=%08x,flags=%08x,type=%d", data->hw_id, data->flags, data->rawinput.type );
+        dump_uint64( ",info=", &data->info );
+        fputc( '}', stderr );
+        size -= sizeof(*data);
+        remove_data( sizeof(*data) );
+        if (size) fputc( ',', stderr );
+    }
+    fputc( '}', stderr );
+}
+
 static void dump_varargs_handle_infos( const char *prefix, data_size_t size )
 {
     const struct handle_info *handle;
@@ -2284,6 +2337,25 @@ static void dump_map_view_request( const struct map_view_request *req )
     dump_uint64( ", start=", &req->start );
 }
 
+static void dump_get_image_relocation_request( const struct get_image_relocation_request *req )
+{
+    fprintf( stderr, " mapping=%04x", req->mapping );
+    dump_uint64( ", base=", &req->base );
+}
+
+static void dump_get_image_relocation_reply( const struct get_image_relocation_reply *req )
+{
+    fprintf( stderr, " file=%04x", req->file );
+    fprintf( stderr, ", wanted=%d", req->wanted );
+}
+
+static void dump_publish_image_relocation_request( const struct publish_image_relocation_request *req )
+{
+    fprintf( stderr, " mapping=%04x", req->mapping );
+    dump_uint64( ", base=", &req->base );
+    fprintf( stderr, ", copy=%04x", req->copy );
+}
+
 static void dump_unmap_view_request( const struct unmap_view_request *req )
 {
     dump_uint64( " base=", &req->base );
@@ -2744,6 +2816,15 @@ static void dump_get_msg_queue_reply( const struct get_msg_queue_reply *req )
     fprintf( stderr, " handle=%04x", req->handle );
 }
 
+static void dump_get_queue_shared_memory_request( const struct get_queue_shared_memory_request *req )
+{
+}
+
+static void dump_get_queue_shared_memory_reply( const struct get_queue_shared_memory_reply *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+}
+
 static void dump_set_queue_fd_request( const struct set_queue_fd_request *req )
 {
     fprintf( stderr, " handle=%04x", req->handle );
@@ -2818,6 +2899,24 @@ static void dump_send_hardware_message_reply( const struct send_hardware_message
     dump_varargs_bytes( ", keystate=", cur_size );
 }
 
+static void dump_send_hardware_messages_request( const struct send_hardware_messages_request *req )
+{
+    fprintf( stderr, " win=%08x", req->win );
+    fprintf( stderr, ", flags=%08x", req->flags );
+    dump_varargs_hw_inputs( ", inputs=", cur_size );
+}
+
+static void dump_send_hardware_messages_reply( const struct send_hardware_messages_reply *req )
+{
+    fprintf( stderr, " count=%08x", req->count );
+    fprintf( stderr, ", wait=%d", req->wait );
+    fprintf( stderr, ", prev_x=%d", req->prev_x );
+    fprintf( stderr, ", prev_y=%d", req->prev_y );
+    fprintf( stderr, ", new_x=%d", req->new_x );
+    fprintf( stderr, ", new_y=%d", req->new_y );
+    dump_varargs_bytes( ", keystate=", cur_size );
+}
+
 static void dump_get_message_request( const struct get_message_request *req )
 {
     fprintf( stderr, " flags=%08x", req->flags );
@@ -3225,6 +3324,15 @@ static void dump_get_window_rectangles_reply( const struct get_window_rectangles
     dump_rectangle( ", client=", &req->client );
 }
 
+static void dump_get_window_shared_memory_request( const struct get_window_shared_memory_request *req )
+{
+}
+
+static void dump_get_window_shared_memory_reply( const struct get_window_shared_memory_reply *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+}
+
 static void dump_get_window_text_request( const struct get_window_text_request *req )
 {
     fprintf( stderr, " handle=%08x", req->handle );
@@ -3488,6 +3596,15 @@ static void dump_set_thread_desktop_request( const struct set_thread_desktop_req
     fprintf( stderr, " handle=%04x", req->handle );
 }
 
+static void dump_get_desktop_shared_memory_request( const struct get_desktop_shared_memory_request *req )
+{
+}
+
+static void dump_get_desktop_shared_memory_reply( const struct get_desktop_shared_memory_reply *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+}
+
 static void dump_enum_desktop_request( const struct enum_desktop_request *req )
 {
     fprintf( stderr, " winstation=%04x", req->winstation );
@@ -4358,6 +4475,16 @@ static void dump_remove_completion_reply( const struct remove_completion_reply *
     fprintf( stderr, ", status=%08x", req->status );
 }
 
+static void dump_remove_completions_request( const struct remove_completions_request *req )
+{
+    fprintf( stderr, " handle=%04x", req->handle );
+}
+
+static void dump_remove_completions_reply( const struct remove_completions_reply *req )
+{
+    dump_varargs_completion_msgs( " msgs=", cur_size );
+}
+
 static void dump_query_completion_request( const struct query_completion_request *req )
 {
     fprintf( stderr, " handle=%04x", req->handle );
@@ -4459,6 +4586,17 @@ static void dump_update_rawinput_devices_request( const struct update_rawinput_d
     dump_varargs_rawinput_devices( " devices=", cur_size );
 }
 
+static void dump_get_rawinput_buffer_request( const struct get_rawinput_buffer_request *req )
+{
+    fprintf( stderr, " remove=%d", req->remove );
+}
+
+static void dump_get_rawinput_buffer_reply( const struct get_rawinput_buffer_reply *req )
+{
+    fprintf( stderr, " count=%08x", req->count );
+    dump_varargs_hw_msg_data( ", data=", cur_size );
+}
+
 static void dump_get_suspend_context_request( const struct get_suspend_context_request *req )
 {
 }
@@ -4616,6 +4754,8 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_open_mapping_request,
     (dump_func)dump_get_mapping_info_request,
     (dump_func)dump_map_view_request,
+    (dump_func)dump_get_image_relocation_request,
+    (dump_func)dump_publish_image_relocation_request,
     (dump_func)dump_unmap_view_request,
     (dump_func)dump_get_mapping_committed_range_request,
     (dump_func)dump_add_mapping_committed_range_request,
@@ -4661,6 +4801,7 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_empty_atom_table_request,
     (dump_func)dump_init_atom_table_request,
     (dump_func)dump_get_msg_queue_request,
+    (dump_func)dump_get_queue_shared_memory_request,
     (dump_func)dump_set_queue_fd_request,
     (dump_func)dump_set_queue_mask_request,
     (dump_func)dump_get_queue_status_request,
@@ -4668,6 +4809,7 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_send_message_request,
     (dump_func)dump_post_quit_message_request,
     (dump_func)dump_send_hardware_message_request,
+    (dump_func)dump_send_hardware_messages_request,
     (dump_func)dump_get_message_request,
     (dump_func)dump_reply_message_request,
     (dump_func)dump_accept_hardware_message_request,
@@ -4700,6 +4842,7 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_get_window_tree_request,
     (dump_func)dump_set_window_pos_request,
     (dump_func)dump_get_window_rectangles_request,
+    (dump_func)dump_get_window_shared_memory_request,
     (dump_func)dump_get_window_text_request,
     (dump_func)dump_set_window_text_request,
     (dump_func)dump_get_windows_offset_request,
@@ -4726,6 +4869,7 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_close_desktop_request,
     (dump_func)dump_get_thread_desktop_request,
     (dump_func)dump_set_thread_desktop_request,
+    (dump_func)dump_get_desktop_shared_memory_request,
     (dump_func)dump_enum_desktop_request,
     (dump_func)dump_set_user_object_info_request,
     (dump_func)dump_register_hotkey_request,
@@ -4798,6 +4942,7 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_open_completion_request,
     (dump_func)dump_add_completion_request,
     (dump_func)dump_remove_completion_request,
+    (dump_func)dump_remove_completions_request,
     (dump_func)dump_query_completion_request,
     (dump_func)dump_set_completion_info_request,
     (dump_func)dump_add_fd_completion_request,
@@ -4809,6 +4954,7 @@ static const dump_func req_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_free_user_handle_request,
     (dump_func)dump_set_cursor_request,
     (dump_func)dump_update_rawinput_devices_request,
+    (dump_func)dump_get_rawinput_buffer_request,
     (dump_func)dump_get_suspend_context_request,
     (dump_func)dump_set_suspend_context_request,
     (dump_func)dump_create_job_request,
@@ -4908,6 +5054,8 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_open_mapping_reply,
     (dump_func)dump_get_mapping_info_reply,
     NULL,
+    (dump_func)dump_get_image_relocation_reply,
+    NULL,
     NULL,
     (dump_func)dump_get_mapping_committed_range_reply,
     NULL,
@@ -4953,6 +5101,7 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     NULL,
     (dump_func)dump_init_atom_table_reply,
     (dump_func)dump_get_msg_queue_reply,
+    (dump_func)dump_get_queue_shared_memory_reply,
     NULL,
     (dump_func)dump_set_queue_mask_reply,
     (dump_func)dump_get_queue_status_reply,
@@ -4960,6 +5109,7 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     NULL,
     NULL,
     (dump_func)dump_send_hardware_message_reply,
+    (dump_func)dump_send_hardware_messages_reply,
     (dump_func)dump_get_message_reply,
     NULL,
     NULL,
@@ -4992,6 +5142,7 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_get_window_tree_reply,
     (dump_func)dump_set_window_pos_reply,
     (dump_func)dump_get_window_rectangles_reply,
+    (dump_func)dump_get_window_shared_memory_reply,
     (dump_func)dump_get_window_text_reply,
     NULL,
     (dump_func)dump_get_windows_offset_reply,
@@ -5018,6 +5169,7 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     NULL,
     (dump_func)dump_get_thread_desktop_reply,
     NULL,
+    (dump_func)dump_get_desktop_shared_memory_reply,
     (dump_func)dump_enum_desktop_reply,
     (dump_func)dump_set_user_object_info_reply,
     (dump_func)dump_register_hotkey_reply,
@@ -5090,6 +5242,7 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     (dump_func)dump_open_completion_reply,
     NULL,
     (dump_func)dump_remove_completion_reply,
+    (dump_func)dump_remove_completions_reply,
     (dump_func)dump_query_completion_reply,
     NULL,
     NULL,
@@ -5101,6 +5254,7 @@ static const dump_func reply_dumpers[REQ_NB_REQUESTS] = {
     NULL,
     (dump_func)dump_set_cursor_reply,
     NULL,
+    (dump_func)dump_get_rawinput_buffer_reply,
     (dump_func)dump_get_suspend_context_reply,
     NULL,
     (dump_func)dump_create_job_reply,
@@ -5200,6 +5354,8 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "open_mapping",
     "get_mapping_info",
     "map_view",
+    "get_image_relocation",
+    "publish_image_relocation",
     "unmap_view",
     "get_mapping_committed_range",
     "add_mapping_committed_range",
@@ -5245,6 +5401,7 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "empty_atom_table",
     "init_atom_table",
     "get_msg_queue",
+    "get_queue_shared_memory",
     "set_queue_fd",
     "set_queue_mask",
     "get_queue_status",
@@ -5252,6 +5409,7 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "send_message",
     "post_quit_message",
     "send_hardware_message",
+    "send_hardware_messages",
     "get_message",
     "reply_message",
     "accept_hardware_message",
@@ -5284,6 +5442,7 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "get_window_tree",
     "set_window_pos",
     "get_window_rectangles",
+    "get_window_shared_memory",
     "get_window_text",
     "set_window_text",
     "get_windows_offset",
@@ -5310,6 +5469,7 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "close_desktop",
     "get_thread_desktop",
     "set_thread_desktop",
+    "get_desktop_shared_memory",
     "enum_desktop",
     "set_user_object_info",
     "register_hotkey",
@@ -5382,6 +5542,7 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "open_completion",
     "add_completion",
     "remove_completion",
+    "remove_completions",
     "query_completion",
     "set_completion_info",
     "add_fd_completion",
@@ -5393,6 +5554,7 @@ static const char * const req_names[REQ_NB_REQUESTS] = {
     "free_user_handle",
     "set_cursor",
     "update_rawinput_devices",
+    "get_rawinput_buffer",
     "get_suspend_context",
     "set_suspend_context",
     "create_job",
@@ -76,7 +76,9 @@ struct desktop
     struct thread_input *foreground_input; /* thread input of foreground thread */
     unsigned int         users;            /* processes and threads using this desktop */
     struct global_cursor cursor;           /* global cursor information */
-    unsigned char        keystate[256];    /* asynchronous key state */
+    unsigned char       *keystate;         /* asynchronous key state, in the shared memory */
+    struct object       *shm_mapping;      /* mapping for the shared memory */
+    volatile desktop_shm_t *shm;           /* input state published in shared memory */
 };
 
 /* user handles functions */
@@ -33,6 +33,8 @@
 #include "winternl.h"
 
 #include "object.h"
+#include "file.h"
+#include "handle.h"
 #include "request.h"
 #include "thread.h"
 #include "process.h"
@@ -120,6 +122,10 @@ static struct window *shell_listview;
 static struct window *progman_window;
 static struct window *taskman_window;
 
+/* window information published in shared memory, indexed by user handle */
+static struct object *window_shm_mapping;
+static volatile window_shm_t *window_shm;
+
 /* magic HWND_TOP etc. pointers */
 #define WINPTR_TOP       ((struct window *)1L)
 #define WINPTR_BOTTOM    ((struct window *)2L)
@@ -140,6 +146,40 @@ static inline int is_desktop_window( const struct window *win )
     return !win->parent;  /* only desktop windows have no parent */
 }
 
+/* publish the window information in shared memory */
+static void update_window_shm( struct window *win )
+{
+    volatile window_shm_t *entry;
+
+    if (!window_shm) return;
+    entry = &window_shm[((win->handle & 0xffff) - FIRST_USER_HANDLE) >> 1];
+
+    /* the client retries reading while the sequence number is odd or has changed */
+    interlocked_xchg_add( (int *)&entry->seq, 1 );
+    entry->handle      = win->handle;
+    entry->parent      = win->parent ? win->parent->handle : 0;
+    entry->owner       = win->owner;
+    entry->style       = win->style;
+    entry->ex_style    = win->ex_style;
+    entry->id          = win->id;
+    entry->flags       = is_desktop_window( win ) ? WINDOW_SHM_DESKTOP : 0;
+    entry->window_rect = win->window_rect;
+    entry->client_rect = win->client_rect;
+    interlocked_xchg_add( (int *)&entry->seq, 1 );
+}
+
+/* remove the window from the shared memory */
+static void clear_window_shm( struct window *win )
+{
+    volatile window_shm_t *entry;
+
+    if (!window_shm) return;
+    entry = &window_shm[((win->handle & 0xffff) - FIRST_USER_HANDLE) >> 1];
+    interlocked_xchg_add( (int *)&entry->seq, 1 );
+    entry->handle = 0;
+    interlocked_xchg_add( (int *)&entry->seq, 1 );
+}
+
 /* get next window in Z-order list */
 static inline struct window *get_next_window( struct window *win )
 {
@@ -237,6 +277,7 @@ static void link_window( struct window *win, struct window *previous )
     }
 
     win->is_linked = 1;
+    update_window_shm( win );
 }
 
 /* change the parent of a window (or unlink the window if the new parent is NULL) */
@@ -278,6 +319,7 @@ static int set_parent_window( struct window *win, struct window *parent )
         list_remove( &win->entry );  /* unlink it from the previous location */
         list_add_head( &win->parent->unlinked, &win->entry );
         win->is_linked = 0;
+        update_window_shm( win );
     }
     return 1;
 }
@@ -545,6 +587,7 @@ static struct window *create_window( struct window *parent, struct window *owner
     }
 
     current->desktop_users++;
+    update_window_shm( win );
     return win;
 
 failed:
@@ -1675,6 +1718,7 @@ static void set_window_pos( struct window *win, struct window *previous,
     if (!(swp_flags & SWP_NOZORDER) && win->parent) link_window( win, previous );
     if (swp_flags & SWP_SHOWWINDOW) win->style |= WS_VISIBLE;
     else if (swp_flags & SWP_HIDEWINDOW) win->style &= ~WS_VISIBLE;
+    update_window_shm( win );
 
     /* keep children at the same position relative to top right corner when the parent is mirrored */
     if (win->ex_style & WS_EX_LAYOUTRTL)
@@ -1688,6 +1732,7 @@ static void set_window_pos( struct window *win, struct window *previous,
             offset_rect( &child->window_rect, new_size - old_size, 0 );
             offset_rect( &child->visible_rect, new_size - old_size, 0 );
             offset_rect( &child->client_rect, new_size - old_size, 0 );
+            update_window_shm( child );
         }
     }
 
@@ -1850,6 +1895,7 @@ void destroy_window( struct window *win )
     {
         struct region *vis_rgn = get_visible_region( win, DCX_WINDOW );
         win->style &= ~WS_VISIBLE;
+        update_window_shm( win );
         if (vis_rgn)
         {
             struct region *exposed_rgn = expose_window( win, &win->window_rect, vis_rgn );
@@ -1873,6 +1919,7 @@ void destroy_window( struct window *win )
     if (win == taskman_window) taskman_window = NULL;
     free_hotkeys( win->desktop, win->handle );
     cleanup_clipboard_window( win->desktop, win->handle );
+    clear_window_shm( win );
     free_user_handle( win->handle );
     destroy_properties( win );
     list_remove( &win->entry );
@@ -1999,6 +2046,7 @@ DECL_HANDLER(get_desktop_window)
         {
             detach_window_thread( desktop->top_window );
             desktop->top_window->style  = WS_POPUP | WS_VISIBLE | WS_CLIPSIBLINGS | WS_CLIPCHILDREN;
+            update_window_shm( desktop->top_window );
         }
     }
 
@@ -2011,6 +2059,7 @@ DECL_HANDLER(get_desktop_window)
         {
             detach_window_thread( desktop->msg_window );
             desktop->msg_window->style = WS_POPUP | WS_CLIPSIBLINGS | WS_CLIPCHILDREN;
+            update_window_shm( desktop->msg_window );
         }
     }
 
@@ -2046,6 +2095,7 @@ DECL_HANDLER(set_window_owner)
 
     reply->prev_owner = win->owner;
     reply->full_owner = win->owner = owner ? owner->handle : 0;
+    update_window_shm( win );
 }
 
 
@@ -2117,6 +2167,7 @@ DECL_HANDLER(set_window_info)
     if (req->flags & SET_WIN_USERDATA) win->user_data = req->user_data;
     if (req->flags & SET_WIN_EXTRA) memcpy( win->extra_bytes + req->extra_offset,
                                             &req->extra_value, req->extra_size );
+    if (req->flags & (SET_WIN_STYLE | SET_WIN_EXSTYLE | SET_WIN_ID)) update_window_shm( win );
 
     /* changing window style triggers a non-client paint */
     if (req->flags & SET_WIN_STYLE) win->paint_flags |= PAINT_NONCLIENT;
@@ -2374,6 +2425,28 @@ DECL_HANDLER(get_window_rectangles)
 }
 
 
+/* get a handle to the shared window information */
+DECL_HANDLER(get_window_shared_memory)
+{
+    if (!window_shm_mapping)
+    {
+        struct window *win;
+        user_handle_t handle = 0;
+        void *ptr;
+
+        if (!(window_shm_mapping = create_shared_mapping( ((LAST_USER_HANDLE - FIRST_USER_HANDLE + 1) >> 1) *
+                                                          sizeof(*window_shm), &ptr )))
+            return;
+        make_object_static( window_shm_mapping );
+        window_shm = ptr;
+
+        /* publish the windows that already exist */
+        while ((win = next_user_handle( &handle, USER_WINDOW ))) update_window_shm( win );
+    }
+    reply->handle = alloc_handle( current->process, window_shm_mapping, SECTION_MAP_READ | SECTION_QUERY, 0 );
+}
+
+
 /* get the window text */
 DECL_HANDLER(get_window_text)
 {
@@ -23,6 +23,9 @@
 
 #include <stdio.h>
 #include <stdarg.h>
+#ifdef HAVE_SYS_MMAN_H
+# include <sys/mman.h>
+#endif
 
 #include "ntstatus.h"
 #define WIN32_NO_STATUS
@@ -212,6 +215,7 @@ static struct desktop *create_desktop( const struct unicode_str *name, unsigned
                                        unsigned int flags, struct winstation *winstation )
 {
     struct desktop *desktop;
+    void *ptr;
 
     if ((desktop = create_named_object( &winstation->obj, &desktop_ops, name, attr, NULL )))
     {
@@ -226,10 +230,21 @@ static struct desktop *create_desktop( const struct unicode_str *name, unsigned
             desktop->close_timeout = NULL;
             desktop->foreground_input = NULL;
             desktop->users = 0;
+            desktop->shm = NULL;
+            desktop->shm_mapping = NULL;
             memset( &desktop->cursor, 0, sizeof(desktop->cursor) );
-            memset( desktop->keystate, 0, sizeof(desktop->keystate) );
-            list_add_tail( &winstation->desktops, &desktop->entry );
+            list_init( &desktop->entry );
             list_init( &desktop->hotkeys );
+
+            /* the mapping is zero-initialized */
+            if (!(desktop->shm_mapping = create_shared_mapping( sizeof(*desktop->shm), &ptr )))
+            {
+                release_object( desktop );
+                return NULL;
+            }
+            desktop->shm = ptr;
+            desktop->keystate = (unsigned char *)desktop->shm->keystate;
+            list_add_tail( &winstation->desktops, &desktop->entry );
         }
         else clear_error();
     }
@@ -289,6 +304,8 @@ static void desktop_destroy( struct object *obj )
     if (desktop->msg_window) destroy_window( desktop->msg_window );
     if (desktop->global_hooks) release_object( desktop->global_hooks );
     if (desktop->close_timeout) remove_timeout_user( desktop->close_timeout );
+    if (desktop->shm) munmap( (void *)desktop->shm, sizeof(*desktop->shm) );
+    if (desktop->shm_mapping) release_object( desktop->shm_mapping );
     list_remove( &desktop->entry );
     release_object( desktop->winstation );
 }
@@ -633,6 +650,17 @@ DECL_HANDLER(set_thread_desktop)
 }
 
 
+/* get a handle to the shared input state of the thread current desktop */
+DECL_HANDLER(get_desktop_shared_memory)
+{
+    struct desktop *desktop;
+
+    if (!(desktop = get_thread_desktop( current, 0 ))) return;
+    reply->handle = alloc_handle( current->process, desktop->shm_mapping, SECTION_MAP_READ | SECTION_QUERY, 0 );
+    release_object( desktop );
+}
+
+
 /* get/set information about a user object (window station or desktop) */
 DECL_HANDLER(set_user_object_info)
 {